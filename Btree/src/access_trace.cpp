@@ -0,0 +1,171 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include <limits>
+#include "access_trace.h"
+#include "file.h"
+#include "exceptions/bad_trace_exception.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+
+/**
+ * First bytes of every trace; the last one is the format version.
+ */
+static const char TRACEMAGIC[8] = {'B', 'D', 'B', 'T', 'R', 'A', 'C', 1};
+
+/**
+ * Number of records buffered before they are written out.
+ */
+static const std::size_t TRACEBUFFERRECORDS = 8192;
+
+/**
+ * Number of bytes a file name takes in a trace, padded to whole records.
+ */
+static std::size_t paddedNameLength(const std::size_t length)
+{
+  return (length + sizeof(TraceRecord) - 1) / sizeof(TraceRecord) * sizeof(TraceRecord);
+}
+
+AccessTraceWriter::AccessTraceWriter(const std::string& fileName)
+  : traceFileName(fileName), out(fileName.c_str(), std::ios::binary | std::ios::trunc), numRecords(0)
+{
+  if (!out)
+  {
+    throw BadTraceException(fileName);
+  }
+  out.write(TRACEMAGIC, sizeof(TRACEMAGIC));
+  records.reserve(TRACEBUFFERRECORDS);
+}
+
+AccessTraceWriter::~AccessTraceWriter()
+{
+  writeOut();
+}
+
+std::uint16_t AccessTraceWriter::fileId(const File* file)
+{
+  std::unordered_map<const File*, std::uint16_t>::const_iterator it = fileIds.find(file);
+  if (it != fileIds.end())
+  {
+    return it->second;
+  }
+  const std::string& name = file->filename();
+  std::unordered_map<std::string, std::uint16_t>::const_iterator named = nameIds.find(name);
+  std::uint16_t id;
+  if (named != nameIds.end())
+  {
+    id = named->second;
+  }
+  else if (nameIds.size() > std::numeric_limits<std::uint16_t>::max())
+  {
+    // out of ids: rather than give the file the id of another one, fail the trace as a failed write does
+    out.setstate(std::ios::failbit);
+    return 0;
+  }
+  else
+  {
+    id = static_cast<std::uint16_t>(nameIds.size());
+    nameIds[name] = id;
+    TraceRecord header = {static_cast<PageId>(name.size()), id, TRACE_FILE, 0};
+    append(header);
+    std::vector<char> padded(paddedNameLength(name.size()), 0);
+    memcpy(padded.data(), name.data(), name.size());
+    for (std::size_t i = 0; i < padded.size(); i += sizeof(TraceRecord))
+    {
+      TraceRecord chunk;
+      memcpy(&chunk, &padded[i], sizeof(TraceRecord));
+      append(chunk);
+    }
+  }
+  fileIds[file] = id;
+  return id;
+}
+
+void AccessTraceWriter::append(const TraceRecord& record)
+{
+  records.push_back(record);
+  numRecords++;
+  if (records.size() >= TRACEBUFFERRECORDS)
+  {
+    writeOut();
+  }
+}
+
+void AccessTraceWriter::record(const File* file, const PageId pageNo, const TraceOp op)
+{
+  TraceRecord access = {pageNo, fileId(file), static_cast<std::uint8_t>(op), 0};
+  append(access);
+  if (op == TRACE_FLUSH)
+  {
+    // the file may be closed next and its File object reused for another file
+    fileIds.erase(file);
+  }
+}
+
+bool AccessTraceWriter::writeOut()
+{
+  if (!records.empty())
+  {
+    // once a write failed, the stream stays failed and the records are dropped
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(TraceRecord));
+    out.flush();
+    records.clear();
+  }
+  return static_cast<bool>(out);
+}
+
+void AccessTraceWriter::flush()
+{
+  if (!writeOut())
+  {
+    throw BadTraceException(traceFileName);
+  }
+}
+
+AccessTraceReader::AccessTraceReader(const std::string& fileName)
+  : traceFileName(fileName), in(fileName.c_str(), std::ios::binary)
+{
+  if (!in)
+  {
+    throw FileNotFoundException(fileName);
+  }
+  char magic[sizeof(TRACEMAGIC)];
+  if (!in.read(magic, sizeof(magic)) || memcmp(magic, TRACEMAGIC, sizeof(magic)) != 0)
+  {
+    throw BadTraceException(fileName);
+  }
+}
+
+bool AccessTraceReader::next(TraceRecord& record)
+{
+  while (true)
+  {
+    in.read(reinterpret_cast<char*>(&record), sizeof(record));
+    if (in.gcount() == 0)
+    {
+      return false;
+    }
+    if (in.gcount() != sizeof(record) || record.op > TRACE_FLUSH)
+    {
+      throw BadTraceException(traceFileName);
+    }
+    if (record.op != TRACE_FILE)
+    {
+      return true;
+    }
+    std::vector<char> name(paddedNameLength(record.pageNo));
+    if (record.fileId != names.size() || !in.read(name.data(), name.size()))
+    {
+      throw BadTraceException(traceFileName);
+    }
+    names.push_back(std::string(name.data(), record.pageNo));
+  }
+}
+
+}
@@ -0,0 +1,182 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "types.h"
+
+namespace badgerdb {
+
+class File;
+
+/**
+ * @brief Kinds of records of an access trace.
+ */
+enum TraceOp
+{
+  TRACE_FILE = 0,         // a file gets an id; pageNo holds the length of its name, which follows the record
+  TRACE_READ = 1,         // a page is read and pinned
+  TRACE_ALLOC = 2,        // a page is allocated in the file and pinned
+  TRACE_UNPIN = 3,        // a page is unpinned clean
+  TRACE_UNPIN_DIRTY = 4,  // a page is unpinned after being written to
+  TRACE_PREFETCH = 5,     // a page is read ahead, unpinned
+  TRACE_DISPOSE = 6,      // a page is deleted from the file and the buffer pool
+  TRACE_FLUSH = 7         // all pages of a file leave the buffer pool; pageNo is 0
+};
+
+/**
+ * @brief One 8 byte record of an access trace, stored in host byte order.
+ */
+struct TraceRecord
+{
+  PageId pageNo;
+  std::uint16_t fileId;
+  std::uint8_t op;
+  std::uint8_t reserved;
+};
+
+/**
+ * @brief Writes the page accesses of a BufMgr to a binary trace file, for replay by the bufsim tool.
+ * The file starts with an 8 byte magic, followed by TraceRecords. Files are identified by small ids; the first
+ * record naming a file is preceded by a TRACE_FILE record and the file name, padded to a multiple of 8 bytes.
+ * Records are buffered and written in blocks. Recording never throws, so that a full disk cannot fail the buffer
+ * manager call being traced; flush() reports failed writes, and a trace naming more than 65536 distinct files, which
+ * run out of ids. Not thread safe; BufMgr only records under its latch.
+ */
+class AccessTraceWriter
+{
+ private:
+	/**
+	 * The trace file
+	 */
+  std::string traceFileName;
+  std::ofstream out;
+
+	/**
+	 * Records not written yet
+	 */
+  std::vector<TraceRecord> records;
+
+	/**
+	 * Id of every file name seen, and of the File objects seen since their last TRACE_FLUSH
+	 */
+  std::unordered_map<std::string, std::uint16_t> nameIds;
+  std::unordered_map<const File*, std::uint16_t> fileIds;
+
+	/**
+	 * Number of records written, TRACE_FILE records and the file names following them included
+	 */
+  std::uint64_t numRecords;
+
+	/**
+	 * Id of a file, assigning a new one on first use. Fails the trace if every id is taken.
+	 */
+  std::uint16_t fileId(const File* file);
+
+	/**
+	 * Append a record to the buffer, writing the buffer out once full
+	 */
+  void append(const TraceRecord& record);
+
+	/**
+	 * Write the buffered records to the trace file
+	 * @return False if this or an earlier write failed
+	 */
+  bool writeOut();
+
+ public:
+	/**
+	 * Create the trace file, replacing any file of that name.
+	 *
+	 * @param fileName		Name of the trace file
+	 * @throws BadTraceException If the file cannot be created
+	 */
+  explicit AccessTraceWriter(const std::string& fileName);
+
+	/**
+	 * Write the buffered records out and close the trace.
+	 */
+  ~AccessTraceWriter();
+
+  AccessTraceWriter(const AccessTraceWriter&) = delete;
+  AccessTraceWriter& operator=(const AccessTraceWriter&) = delete;
+
+	/**
+	 * Record an access.
+	 *
+	 * @param file			File of the page
+	 * @param pageNo		Page number, 0 for TRACE_FLUSH
+	 * @param op				What happened to the page
+	 */
+  void record(const File* file, const PageId pageNo, const TraceOp op);
+
+	/**
+	 * Write the buffered records to the trace file.
+	 *
+	 * @throws BadTraceException If this or an earlier write failed, or the files ran out of ids
+	 */
+  void flush();
+
+	/**
+	 * Number of records recorded so far
+	 */
+  std::uint64_t size() const { return numRecords; }
+};
+
+/**
+ * @brief Reads a trace written by AccessTraceWriter.
+ */
+class AccessTraceReader
+{
+ private:
+	/**
+	 * The trace file
+	 */
+  std::string traceFileName;
+  std::ifstream in;
+
+	/**
+	 * File names by file id
+	 */
+  std::vector<std::string> names;
+
+ public:
+	/**
+	 * Open a trace and check its magic.
+	 *
+	 * @param fileName		Name of the trace file
+	 * @throws FileNotFoundException If the file does not exist
+	 * @throws BadTraceException If the file is not an access trace
+	 */
+  explicit AccessTraceReader(const std::string& fileName);
+
+	/**
+	 * Read the next access. TRACE_FILE records are consumed here; their names are available from fileName().
+	 *
+	 * @param record		Next record returned in this
+	 * @return False at the end of the trace
+	 * @throws BadTraceException If the trace is truncated or holds an unknown record
+	 */
+  bool next(TraceRecord& record);
+
+	/**
+	 * Name of the file with the given id
+	 */
+  const std::string& fileName(const std::uint16_t fileId) const { return names.at(fileId); }
+
+	/**
+	 * Number of files named so far
+	 */
+  std::size_t numFiles() const { return names.size(); }
+};
+
+}
@@ -0,0 +1,256 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "batch_pipeline.h"
+#include "key_filter.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/invalid_record_exception.h"
+
+namespace badgerdb
+{
+
+	// -----------------------------------------------------------------------------
+	// RecordBatch::selectAll
+	// -----------------------------------------------------------------------------
+
+	void RecordBatch::selectAll()
+	{
+		for (int i = 0; i < numRows; i++)
+		{
+			selection[i] = i;
+		}
+		numSelected = numRows;
+	}
+
+	// -----------------------------------------------------------------------------
+	// FileScanSource::FileScanSource
+	// -----------------------------------------------------------------------------
+
+	FileScanSource::FileScanSource(const std::string &relationName, BufMgr *bufMgr, const int attrByteOffset,
+								   const PageId firstPageNo, const PageId endPageNo)
+	{
+		file = new PageFile(relationName, false);
+		this->bufMgr = bufMgr;
+		this->attrByteOffset = attrByteOffset;
+		this->endPageNo = std::min(endPageNo, file->getNumPages());
+		curPage = NULL;
+		readAheadEnd = 0;
+		//start at the first used page of the range
+		PageId pageNo = firstPageNo;
+		while (pageNo < this->endPageNo && !file->isPageUsed(pageNo))
+		{
+			pageNo++;
+		}
+		filePageIter = pageNo < this->endPageNo ? FileIterator(file, pageNo) : file->end();
+	}
+
+	// -----------------------------------------------------------------------------
+	// FileScanSource::~FileScanSource
+	// -----------------------------------------------------------------------------
+
+	FileScanSource::~FileScanSource()
+	{
+		if (curPage != NULL)
+		{
+			bufMgr->unPinPage(file, filePageIter.getCurrentPageNo(), false);
+			curPage = NULL;
+		}
+		bufMgr->flushFile(file);
+		delete file;
+	}
+
+	// -----------------------------------------------------------------------------
+	// FileScanSource::nextBatch
+	// -----------------------------------------------------------------------------
+
+	int FileScanSource::nextBatch(RecordBatch &batch)
+	{
+		int numRows = 0;
+		while (numRows < BATCHSIZE)
+		{
+			if (curPage == NULL)
+			{
+				if (filePageIter == file->end() || filePageIter.getCurrentPageNo() >= endPageNo)
+				{
+					break;
+				}
+				PageId pageNo = filePageIter.getCurrentPageNo();
+				//once past the pages read ahead, read the next ones in one batch
+				if (pageNo >= readAheadEnd)
+				{
+					readAheadEnd = pageNo + std::min(READAHEADPAGES, endPageNo - pageNo);
+					bufMgr->prefetchPages(file, pageNo, readAheadEnd);
+				}
+				bufMgr->readPage(file, pageNo, curPage);
+				pageRecordIter = curPage->begin();
+				pageRecordEnd = curPage->end();
+			}
+			//copy the attribute of the records of this page straight into the value column
+			while (numRows < BATCHSIZE && pageRecordIter != pageRecordEnd)
+			{
+				RecordId rid = pageRecordIter.getCurrentRecord();
+				std::size_t length;
+				const char *record = curPage->getRecordData(rid, length);
+				//a record too short to hold the attribute is not of this relation
+				if ((std::size_t)attrByteOffset + sizeof(int) > length)
+				{
+					throw InvalidRecordException(rid, rid.page_number);
+				}
+				batch.rids[numRows] = rid;
+				memcpy(&batch.values[numRows], record + attrByteOffset, sizeof(int));
+				numRows++;
+				++pageRecordIter;
+			}
+			if (pageRecordIter == pageRecordEnd)
+			{
+				bufMgr->unPinPage(file, filePageIter.getCurrentPageNo(), false);
+				curPage = NULL;
+				filePageIter++;
+			}
+		}
+		batch.numRows = numRows;
+		batch.selectAll();
+		return numRows;
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexScanSource::IndexScanSource
+	// -----------------------------------------------------------------------------
+
+	IndexScanSource::IndexScanSource(BTreeIndex &index, const void *lowVal, const Operator lowOp,
+									 const void *highVal, const Operator highOp)
+		: index(index)
+	{
+		scanExecuting = index.tryStartScan(lowVal, lowOp, highVal, highOp);
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexScanSource::~IndexScanSource
+	// -----------------------------------------------------------------------------
+
+	IndexScanSource::~IndexScanSource()
+	{
+		if (scanExecuting)
+		{
+			index.endScan();
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexScanSource::nextBatch
+	// -----------------------------------------------------------------------------
+
+	int IndexScanSource::nextBatch(RecordBatch &batch)
+	{
+		batch.numRows = 0;
+		if (scanExecuting)
+		{
+			batch.numRows = index.scanNextBatch(batch.rids, BATCHSIZE, batch.values);
+			if (batch.numRows == 0)
+			{
+				index.endScan();
+				scanExecuting = false;
+			}
+		}
+		batch.selectAll();
+		return batch.numRows;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BatchAggregate::BatchAggregate
+	// -----------------------------------------------------------------------------
+
+	BatchAggregate::BatchAggregate()
+		: count(0), sum(0), min(std::numeric_limits<int>::max()), max(std::numeric_limits<int>::min())
+	{
+	}
+
+	// -----------------------------------------------------------------------------
+	// filterBatch
+	// -----------------------------------------------------------------------------
+
+	/**
+	 * Filter loop for an operator pair fixed at compile time. Every selected row is written to the output slot
+	 * and the slot is advanced only if the row qualifies, so the loop has no data dependent branch.
+	 */
+	template <Operator LowOp, Operator HighOp>
+	static void filterRows(RecordBatch &batch, const int lowVal, const int highVal)
+	{
+		int numSelected = 0;
+		for (int i = 0; i < batch.numSelected; i++)
+		{
+			int row = batch.selection[i];
+			batch.selection[numSelected] = row;
+			numSelected += keyInRange<LowOp, HighOp>(batch.values[row], lowVal, highVal);
+		}
+		batch.numSelected = numSelected;
+	}
+
+	void filterBatch(RecordBatch &batch, const int lowVal, const Operator lowOp, const int highVal, const Operator highOp)
+	{
+		if ((lowOp != GT && lowOp != GTE) || (highOp != LT && highOp != LTE))
+		{
+			throw BadOpcodesException();
+		}
+		if (lowOp == GTE)
+		{
+			highOp == LT ? filterRows<GTE, LT>(batch, lowVal, highVal) : filterRows<GTE, LTE>(batch, lowVal, highVal);
+		}
+		else
+		{
+			highOp == LT ? filterRows<GT, LT>(batch, lowVal, highVal) : filterRows<GT, LTE>(batch, lowVal, highVal);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// projectBatch
+	// -----------------------------------------------------------------------------
+
+	int projectBatch(const RecordBatch &batch, RecordId *outRids, int *outValues)
+	{
+		if (outRids != nullptr)
+		{
+			for (int i = 0; i < batch.numSelected; i++)
+			{
+				outRids[i] = batch.rids[batch.selection[i]];
+			}
+		}
+		if (outValues != nullptr)
+		{
+			for (int i = 0; i < batch.numSelected; i++)
+			{
+				outValues[i] = batch.values[batch.selection[i]];
+			}
+		}
+		return batch.numSelected;
+	}
+
+	// -----------------------------------------------------------------------------
+	// aggregateBatch
+	// -----------------------------------------------------------------------------
+
+	void aggregateBatch(const RecordBatch &batch, BatchAggregate &aggregate)
+	{
+		long long sum = 0;
+		int min = aggregate.min;
+		int max = aggregate.max;
+		for (int i = 0; i < batch.numSelected; i++)
+		{
+			int value = batch.values[batch.selection[i]];
+			sum += value;
+			min = std::min(min, value);
+			max = std::max(max, value);
+		}
+		aggregate.count += batch.numSelected;
+		aggregate.sum += sum;
+		aggregate.min = min;
+		aggregate.max = max;
+	}
+
+}
@@ -0,0 +1,211 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <limits>
+#include <string>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+#include "file_iterator.h"
+#include "page_iterator.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of rows in a RecordBatch.
+ */
+const int BATCHSIZE = 1024;
+
+/**
+ * @brief Rows flowing through a batch pipeline, stored as column vectors: the record id and the INTEGER attribute
+ * of each row, and the rows still selected by the filters applied so far.
+ */
+struct RecordBatch
+{
+  /**
+   * Number of rows filled by the source.
+   */
+	int numRows;
+
+  /**
+   * Record id of each row.
+   */
+	RecordId rids[BATCHSIZE];
+
+  /**
+   * Attribute value of each row.
+   */
+	int values[BATCHSIZE];
+
+  /**
+   * Number of selected rows.
+   */
+	int numSelected;
+
+  /**
+   * Selected rows, in increasing order.
+   */
+	int selection[BATCHSIZE];
+
+  /**
+   * Select every row filled by the source.
+   */
+	void selectAll();
+};
+
+/**
+ * @brief Producer of record batches. Called once per batch rather than once per row.
+ */
+class BatchSource
+{
+ public:
+	virtual ~BatchSource() {}
+
+  /**
+   * Fill a batch with the next rows, all selected.
+   * @param batch		Batch to fill
+   * @return Number of rows filled, 0 once the source is exhausted
+   */
+	virtual int nextBatch(RecordBatch &batch) = 0;
+};
+
+/**
+ * @brief Source reading the INTEGER attribute of every record of a relation, or of a range of its pages.
+ * The attribute is read in place on the pinned page instead of through a copy of the record.
+ */
+class FileScanSource : public BatchSource
+{
+ public:
+  /**
+   * Open the relation.
+   * @param relationName		Name of the relation
+   * @param bufMgr					Buffer manager to read the pages through
+   * @param attrByteOffset	Offset of the attribute in the records
+   * @param firstPageNo			First page to read
+   * @param endPageNo				Page number to stop at; pages from firstPageNo up to, but not including, it are read
+   */
+	FileScanSource(const std::string &relationName, BufMgr *bufMgr, const int attrByteOffset,
+				   const PageId firstPageNo = 1, const PageId endPageNo = std::numeric_limits<PageId>::max());
+
+  /**
+   * Unpin the current page, flush the relation from the buffer manager and close it.
+   */
+	~FileScanSource();
+
+  /**
+   * Fill a batch with the attribute of the next records.
+   * @param batch		Batch to fill
+   * @return Number of rows filled, 0 once the relation is exhausted
+   * @throws InvalidRecordException If a record is too short to hold the attribute
+   */
+	int nextBatch(RecordBatch &batch);
+
+ private:
+	PageFile		*file;
+	BufMgr			*bufMgr;
+	int					attrByteOffset;
+
+  /**
+   * Page being read, and the page number the source stops at.
+   */
+	FileIterator	filePageIter;
+	PageId			endPageNo;
+
+  /**
+   * Pages before this one have been read ahead.
+   */
+	PageId			readAheadEnd;
+
+  /**
+   * Pinned page being read, NULL between pages, and the next record of it.
+   */
+	Page				*curPage;
+	PageIterator	pageRecordIter;
+	PageIterator	pageRecordEnd;
+};
+
+/**
+ * @brief Source returning the record ids and keys of a range of a BTreeIndex, a leaf run at a time.
+ */
+class IndexScanSource : public BatchSource
+{
+ public:
+  /**
+   * Start a scan of the index, ending any scan executing on it.
+   * @param index		Index to scan
+   * @param lowVal	Low value of range, pointer to integer
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer
+   * @param highOp	High operator (LT/LTE)
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+   */
+	IndexScanSource(BTreeIndex &index, const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp);
+
+  /**
+   * End the scan of the index, if it is still executing.
+   */
+	~IndexScanSource();
+
+	int nextBatch(RecordBatch &batch);
+
+ private:
+	BTreeIndex	&index;
+
+  /**
+   * True while the scan of the index is executing.
+   */
+	bool				scanExecuting;
+};
+
+/**
+ * @brief Running aggregates of the selected values of a stream of batches.
+ */
+struct BatchAggregate
+{
+	long long count;
+	long long sum;
+	int min;
+	int max;
+
+	BatchAggregate();
+};
+
+/**
+ * Keep selected only the rows of a batch whose value is within a range.
+ * @param batch		Batch to filter
+ * @param lowVal	Low value of range
+ * @param lowOp		Low operator (GT/GTE)
+ * @param highVal	High value of range
+ * @param highOp	High operator (LT/LTE)
+ * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+ */
+void filterBatch(RecordBatch &batch, const int lowVal, const Operator lowOp, const int highVal, const Operator highOp);
+
+/**
+ * Copy the columns of the selected rows of a batch into dense arrays.
+ * @param batch				Batch to project
+ * @param outRids			If not nullptr, array of capacity BATCHSIZE receiving the record ids
+ * @param outValues		If not nullptr, array of capacity BATCHSIZE receiving the values
+ * @return Number of rows copied
+ */
+int projectBatch(const RecordBatch &batch, RecordId *outRids, int *outValues);
+
+/**
+ * Add the selected values of a batch to running aggregates.
+ * @param batch				Batch to aggregate
+ * @param aggregate		Aggregates updated
+ */
+void aggregateBatch(const RecordBatch &batch, BatchAggregate &aggregate);
+
+}
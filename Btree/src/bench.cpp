@@ -0,0 +1,590 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Scan benchmark. Runs the integer scans of main.cpp's indexTests under each of the four (lowOp, highOp)
+ * combinations, both through BTreeIndex, with the throwing and the status returning scan calls, and as leaf filter
+ * loops comparing the run time operator check against the predicates specialized at compile time. Then runs a
+ * filtered count and sum over the relation tuple at a time and through the batch pipeline. Finally repeats lookups of
+ * one key and reads of one page, which the buffer manager serves from the frame hints of the thread. Last, builds the
+ * index serially and with the relation scanned by 1, 2, 4... workers of a TaskScheduler, up to one per core.
+ *
+ * Every measurement also reports the cycles, last level cache misses and branch misses counted by the CPU while it
+ * ran, where perf_event_open is permitted (see /proc/sys/kernel/perf_event_paranoid); otherwise they are left out.
+ *
+ * Build with "make bench"; pass optimization flags through CFLAGS, e.g. make clean; make bench CFLAGS="-std=c++0x -O2".
+ * Usage: badgerdb_bench [relation size] [repetitions]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "btree.h"
+#include "key_filter.h"
+#include "batch_pipeline.h"
+#include "page.h"
+#include "filescan.h"
+#include "task_scheduler.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Globals
+// -----------------------------------------------------------------------------
+const std::string relationName = "relBench";
+
+// This is the structure for tuples in the base relation
+
+typedef struct tuple
+{
+	int i;
+	double d;
+	char s[64];
+} RECORD;
+
+/**
+ * Scan ranges of main.cpp's intTests.
+ */
+const int scanRanges[][2] = {{25, 40}, {20, 35}, {-3, 3}, {996, 1001}, {0, 1}, {300, 400}, {3000, 4000}};
+const int numScanRanges = sizeof(scanRanges) / sizeof(scanRanges[0]);
+
+const Operator lowOps[] = {GT, GTE};
+const Operator highOps[] = {LT, LTE};
+
+BufMgr *bufMgr = new BufMgr(100);
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+typedef std::chrono::steady_clock BenchClock;
+
+/**
+ * Hardware counters of the process, counted through perf_event_open between start() and stop(). Counters the CPU
+ * could not keep scheduled all along are scaled up to the whole measurement.
+ */
+class PerfCounters
+{
+ public:
+	PerfCounters()
+	{
+#ifdef __linux__
+		const std::uint64_t events[numCounters] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES,
+												   PERF_COUNT_HW_BRANCH_MISSES};
+#endif
+		for (int i = 0; i < numCounters; i++)
+		{
+			fds[i] = -1;
+			values[i] = 0;
+#ifdef __linux__
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = events[i];
+			attr.disabled = 1;
+			attr.inherit = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+		}
+	}
+
+	~PerfCounters()
+	{
+#ifdef __linux__
+		for (int i = 0; i < numCounters; i++)
+		{
+			if (fds[i] >= 0)
+			{
+				close(fds[i]);
+			}
+		}
+#endif
+	}
+
+	void start()
+	{
+#ifdef __linux__
+		for (int i = 0; i < numCounters; i++)
+		{
+			if (fds[i] >= 0)
+			{
+				ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+				ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+#endif
+	}
+
+	void stop()
+	{
+#ifdef __linux__
+		for (int i = 0; i < numCounters; i++)
+		{
+			values[i] = 0;
+			if (fds[i] < 0)
+			{
+				continue;
+			}
+			ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+			//value, time enabled, time running
+			std::uint64_t counts[3];
+			if (read(fds[i], counts, sizeof(counts)) == sizeof(counts) && counts[2] > 0)
+			{
+				values[i] = counts[2] < counts[1] ? (std::uint64_t)((double)counts[0] * counts[1] / counts[2]) : counts[0];
+			}
+		}
+#endif
+	}
+
+	/**
+	 * Counts of the last measurement, for appending to a report line; empty if no counter could be opened.
+	 */
+	std::string describe() const
+	{
+		static const char *names[numCounters] = {"cycles", "LLC misses", "branch misses"};
+		std::string description;
+		for (int i = 0; i < numCounters; i++)
+		{
+			if (fds[i] >= 0)
+			{
+				description += "\t" + std::to_string(values[i]) + " " + names[i];
+			}
+		}
+		return description;
+	}
+
+ private:
+	static const int numCounters = 3;
+	int fds[numCounters];
+	std::uint64_t values[numCounters];
+};
+
+PerfCounters perfCounters;
+
+BenchClock::time_point startMeasurement()
+{
+	perfCounters.start();
+	return BenchClock::now();
+}
+
+double elapsedMs(BenchClock::time_point start)
+{
+	double ms = std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+	perfCounters.stop();
+	return ms;
+}
+
+const char *opName(Operator op)
+{
+	switch (op)
+	{
+	case LT:
+		return "<";
+	case LTE:
+		return "<=";
+	case GTE:
+		return ">=";
+	default:
+		return ">";
+	}
+}
+
+void report(Operator lowOp, Operator highOp, const char *method, long entries, double ms)
+{
+	std::cout << "  " << opName(lowOp) << " " << opName(highOp) << "\t" << method << "\t" << entries << " entries\t"
+			  << ms << " ms\t" << (entries > 0 ? ms * 1e6 / entries : 0) << " ns/entry" << perfCounters.describe() << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+// createRelationForward
+// -----------------------------------------------------------------------------
+
+void createRelationForward(int relationSize)
+{
+	try
+	{
+		File::remove(relationName);
+	}
+	catch (const FileNotFoundException &e)
+	{
+	}
+
+	PageFile file(relationName, true);
+	RECORD record;
+	memset(record.s, ' ', sizeof(record.s));
+	PageId pageNumber;
+	Page page = file.allocatePage(pageNumber);
+	for (int i = 0; i < relationSize; i++)
+	{
+		sprintf(record.s, "%05d string record", i);
+		record.i = i;
+		record.d = (double)i;
+		std::string data(reinterpret_cast<char *>(&record), sizeof(record));
+		RecordId rid;
+		while (!page.tryInsertRecord(data, rid))
+		{
+			file.writePage(pageNumber, page);
+			page = file.allocatePage(pageNumber);
+		}
+	}
+	file.writePage(pageNumber, page);
+}
+
+// -----------------------------------------------------------------------------
+// Index scans
+// -----------------------------------------------------------------------------
+
+void benchIndexScans(BTreeIndex &index, Operator lowOp, Operator highOp, int repetitions)
+{
+	long entries = 0;
+	BenchClock::time_point start = startMeasurement();
+	for (int r = 0; r < repetitions; r++)
+	{
+		for (int s = 0; s < numScanRanges; s++)
+		{
+			try
+			{
+				index.startScan(&scanRanges[s][0], lowOp, &scanRanges[s][1], highOp);
+			}
+			catch (const NoSuchKeyFoundException &e)
+			{
+				continue;
+			}
+			RecordId rid;
+			try
+			{
+				while (1)
+				{
+					index.scanNext(rid);
+					entries++;
+				}
+			}
+			catch (const IndexScanCompletedException &e)
+			{
+			}
+			index.endScan();
+		}
+	}
+	report(lowOp, highOp, "scanNext", entries, elapsedMs(start));
+
+	entries = 0;
+	start = startMeasurement();
+	for (int r = 0; r < repetitions; r++)
+	{
+		for (int s = 0; s < numScanRanges; s++)
+		{
+			if (!index.tryStartScan(&scanRanges[s][0], lowOp, &scanRanges[s][1], highOp))
+			{
+				continue;
+			}
+			RecordId rid;
+			while (index.tryScanNext(rid))
+			{
+				entries++;
+			}
+			index.endScan();
+		}
+	}
+	report(lowOp, highOp, "tryScanNext", entries, elapsedMs(start));
+
+	entries = 0;
+	RecordId rids[INTARRAYLEAFSIZE];
+	start = startMeasurement();
+	for (int r = 0; r < repetitions; r++)
+	{
+		for (int s = 0; s < numScanRanges; s++)
+		{
+			if (!index.tryStartScan(&scanRanges[s][0], lowOp, &scanRanges[s][1], highOp))
+			{
+				continue;
+			}
+			int numRids;
+			while ((numRids = index.scanNextBatch(rids, INTARRAYLEAFSIZE)) > 0)
+			{
+				entries += numRids;
+			}
+			index.endScan();
+		}
+	}
+	report(lowOp, highOp, "scanNextBatch", entries, elapsedMs(start));
+
+	entries = 0;
+	start = startMeasurement();
+	for (int r = 0; r < repetitions; r++)
+	{
+		for (int s = 0; s < numScanRanges; s++)
+		{
+			entries += index.countScan(&scanRanges[s][0], lowOp, &scanRanges[s][1], highOp);
+		}
+	}
+	report(lowOp, highOp, "countScan", entries, elapsedMs(start));
+}
+
+// -----------------------------------------------------------------------------
+// Leaf filter loops
+// -----------------------------------------------------------------------------
+
+template <Operator LowOp, Operator HighOp>
+long countInRangeSpecialized(const std::vector<int> &keys, int lowVal, int highVal)
+{
+	long count = 0;
+	for (std::size_t i = 0; i < keys.size(); i++)
+	{
+		count += keyInRange<LowOp, HighOp>(keys[i], lowVal, highVal);
+	}
+	return count;
+}
+
+long countInRange(const std::vector<int> &keys, Operator lowOp, int lowVal, Operator highOp, int highVal)
+{
+	if (lowOp == GTE)
+	{
+		return highOp == LT ? countInRangeSpecialized<GTE, LT>(keys, lowVal, highVal)
+							: countInRangeSpecialized<GTE, LTE>(keys, lowVal, highVal);
+	}
+	return highOp == LT ? countInRangeSpecialized<GT, LT>(keys, lowVal, highVal)
+						: countInRangeSpecialized<GT, LTE>(keys, lowVal, highVal);
+}
+
+void benchLeafFilters(BTreeIndex &index, Operator lowOp, Operator highOp, int repetitions)
+{
+	//one full leaf of consecutive keys around the scan ranges
+	std::vector<int> keys(INTARRAYLEAFSIZE);
+	for (int i = 0; i < INTARRAYLEAFSIZE; i++)
+	{
+		keys[i] = i - 10;
+	}
+
+	long entries = 0;
+	BenchClock::time_point start = startMeasurement();
+	for (int r = 0; r < repetitions; r++)
+	{
+		for (int s = 0; s < numScanRanges; s++)
+		{
+			for (std::size_t i = 0; i < keys.size(); i++)
+			{
+				entries += index.isKeyValid(scanRanges[s][0], lowOp, scanRanges[s][1], highOp, keys[i]);
+			}
+		}
+	}
+	report(lowOp, highOp, "isKeyValid loop", entries, elapsedMs(start));
+
+	entries = 0;
+	start = startMeasurement();
+	for (int r = 0; r < repetitions; r++)
+	{
+		for (int s = 0; s < numScanRanges; s++)
+		{
+			entries += countInRange(keys, lowOp, scanRanges[s][0], highOp, scanRanges[s][1]);
+		}
+	}
+	report(lowOp, highOp, "specialized loop", entries, elapsedMs(start));
+
+	entries = 0;
+	SlotFilter filter = selectSlotFilter(lowOp, highOp);
+	start = startMeasurement();
+	for (int r = 0; r < repetitions; r++)
+	{
+		for (int s = 0; s < numScanRanges; s++)
+		{
+			int first, end;
+			filter(keys.data(), keys.size(), scanRanges[s][0], scanRanges[s][1], first, end);
+			entries += end > first ? end - first : 0;
+		}
+	}
+	report(lowOp, highOp, "slot filter", entries, elapsedMs(start));
+}
+
+// -----------------------------------------------------------------------------
+// Batch pipeline
+// -----------------------------------------------------------------------------
+
+void reportAggregate(const char *method, long long count, long long sum, long rows, double ms)
+{
+	std::cout << "  " << method << "\tcount " << count << " sum " << sum << "\t" << ms << " ms\t"
+			  << (rows > 0 ? ms * 1e6 / rows : 0) << " ns/row" << perfCounters.describe() << std::endl;
+}
+
+void benchPipeline(BTreeIndex &index, int relationSize, int repetitions)
+{
+	//select count(i), sum(i) where i >= lowVal and i < highVal
+	int lowVal = relationSize / 4;
+	int highVal = relationSize / 2;
+	std::cout << "Aggregate over " << lowVal << " <= i < " << highVal << ", " << repetitions << " repetitions" << std::endl;
+
+	long long count = 0, sum = 0;
+	long rows = 0;
+	BenchClock::time_point start = startMeasurement();
+	for (int r = 0; r < repetitions; r++)
+	{
+		FileScan scanner(relationName, bufMgr);
+		RecordId rid;
+		while (scanner.tryScanNext(rid))
+		{
+			int value = *((int *)(scanner.getRecord().c_str() + offsetof(tuple, i)));
+			if (value >= lowVal && value < highVal)
+			{
+				count++;
+				sum += value;
+			}
+			rows++;
+		}
+	}
+	reportAggregate("FileScan tuple at a time", count, sum, rows, elapsedMs(start));
+
+	BatchAggregate aggregate;
+	RecordBatch *batch = new RecordBatch();
+	rows = 0;
+	start = startMeasurement();
+	for (int r = 0; r < repetitions; r++)
+	{
+		FileScanSource source(relationName, bufMgr, offsetof(tuple, i));
+		while (source.nextBatch(*batch) > 0)
+		{
+			rows += batch->numRows;
+			filterBatch(*batch, lowVal, GTE, highVal, LT);
+			aggregateBatch(*batch, aggregate);
+		}
+	}
+	reportAggregate("FileScanSource batches", aggregate.count, aggregate.sum, rows, elapsedMs(start));
+
+	aggregate = BatchAggregate();
+	rows = 0;
+	start = startMeasurement();
+	for (int r = 0; r < repetitions; r++)
+	{
+		IndexScanSource source(index, &lowVal, GTE, &highVal, LT);
+		while (source.nextBatch(*batch) > 0)
+		{
+			rows += batch->numRows;
+			aggregateBatch(*batch, aggregate);
+		}
+	}
+	reportAggregate("IndexScanSource batches", aggregate.count, aggregate.sum, rows, elapsedMs(start));
+	delete batch;
+}
+
+// -----------------------------------------------------------------------------
+// Repeated page accesses
+// -----------------------------------------------------------------------------
+
+void reportRepeated(const char *method, long operations, double ms)
+{
+	std::cout << "  " << method << "\t" << operations << " operations\t" << ms << " ms\t"
+			  << (operations > 0 ? ms * 1e6 / operations : 0) << " ns/operation\t" << bufMgr->getBufStats().hinthits
+			  << " frame hint hits" << perfCounters.describe() << std::endl;
+}
+
+void benchRepeatedAccesses(BTreeIndex &index, int repetitions)
+{
+	long operations = (long)repetitions * 100;
+	std::cout << "Repeated accesses, " << operations << " operations" << std::endl;
+
+	//the same root to leaf path every time
+	int key = 42;
+	std::vector<RecordId> rids;
+	bufMgr->clearBufStats();
+	BenchClock::time_point start = startMeasurement();
+	for (long r = 0; r < operations; r++)
+	{
+		index.find(&key, rids);
+	}
+	reportRepeated("find on one key", operations, elapsedMs(start));
+
+	PageFile file(relationName, false);
+	Page *page;
+	bufMgr->clearBufStats();
+	start = startMeasurement();
+	for (long r = 0; r < operations; r++)
+	{
+		bufMgr->readPage(&file, 1, page);
+		bufMgr->unPinPage(&file, 1, false);
+	}
+	reportRepeated("readPage and unPinPage of one page", operations, elapsedMs(start));
+	bufMgr->flushFile(&file);
+}
+
+// -----------------------------------------------------------------------------
+// Index build
+// -----------------------------------------------------------------------------
+
+void benchIndexBuild(int relationSize, int repetitions)
+{
+	std::cout << "Index build, " << repetitions << " repetitions" << std::endl;
+	unsigned numCores = std::max(1u, std::thread::hardware_concurrency());
+	//0 workers builds serially
+	for (unsigned workers = 0; workers <= numCores; workers = workers == 0 ? 1 : workers * 2)
+	{
+		std::unique_ptr<TaskScheduler> scheduler(workers > 0 ? new TaskScheduler(workers) : nullptr);
+		bufMgr->clearBufStats();
+		BenchClock::time_point start = startMeasurement();
+		for (int r = 0; r < repetitions; r++)
+		{
+			std::string indexName;
+			{
+				BTreeIndex index(relationName, indexName, bufMgr, offsetof(tuple, i), INTEGER, FLAT_LAYOUT, scheduler.get());
+			}
+			File::remove(indexName);
+		}
+		double ms = elapsedMs(start);
+		std::cout << "  " << workers << " workers	" << ms / repetitions << " ms/build	"
+				  << (ms > 0 ? (double)relationSize * repetitions / ms : 0) << " tuples/ms	"
+				  << bufMgr->getBufStats().diskreads << " disk reads" << perfCounters.describe() << std::endl;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// main
+// -----------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+	int relationSize = argc > 1 ? atoi(argv[1]) : 5000;
+	int repetitions = argc > 2 ? atoi(argv[2]) : 1000;
+
+	std::cout << "Relation of " << relationSize << " tuples, " << repetitions << " repetitions, "
+			  << keyFilterImplementation() << " key filter kernels" << std::endl;
+	createRelationForward(relationSize);
+	std::string indexName;
+	{
+		BTreeIndex index(relationName, indexName, bufMgr, offsetof(tuple, i), INTEGER);
+		for (int l = 0; l < 2; l++)
+		{
+			for (int h = 0; h < 2; h++)
+			{
+				benchIndexScans(index, lowOps[l], highOps[h], repetitions);
+				benchLeafFilters(index, lowOps[l], highOps[h], repetitions);
+			}
+		}
+		benchPipeline(index, relationSize, std::max(1, repetitions / 10));
+		benchRepeatedAccesses(index, repetitions);
+	}
+
+	File::remove(indexName);
+	benchIndexBuild(relationSize, std::max(1, repetitions / 100));
+	File::remove(relationName);
+	delete bufMgr;
+	return 0;
+}
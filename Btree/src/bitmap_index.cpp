@@ -0,0 +1,433 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "bitmap_index.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_record_exception.h"
+
+namespace badgerdb
+{
+
+	static_assert(sizeof(BitmapIndexMetaInfo) <= Page::SIZE, "Bitmap index meta info must fit in a page.");
+	static_assert(sizeof(BitmapChainPage) <= Page::SIZE, "Bitmap chain page must fit in a page.");
+
+	/**
+	 * Four bitmap words handled at once by the and/or kernels. The compiler maps operations on it
+	 * to SIMD instructions of the target, or to pairs of narrower ones when the target has no 256 bit registers.
+	 */
+	typedef std::uint64_t WordBlock __attribute__((vector_size(32)));
+
+	/**
+	 * Number of bitmap words in a WordBlock.
+	 */
+	const int WORDSPERBLOCK = sizeof(WordBlock) / sizeof(std::uint64_t);
+
+	/**
+	 * Flag of WAH fill words; literal words carry 31 bits of the bitmap instead.
+	 */
+	const std::uint32_t WAHFILLFLAG = 0x80000000;
+
+	/**
+	 * Bit of WAH fill words holding the value of the filled bits.
+	 */
+	const std::uint32_t WAHFILLVALUE = 0x40000000;
+
+	/**
+	 * Mask of the number of 31 bit groups in a WAH fill word, and of the payload of a literal word.
+	 */
+	const std::uint32_t WAHCOUNTMASK = 0x3FFFFFFF;
+	const std::uint32_t WAHLITERALMASK = 0x7FFFFFFF;
+
+	// -----------------------------------------------------------------------------
+	// Bitmap
+	// -----------------------------------------------------------------------------
+
+	Bitmap::Bitmap(int numBits)
+		: numBits(numBits),
+		  words(((numBits + 64 * WORDSPERBLOCK - 1) / (64 * WORDSPERBLOCK)) * WORDSPERBLOCK, 0)
+	{
+	}
+
+	void Bitmap::andWith(const Bitmap& other)
+	{
+		for (std::size_t i = 0; i < words.size(); i += WORDSPERBLOCK)
+		{
+			WordBlock a, b;
+			memcpy(&a, &words[i], sizeof(WordBlock));
+			memcpy(&b, &other.words[i], sizeof(WordBlock));
+			a &= b;
+			memcpy(&words[i], &a, sizeof(WordBlock));
+		}
+	}
+
+	void Bitmap::orWith(const Bitmap& other)
+	{
+		for (std::size_t i = 0; i < words.size(); i += WORDSPERBLOCK)
+		{
+			WordBlock a, b;
+			memcpy(&a, &words[i], sizeof(WordBlock));
+			memcpy(&b, &other.words[i], sizeof(WordBlock));
+			a |= b;
+			memcpy(&words[i], &a, sizeof(WordBlock));
+		}
+	}
+
+	int Bitmap::count() const
+	{
+		int total = 0;
+		for (std::size_t i = 0; i < words.size(); i++)
+		{
+			total += __builtin_popcountll(words[i]);
+		}
+		return total;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BitmapIndex::BitmapIndex -- Constructor
+	// -----------------------------------------------------------------------------
+
+	BitmapIndex::BitmapIndex(const std::string &relationName,
+							 std::string &outIndexName,
+							 BufMgr *bufMgrIn,
+							 const int attrByteOffset,
+							 const Datatype attrType)
+	{
+		bufMgr = bufMgrIn;
+		//compute indexName
+		std::ostringstream idxStr;
+		idxStr << relationName << '.' << attrByteOffset << ".bitmap";
+		outIndexName = idxStr.str();
+		try
+		{
+			file = new BlobFile(outIndexName, false);
+			//File Exists, load and check the meta page
+			Page *headerPage;
+			headerPageNum = file->getFirstPageNo();
+			bufMgr->readPage(file, headerPageNum, headerPage);
+			meta = *((BitmapIndexMetaInfo *)headerPage);
+			bufMgr->unPinPage(file, headerPageNum, false);
+			if (relationName.compare(0, sizeof(meta.relationName) - 1, meta.relationName) != 0
+				|| meta.attrByteOffset != attrByteOffset || meta.attrType != attrType)
+			{
+				bufMgr->flushFile(file);
+				delete file;
+				throw BadIndexInfoException(outIndexName);
+			}
+		}
+		catch (FileNotFoundException &e)
+		{
+			//read the attribute of every record, in page order
+			std::vector<int> attrs;
+			{
+				FileScan scanner(relationName, bufMgr);
+				RecordId currRid;
+				std::size_t length;
+				while (scanner.tryScanNext(currRid))
+				{
+					const char *record = scanner.getRecordData(length);
+					//a record too short to hold the key is not of this relation
+					if ((std::size_t)attrByteOffset + sizeof(int) > length)
+					{
+						throw InvalidRecordException(currRid, currRid.page_number);
+					}
+					ridList.push_back(currRid);
+					attrs.push_back(*((int *)(record + attrByteOffset)));
+				}
+			}
+			std::vector<int> values(attrs);
+			std::sort(values.begin(), values.end());
+			values.erase(std::unique(values.begin(), values.end()), values.end());
+			if (values.size() > (std::size_t)BITMAPMAXVALUES)
+			{
+				throw BadIndexInfoException(outIndexName);
+			}
+
+			//build one bitmap per distinct value
+			std::vector<Bitmap> bitmaps(values.size(), Bitmap(attrs.size()));
+			for (std::size_t i = 0; i < attrs.size(); i++)
+			{
+				int valueIndex = std::lower_bound(values.begin(), values.end(), attrs[i]) - values.begin();
+				bitmaps[valueIndex].words[i / 64] |= (std::uint64_t)1 << (i % 64);
+			}
+
+			file = new BlobFile(outIndexName, true);
+			Page *headerPage;
+			bufMgr->allocPage(file, headerPageNum, headerPage);
+			bufMgr->unPinPage(file, headerPageNum, true);
+
+			memset(&meta, 0, sizeof(meta));
+			strncpy(meta.relationName, relationName.c_str(), sizeof(meta.relationName) - 1);
+			meta.attrByteOffset = attrByteOffset;
+			meta.attrType = attrType;
+			meta.numRecords = attrs.size();
+			meta.numValues = values.size();
+			for (int v = 0; v < meta.numValues; v++)
+			{
+				std::vector<std::uint32_t> compressed;
+				compress(bitmaps[v], compressed);
+				meta.values[v] = values[v];
+				meta.bitmapWords[v] = compressed.size();
+				meta.bitmapPageNo[v] = writeChain(compressed);
+			}
+			std::vector<std::uint32_t> ridWords;
+			for (std::size_t i = 0; i < ridList.size(); i++)
+			{
+				ridWords.push_back(ridList[i].page_number);
+				ridWords.push_back(ridList[i].slot_number);
+			}
+			meta.ridListPageNo = writeChain(ridWords);
+
+			bufMgr->readPage(file, headerPageNum, headerPage);
+			*((BitmapIndexMetaInfo *)headerPage) = meta;
+			bufMgr->unPinPage(file, headerPageNum, true);
+			bufMgr->flushFile(file);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BitmapIndex::~BitmapIndex -- destructor
+	// -----------------------------------------------------------------------------
+
+	BitmapIndex::~BitmapIndex()
+	{
+		try
+		{
+			bufMgr->flushFile(file);
+		}
+		catch (...)
+		{
+			//the destructor must not throw; the index was written out when it was built
+		}
+		delete file;
+		file = nullptr;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BitmapIndex::writeChain
+	// -----------------------------------------------------------------------------
+
+	PageId BitmapIndex::writeChain(const std::vector<std::uint32_t>& words)
+	{
+		PageId firstPageNo = 0;
+		PageId prevPageNo = 0;
+		for (std::size_t start = 0; start < words.size(); start += BITMAPCHAINPAGESIZE)
+		{
+			PageId pageNo;
+			Page *page;
+			bufMgr->allocPage(file, pageNo, page);
+			BitmapChainPage *chainPage = (BitmapChainPage *)page;
+			chainPage->nextPageNo = 0;
+			chainPage->numWords = std::min(words.size() - start, (std::size_t)BITMAPCHAINPAGESIZE);
+			std::copy(words.begin() + start, words.begin() + start + chainPage->numWords, chainPage->words);
+			bufMgr->unPinPage(file, pageNo, true);
+			//link the page to the previous one
+			if (prevPageNo == 0)
+			{
+				firstPageNo = pageNo;
+			}
+			else
+			{
+				bufMgr->readPage(file, prevPageNo, page);
+				((BitmapChainPage *)page)->nextPageNo = pageNo;
+				bufMgr->unPinPage(file, prevPageNo, true);
+			}
+			prevPageNo = pageNo;
+		}
+		return firstPageNo;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BitmapIndex::readChain
+	// -----------------------------------------------------------------------------
+
+	void BitmapIndex::readChain(PageId pageNo, int numWords, std::vector<std::uint32_t>& words)
+	{
+		words.reserve(words.size() + numWords);
+		while (pageNo != 0 && numWords > 0)
+		{
+			Page *page;
+			bufMgr->readPage(file, pageNo, page);
+			BitmapChainPage *chainPage = (BitmapChainPage *)page;
+			words.insert(words.end(), chainPage->words, chainPage->words + chainPage->numWords);
+			numWords -= chainPage->numWords;
+			PageId nextPageNo = chainPage->nextPageNo;
+			bufMgr->unPinPage(file, pageNo, false);
+			pageNo = nextPageNo;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BitmapIndex::compress
+	// -----------------------------------------------------------------------------
+
+	void BitmapIndex::compress(const Bitmap& bitmap, std::vector<std::uint32_t>& out)
+	{
+		int numGroups = (bitmap.numBits + 30) / 31;
+		for (int g = 0; g < numGroups; g++)
+		{
+			//extract the 31 bits of the group, which may straddle two words
+			int pos = g * 31;
+			int word = pos / 64;
+			int offset = pos % 64;
+			std::uint64_t bits = bitmap.words[word] >> offset;
+			if (offset > 64 - 31 && (std::size_t)(word + 1) < bitmap.words.size())
+			{
+				bits |= bitmap.words[word + 1] << (64 - offset);
+			}
+			std::uint32_t group = bits & WAHLITERALMASK;
+			if (group != 0 && group != WAHLITERALMASK)
+			{
+				out.push_back(group);
+				continue;
+			}
+			//uniform group, extend the previous fill word when it has the same value
+			std::uint32_t fill = WAHFILLFLAG | (group == 0 ? 0 : WAHFILLVALUE);
+			if (!out.empty() && (out.back() & ~WAHCOUNTMASK) == fill && (out.back() & WAHCOUNTMASK) < WAHCOUNTMASK)
+			{
+				out.back()++;
+			}
+			else
+			{
+				out.push_back(fill | 1);
+			}
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BitmapIndex::decompress
+	// -----------------------------------------------------------------------------
+
+	void BitmapIndex::decompress(const std::vector<std::uint32_t>& in, Bitmap& bitmap)
+	{
+		std::size_t pos = 0;
+		for (std::size_t i = 0; i < in.size(); i++)
+		{
+			std::uint32_t w = in[i];
+			if (!(w & WAHFILLFLAG))
+			{
+				//literal, write its 31 bits which may straddle two words
+				std::size_t word = pos / 64;
+				int offset = pos % 64;
+				bitmap.words[word] |= (std::uint64_t)w << offset;
+				if (offset > 64 - 31 && word + 1 < bitmap.words.size())
+				{
+					bitmap.words[word + 1] |= (std::uint64_t)w >> (64 - offset);
+				}
+				pos += 31;
+				continue;
+			}
+			std::size_t end = std::min(pos + (std::size_t)(w & WAHCOUNTMASK) * 31, (std::size_t)bitmap.numBits);
+			if (w & WAHFILLVALUE)
+			{
+				//fill of ones, set whole words where possible
+				while (pos < end && pos % 64 != 0)
+				{
+					bitmap.words[pos / 64] |= (std::uint64_t)1 << (pos % 64);
+					pos++;
+				}
+				while (pos + 64 <= end)
+				{
+					bitmap.words[pos / 64] = ~(std::uint64_t)0;
+					pos += 64;
+				}
+				while (pos < end)
+				{
+					bitmap.words[pos / 64] |= (std::uint64_t)1 << (pos % 64);
+					pos++;
+				}
+			}
+			pos = end;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BitmapIndex::orValueBitmap
+	// -----------------------------------------------------------------------------
+
+	void BitmapIndex::orValueBitmap(int valueIndex, Bitmap& out)
+	{
+		std::vector<std::uint32_t> compressed;
+		readChain(meta.bitmapPageNo[valueIndex], meta.bitmapWords[valueIndex], compressed);
+		decompress(compressed, out);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BitmapIndex::equals
+	// -----------------------------------------------------------------------------
+
+	void BitmapIndex::equals(const void* value, Bitmap& out)
+	{
+		out = Bitmap(meta.numRecords);
+		const int *valuesBegin = meta.values;
+		const int *valuesEnd = valuesBegin + meta.numValues;
+		const int *match = std::lower_bound(valuesBegin, valuesEnd, *((int *)value));
+		if (match != valuesEnd && *match == *((int *)value))
+		{
+			orValueBitmap(match - valuesBegin, out);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BitmapIndex::range
+	// -----------------------------------------------------------------------------
+
+	void BitmapIndex::range(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp, Bitmap& out)
+	{
+		if ((lowOp != GT && lowOp != GTE) || (highOp != LT && highOp != LTE))
+		{
+			throw BadOpcodesException();
+		}
+		int low = *((int *)lowVal);
+		int high = *((int *)highVal);
+		out = Bitmap(meta.numRecords);
+		for (int v = 0; v < meta.numValues; v++)
+		{
+			int value = meta.values[v];
+			bool aboveLow = lowOp == GTE ? value >= low : value > low;
+			bool belowHigh = highOp == LTE ? value <= high : value < high;
+			if (aboveLow && belowHigh)
+			{
+				orValueBitmap(v, out);
+			}
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BitmapIndex::getRecordIds
+	// -----------------------------------------------------------------------------
+
+	void BitmapIndex::getRecordIds(const Bitmap& bitmap, std::vector<RecordId>& outRids)
+	{
+		if ((int)ridList.size() != meta.numRecords)
+		{
+			std::vector<std::uint32_t> ridWords;
+			readChain(meta.ridListPageNo, meta.numRecords * 2, ridWords);
+			ridList.resize(meta.numRecords);
+			for (int i = 0; i < meta.numRecords; i++)
+			{
+				ridList[i].page_number = ridWords[2 * i];
+				ridList[i].slot_number = ridWords[2 * i + 1];
+				ridList[i].padding = 0;
+			}
+		}
+		//bit positions follow page order, so visiting set bits in order yields RecordIds in page order
+		for (std::size_t i = 0; i < bitmap.words.size(); i++)
+		{
+			std::uint64_t w = bitmap.words[i];
+			while (w != 0)
+			{
+				outRids.push_back(ridList[i * 64 + __builtin_ctzll(w)]);
+				w &= w - 1;
+			}
+		}
+	}
+
+}
@@ -0,0 +1,288 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Maximum number of distinct values of an attribute indexed by a BitmapIndex.
+ */
+const int BITMAPMAXVALUES = 256;
+
+/**
+ * @brief Number of 32 bit words stored in a page of a bitmap index word chain.
+ */
+//                                                    next ptr          numWords
+const int BITMAPCHAINPAGESIZE = ( Page::SIZE - sizeof( PageId ) - sizeof( int ) ) / sizeof( std::uint32_t );
+
+/**
+ * @brief The meta page of a bitmap index file, always the first page of the file.
+ * Holds, for every distinct value, where its WAH compressed bitmap is stored.
+ */
+struct BitmapIndexMetaInfo{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Offset of attribute, over which index is built, inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute over which index is built.
+   */
+	Datatype attrType;
+
+  /**
+   * Number of records in the relation, which is the length of every bitmap in bits.
+   */
+	int numRecords;
+
+  /**
+   * Number of distinct values of the attribute.
+   */
+	int numValues;
+
+  /**
+   * First page of the chain storing the RecordId of every bit position, in page order.
+   */
+	PageId ridListPageNo;
+
+  /**
+   * Distinct values, in increasing order.
+   */
+	int values[ BITMAPMAXVALUES ];
+
+  /**
+   * First page of the chain storing the compressed bitmap of each value.
+   */
+	PageId bitmapPageNo[ BITMAPMAXVALUES ];
+
+  /**
+   * Number of WAH words of the compressed bitmap of each value.
+   */
+	int bitmapWords[ BITMAPMAXVALUES ];
+};
+
+/**
+ * @brief Structure of the pages of a chain of 32 bit words, used for compressed bitmaps and for the RecordId list.
+*/
+struct BitmapChainPage{
+  /**
+   * Page number of the next page of the chain, 0 if none.
+   */
+	PageId nextPageNo;
+
+  /**
+   * Number of used words.
+   */
+	int numWords;
+
+  /**
+   * Stores words.
+   */
+	std::uint32_t words[ BITMAPCHAINPAGESIZE ];
+};
+
+/**
+ * @brief Uncompressed bitmap over the bit positions (records) of a BitmapIndex.
+ * Predicates are combined with and/or kernels working on several words at a time.
+ */
+class Bitmap {
+ public:
+  /**
+   * Construct an empty bitmap of the given length.
+   * @param numBits		Length of the bitmap in bits
+   */
+	explicit Bitmap(int numBits = 0);
+
+  /**
+   * Keep only the bits also set in other.
+   * @param other		Bitmap of the same length
+   */
+	void andWith(const Bitmap& other);
+
+  /**
+   * Add the bits set in other.
+   * @param other		Bitmap of the same length
+   */
+	void orWith(const Bitmap& other);
+
+  /**
+   * Number of bits set.
+   */
+	int count() const;
+
+  /**
+   * Length of the bitmap in bits.
+   */
+	int size() const { return numBits; }
+
+  /**
+   * Whether the bit at the given position is set.
+   */
+	bool test(int pos) const { return (words[pos / 64] >> (pos % 64)) & 1; }
+
+ private:
+	friend class BitmapIndex;
+
+  /**
+   * Length of the bitmap in bits.
+   */
+	int numBits;
+
+  /**
+   * Bits, 64 per word, padded with zero bits to a multiple of four words.
+   */
+	std::vector<std::uint64_t> words;
+};
+
+/**
+ * @brief BitmapIndex class. It implements a bitmap index on a low cardinality INTEGER attribute of a relation:
+ * one bitmap per distinct value over the records of the relation in page order, stored WAH (word aligned hybrid)
+ * compressed in a BlobFile. The index is built once from the relation and is read only afterwards.
+*/
+class BitmapIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * In-memory copy of the meta page.
+   */
+	BitmapIndexMetaInfo	meta;
+
+  /**
+   * RecordId of every bit position, loaded from the index file on first use.
+   */
+	std::vector<RecordId>	ridList;
+
+  /**
+   * Write words to a new chain of pages.
+   * @param words		Words to write
+   * @return Page number of the first page of the chain, 0 if there are no words
+   */
+	PageId writeChain(const std::vector<std::uint32_t>& words);
+
+  /**
+   * Read the given number of words from a chain of pages.
+   * @param pageNo		First page of the chain
+   * @param numWords	Number of words to read
+   * @param words			Words are appended to this
+   */
+	void readChain(PageId pageNo, int numWords, std::vector<std::uint32_t>& words);
+
+  /**
+   * WAH compress a bitmap into 31 bit literal and fill words.
+   * @param bitmap		Bitmap to compress
+   * @param out				Compressed words are appended to this
+   */
+	static void compress(const Bitmap& bitmap, std::vector<std::uint32_t>& out);
+
+  /**
+   * Decompress WAH words into a bitmap, setting the bits they hold.
+   * @param in				Compressed words
+   * @param bitmap		Bitmap to decompress into, already sized
+   */
+	static void decompress(const std::vector<std::uint32_t>& in, Bitmap& bitmap);
+
+  /**
+   * Load and decompress the bitmap of the value at the given position of the value array, OR-ing it into out.
+   */
+	void orValueBitmap(int valueIndex, Bitmap& out);
+
+ public:
+
+  /**
+   * BitmapIndex Constructor.
+	 * Check to see if the corresponding index file exists. If so, open the file.
+	 * If not, create it and build a bitmap for every distinct value of the attribute using FileScan class.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters,
+   *                                    or if the attribute has more than BITMAPMAXVALUES distinct values.
+   * @throws  InvalidRecordException    If a record of the relation is too short to hold the attribute.
+   */
+	BitmapIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+
+  /**
+   * BitmapIndex Destructor.
+	 * Flush the index file from the buffer manager and delete the file instance thereby closing the index file.
+	 * Does not throw; a failed flush is swallowed.
+	 */
+	~BitmapIndex();
+
+  /**
+   * Get the bitmap of the records whose attribute equals the given value.
+   * @param value		Value, pointer to integer
+   * @param out			Bitmap returned in this; empty if the value does not occur
+   */
+	void equals(const void* value, Bitmap& out);
+
+  /**
+   * Get the bitmap of the records whose attribute is within the given range.
+   * @param lowVal	Low value of range, pointer to integer
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer
+   * @param highOp	High operator (LT/LTE)
+   * @param out			Bitmap returned in this
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   */
+	void range(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp, Bitmap& out);
+
+  /**
+   * Get the RecordIds of the records set in a bitmap, in page order.
+   * @param bitmap	Bitmap obtained from this index, possibly combined with others
+   * @param outRids	RecordIds are appended to this
+   */
+	void getRecordIds(const Bitmap& bitmap, std::vector<RecordId>& outRids);
+
+  /**
+   * Number of records covered by the index.
+   */
+	int numRecords() const { return meta.numRecords; }
+
+  /**
+   * Number of distinct values of the indexed attribute.
+   */
+	int numValues() const { return meta.numValues; }
+};
+
+}
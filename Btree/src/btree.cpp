@@ -5,8 +5,14 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <iterator>
+#include <vector>
 #include "btree.h"
 #include "filescan.h"
+#include "key_filter.h"
+#include "probes.h"
+#include "task_scheduler.h"
 #include "exceptions/bad_index_info_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/bad_scanrange_exception.h"
@@ -14,7 +20,7 @@
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/index_scan_completed_exception.h"
 #include "exceptions/file_not_found_exception.h"
-#include "exceptions/end_of_file_exception.h"
+#include "exceptions/invalid_record_exception.h"
 
 //#define DEBUG
 
@@ -34,21 +40,30 @@ namespace badgerdb
    * @param bufMgrIn						Buffer Manager Instance
    * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
    * @param attrType						Datatype of attribute over which index is built
+   * @param layout							Key layout of the non-leaf nodes, used when the index file is created
+   * @param scheduler						If not nullptr, scheduler whose workers scan the relation when the index file is created
+   * @param compression				Whether the pages of the index file are stored compressed, used when the index file is created
    * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   * @throws  InvalidRecordException    If a record of the relation is too short to hold the attribute. The partly built index file is removed.
    */
 	BTreeIndex::BTreeIndex(const std::string &relationName,
 						   std::string &outIndexName,
 						   BufMgr *bufMgrIn,
 						   const int attrByteOffset,
-						   const Datatype attrType)
+						   const Datatype attrType,
+						   const NonLeafLayout layout,
+						   TaskScheduler *scheduler,
+						   const FileCompression compression)
 	{
 		//set index fields
 		bufMgr = bufMgrIn;
 		attributeType = attrType;
 		this->attrByteOffset = attrByteOffset;
-		nodeOccupancy = INTARRAYNONLEAFSIZE;
+		nonLeafLayout = layout;
 		leafOccupancy = INTARRAYLEAFSIZE;
 		scanExecuting = false;
+		treeScanDone = true;
+		deltaBufferBudget = 0;
 		//compute indexName
 		std::ostringstream idxStr;
 		idxStr << relationName << '.' << attrByteOffset;
@@ -60,28 +75,42 @@ namespace badgerdb
 			//File Exists
 			//get metadata
 			Page *headerPage;
-			bufMgr->readPage(file, file->getFirstPageNo(), headerPage);
+			headerPageNum = file->getFirstPageNo();
+			bufMgr->readPage(file, headerPageNum, headerPage);
 			IndexMetaInfo *header = (IndexMetaInfo *)headerPage;
+			bool matches = relationName.compare(0, sizeof(header->relationName) - 1, header->relationName) == 0
+				&& header->attrByteOffset == attrByteOffset && header->attrType == attrType;
 			rootPageNum = header->rootPageNo;
-			bufMgr->unPinPage(file, file->getFirstPageNo(), false);
+			nonLeafLayout = header->nonLeafLayout;
+			nodeOccupancy = nonLeafLayout == BLOCKED_LAYOUT ? INTBLOCKEDNONLEAFSIZE : INTARRAYNONLEAFSIZE;
+			bufMgr->unPinPage(file, headerPageNum, false);
+			if (!matches)
+			{
+				bufMgr->flushFile(file);
+				delete file;
+				throw BadIndexInfoException(outIndexName);
+			}
+			nodeSwips.resize(file->getNumPages());
 		}
 		catch (FileNotFoundException &e)
 		{
 			//File Does Not Exist
 			//set fields
-			file = new BlobFile(outIndexName, true);
+			file = new BlobFile(outIndexName, true, compression);
             //allocate pages
 			Page *headerPage;
 			Page *rootPage;
 			bufMgr->allocPage(file, headerPageNum, headerPage);
-			bufMgr->allocPage(file, rootPageNum, rootPage);
+			allocNode(rootPageNum, rootPage);
 
 			//create header with index meta data
-			IndexMetaInfo *header = new IndexMetaInfo();
-			strcpy(header->relationName, relationName.c_str());
+			nodeOccupancy = nonLeafLayout == BLOCKED_LAYOUT ? INTBLOCKEDNONLEAFSIZE : INTARRAYNONLEAFSIZE;
+			IndexMetaInfo *header = (IndexMetaInfo *)headerPage;
+			strncpy(header->relationName, relationName.c_str(), sizeof(header->relationName) - 1);
 			header->attrByteOffset = attrByteOffset;
 			header->attrType = attrType;
 			header->rootPageNo = rootPageNum;
+			header->nonLeafLayout = nonLeafLayout;
 
 			LeafNodeInt *root = (LeafNodeInt *)rootPage;
 			root->rightSibPageNo = 0;
@@ -90,21 +119,102 @@ namespace badgerdb
 			bufMgr->unPinPage(file, headerPageNum, true);
 			bufMgr->unPinPage(file, rootPageNum, true);
 			//TODO: scan relation
-			FileScan *scanner = new FileScan(relationName, bufMgr);
-			RecordId currRid;
 			try
 			{
-				while (1)
+				if (scheduler != nullptr)
 				{
-					scanner->scanNext(currRid);
-					insertEntry(scanner->getRecord().c_str() + attrByteOffset, currRid);
+					insertRelationParallel(relationName, scheduler);
+				}
+				else
+				{
+					FileScan scanner(relationName, bufMgr);
+					RecordId currRid;
+					while (scanner.tryScanNext(currRid))
+					{
+						std::size_t length;
+						const char *record = scanner.getRecordData(length);
+						//a record too short to hold the key is not of this relation
+						if ((std::size_t)attrByteOffset + sizeof(int) > length)
+						{
+							throw InvalidRecordException(currRid, currRid.page_number);
+						}
+						insertEntry(record + attrByteOffset, currRid);
+					}
 				}
 			}
-			catch (EndOfFileException &e)
+			catch (...)
 			{
-				//save file to disk
+				//drop the partly built index, so that it is not reopened as a whole one
 				bufMgr->flushFile(file);
+				delete file;
+				File::remove(outIndexName);
+				throw;
 			}
+			//save file to disk
+			bufMgr->flushFile(file);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertRelationParallel
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::insertRelationParallel(const std::string &relationName, TaskScheduler *scheduler)
+	{
+		PageId numPages;
+		{
+			PageFile relation(relationName, false);
+			numPages = relation.getNumPages();
+		}
+		//relation pages are numbered from 1
+		std::vector<std::vector<RIDKeyPair<int> > > morsels((numPages + MORSELPAGES - 1) / MORSELPAGES);
+		int offset = attrByteOffset;
+		BufMgr *pool = bufMgr;
+		TaskGroup group;
+		scheduler->parallelFor(group, 1, numPages, MORSELPAGES,
+			[&morsels, &relationName, offset, pool](PageId first, PageId end)
+			{
+				std::vector<RIDKeyPair<int> > &entries = morsels[(first - 1) / MORSELPAGES];
+				FileScan scanner(relationName, pool, first, end);
+				RecordId currRid;
+				RIDKeyPair<int> entry;
+				std::size_t length;
+				while (scanner.tryScanNext(currRid))
+				{
+					const char *record = scanner.getRecordData(length);
+					if ((std::size_t)offset + sizeof(int) > length)
+					{
+						throw InvalidRecordException(currRid, currRid.page_number);
+					}
+					entry.set(currRid, *((int *)(record + offset)));
+					entries.push_back(entry);
+				}
+			});
+		scheduler->wait(group);
+		//the gathered entries are accounted for until their morsel is inserted
+		std::size_t gatheredBytes = 0;
+		for (std::size_t m = 0; m < morsels.size(); m++)
+		{
+			gatheredBytes += morsels[m].capacity() * sizeof(RIDKeyPair<int>);
+		}
+		MemoryTracker::process().charge(MEMORY_SCANS, gatheredBytes);
+		try
+		{
+			for (std::size_t m = 0; m < morsels.size(); m++)
+			{
+				for (std::size_t i = 0; i < morsels[m].size(); i++)
+				{
+					insertEntry(&morsels[m][i].key, morsels[m][i].rid);
+				}
+				gatheredBytes -= morsels[m].capacity() * sizeof(RIDKeyPair<int>);
+				MemoryTracker::process().release(MEMORY_SCANS, morsels[m].capacity() * sizeof(RIDKeyPair<int>));
+				std::vector<RIDKeyPair<int> >().swap(morsels[m]);
+			}
+		}
+		catch (...)
+		{
+			MemoryTracker::process().release(MEMORY_SCANS, gatheredBytes);
+			throw;
 		}
 	}
 
@@ -121,7 +231,21 @@ namespace badgerdb
 	BTreeIndex::~BTreeIndex()
 	{
 		scanExecuting = false;
-		bufMgr->flushFile(BTreeIndex::file);
+		try
+		{
+			//apply any inserts still held in memory before writing the index out
+			if (!deltaBuffer.empty())
+			{
+				mergeDeltaBuffer();
+			}
+			bufMgr->flushFile(BTreeIndex::file);
+		}
+		catch (...)
+		{
+			//inserts the merge did not reach are lost with the buffer
+			MemoryTracker::process().release(MEMORY_DELTABUFFER, deltaBuffer.size() * DELTABUFFERENTRYSIZE);
+			deltaBuffer.clear();
+		}
 		delete file;
 		file = nullptr;
 	}
@@ -142,8 +266,39 @@ namespace badgerdb
 	{	
 		RIDKeyPair<int> entry;
 		entry.set(rid, *((int *) key));
+		//absorb the insert in the delta buffer if it is enabled
+		if (deltaBufferBudget > 0)
+		{
+			//past the memory budget of the process, the buffer is merged early, unless a scan is walking it
+			if (!MemoryTracker::process().tryReserve(MEMORY_DELTABUFFER, DELTABUFFERENTRYSIZE))
+			{
+				if (!scanExecuting)
+				{
+					mergeDeltaBuffer();
+					insertIntoTree(entry);
+					return;
+				}
+				MemoryTracker::process().charge(MEMORY_DELTABUFFER, DELTABUFFERENTRYSIZE);
+			}
+			deltaBuffer.insert(entry);
+			//merge once the budget is reached, unless a scan is walking the buffer
+			if (!scanExecuting && deltaBuffer.size() * DELTABUFFERENTRYSIZE >= deltaBufferBudget)
+			{
+				mergeDeltaBuffer();
+			}
+			return;
+		}
+		insertIntoTree(entry);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertIntoTree
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::insertIntoTree(RIDKeyPair<int> entry)
+	{
 		//set current page number & data to root
-		bufMgr->readPage(file, rootPageNum, currentPageData);
+		readNode(rootPageNum, currentPageData);
 		currentPageNum = rootPageNum;
         bool isLeaf = false;
 		PageKeyPair<int> *newEntry = nullptr;
@@ -186,7 +341,7 @@ namespace badgerdb
             PageId nextPageNum;
             Page *nextPage;
             findNextNonLeaf(curr, nextPageNum, entry.key);
-            bufMgr->readPage(file, nextPageNum, nextPage);
+            readNode(nextPageNum, nextPage);
 			NonLeafNodeInt * nextNode = (NonLeafNodeInt *) nextPage;
 			if (nextNode->level == 1)
 			{
@@ -226,11 +381,12 @@ namespace badgerdb
         Page * newPage;
         PageId newPageId;
         PageKeyPair<int> newParentEntry;
-        bufMgr->allocPage(file, newPageId, newPage);
+        allocNode(newPageId, newPage);
+        BADGERDB_PROBE2(split_nonleaf, currPageId, newPageId);
         NonLeafNodeInt *newNode = (NonLeafNodeInt *)newPage;
         newNode->level = 0;
         int midIndex = nodeOccupancy/2;
-        int newParentIndex;
+        int newParentIndex = midIndex;
         //if capacity is even,
         if (nodeOccupancy%2 == 0)
         {
@@ -251,16 +407,17 @@ namespace badgerdb
             int newIndex = i - midIndex;
             //fill the right (new) node & remove those entries from the left (curr) node
             newNode->keyArray[newIndex] = currNode->keyArray[i];
-			currNode->keyArray[i+1] = 0;
-            newNode->pageNoArray[newIndex] = currNode->pageNoArray[i+1];
-            currNode->pageNoArray[i+1] = 0;
+			currNode->keyArray[i] = 0;
+            newNode->pageNoArray[newIndex] = currNode->pageNoArray[i];
+            currNode->pageNoArray[i] = 0;
         }
-        //remove new parent entry from the left node
-        currNode->pageNoArray[newParentIndex] = 0;
+        newNode->pageNoArray[nodeOccupancy - midIndex] = currNode->pageNoArray[nodeOccupancy];
+        currNode->pageNoArray[nodeOccupancy] = 0;
+        //remove new parent entry from the left node, which keeps the child to its left
         currNode->keyArray[newParentIndex] = 0;
         NonLeafNodeInt * newParent;
         //if the new parent entry belongs in the left node
-        if (newEntry->key < newNode->keyArray[0])
+        if (newEntry->key < newParentEntry.key)
         {
             newParent = currNode;
         }
@@ -268,7 +425,10 @@ namespace badgerdb
             newParent = newNode;
         }
         insertNonLeaf(newParent, newEntry);
-        newEntry = &newParentEntry;
+        buildNodeDirectory(currNode);
+        buildNodeDirectory(newNode);
+        //pass the separator up in the entry set by the leaf split, which the parent consumes
+        *newEntry = newParentEntry;
         //write pages to the disk
         bufMgr->unPinPage(file, newPageId, true);
         bufMgr->unPinPage(file, currPageId, true);
@@ -323,23 +483,49 @@ namespace badgerdb
 	void BTreeIndex::insertNonLeaf(NonLeafNodeInt *nonleaf, PageKeyPair<int> *entry) {
 		int last = nodeOccupancy;
 
-		for(int i = last; i >= 0; i--) {
-			if(nonleaf->pageNoArray[last] == 0) {
-				last--;
-			}
+		//last is the number of used keys
+		while(last > 0 && nonleaf->pageNoArray[last] == 0) {
+			last--;
 		}
 		
-		for(int i = last; i >= 0; i--) {
-			if(nonleaf->keyArray[last-1] > entry->key) {
-				nonleaf->keyArray[last] = nonleaf->keyArray[last-1];
-    			nonleaf->pageNoArray[last+1] = nonleaf->pageNoArray[last];
-    			last--;
-			}
-		}	
+		//stop at the first key, a key smaller than all others must not be compared with the level before keyArray
+		while(last > 0 && nonleaf->keyArray[last-1] > entry->key) {
+			nonleaf->keyArray[last] = nonleaf->keyArray[last-1];
+			nonleaf->pageNoArray[last+1] = nonleaf->pageNoArray[last];
+			last--;
+		}
 				
 		// insert nonleaf
 		nonleaf->keyArray[last] = entry->key;
 		nonleaf->pageNoArray[last+1] = entry->pageNo;		
+		buildNodeDirectory(nonleaf);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::buildNodeDirectory
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::buildNodeDirectory(NonLeafNodeInt *node)
+	{
+		if (nonLeafLayout != BLOCKED_LAYOUT)
+		{
+			return;
+		}
+		//a node with n used children has n - 1 used keys
+		int numKeys = nodeOccupancy;
+		while (numKeys > 0 && node->pageNoArray[numKeys] == 0)
+		{
+			numKeys--;
+		}
+		//padding never compares smaller than a search key, so blocks can be searched without knowing how many keys are used
+		for (int i = numKeys; i < nodeOccupancy; i++)
+		{
+			node->keyArray[i] = std::numeric_limits<int>::max();
+		}
+		for (int block = 0; block < INTBLOCKEDNONLEAFBLOCKS; block++)
+		{
+			node->keyArray[nodeOccupancy + block] = node->keyArray[block * NONLEAFBLOCKKEYS + NONLEAFBLOCKKEYS - 1];
+		}
 	}
 	
 	// -----------------------------------------------------------------------------
@@ -350,7 +536,7 @@ namespace badgerdb
 	{
 		Page *root;
 		PageId rootId;
-		bufMgr->allocPage(file, rootId, root);
+		allocNode(rootId, root);
 		NonLeafNodeInt *newRoot = (NonLeafNodeInt *)root;
 		
 		//Set key & pointers
@@ -358,12 +544,14 @@ namespace badgerdb
 		newRoot->pageNoArray[0] = firstRootPage;
 		newRoot->pageNoArray[1] = newEntry->pageNo;
 		newRoot->level = 0;
+		buildNodeDirectory(newRoot);
 
 		//update root page number
 		Page *mPage;
 		bufMgr->readPage(file, headerPageNum, mPage);
 		IndexMetaInfo *meta = (IndexMetaInfo *)mPage;
 		meta->rootPageNo = rootId;
+		BADGERDB_PROBE2(root_change, rootPageNum, rootId);
 		rootPageNum = rootId;
 
 		bufMgr->unPinPage(file, headerPageNum, true);
@@ -378,11 +566,12 @@ namespace badgerdb
 	{
 		Page *page;
 		PageId pageNum;
-		bufMgr->allocPage(file, pageNum, page);
+		allocNode(pageNum, page);
+		BADGERDB_PROBE2(split_leaf, leafPId, pageNum);
 		LeafNodeInt *newLeaf = (LeafNodeInt *)page;
 		newLeaf->level = 1;
-		newEntry = new PageKeyPair<int>();
-		PageKeyPair<int> newPair;
+		//the separator lives in the index rather than on the heap, as one insert runs at a time
+		newEntry = &splitSeparator;
 
 		int center = leafOccupancy/2;
 		if(entry.key > leaf->keyArray[center] && leafOccupancy % 2 == 1){
@@ -404,8 +593,7 @@ namespace badgerdb
 		else{
 			insertLeaf(leaf, entry);
 		}
-		newPair.set(pageNum, newLeaf->keyArray[0]);
-		newEntry = &newPair;
+		newEntry->set(pageNum, newLeaf->keyArray[0]);
 		bufMgr->unPinPage(file, pageNum, true);
 		bufMgr->unPinPage(file, leafPId, true);
 		if(rootPageNum == leafPId){
@@ -413,6 +601,80 @@ namespace badgerdb
 		}
 	}
 
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::enableDeltaBuffer
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::enableDeltaBuffer(const std::size_t budgetBytes)
+	{
+		deltaBufferBudget = budgetBytes;
+		//a zero budget disables the buffer, so nothing may stay behind in it
+		if (deltaBufferBudget == 0 && !deltaBuffer.empty())
+		{
+			mergeDeltaBuffer();
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::mergeDeltaBuffer
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::mergeDeltaBuffer()
+	{
+		if (scanExecuting)
+		{
+			endScan();
+		}
+		std::multiset<RIDKeyPair<int> >::const_iterator it = deltaBuffer.begin();
+		while (it != deltaBuffer.end())
+		{
+			//descend to the leaf holding the next key, remembering the separator bounding it on the right
+			PageId pageNum = rootPageNum;
+			Page *page;
+			readNode(pageNum, page);
+			bool bounded = false;
+			int fence = 0;
+			while (((NonLeafNodeInt *)page)->level != 1)
+			{
+				NonLeafNodeInt *node = (NonLeafNodeInt *)page;
+				int childIndex = findChildIndex(node, it->key);
+				if (childIndex < nodeOccupancy && node->pageNoArray[childIndex + 1] != 0)
+				{
+					bounded = true;
+					fence = node->keyArray[childIndex];
+				}
+				PageId childNum = node->pageNoArray[childIndex];
+				bufMgr->unPinPage(file, pageNum, false);
+				pageNum = childNum;
+				readNode(pageNum, page);
+			}
+			//fill the leaf with every buffered key it owns while it has room
+			LeafNodeInt *leaf = (LeafNodeInt *)page;
+			int used = 0;
+			while (used < leafOccupancy && leaf->ridArray[used].page_number != 0)
+			{
+				used++;
+			}
+			int inserted = 0;
+			while (it != deltaBuffer.end() && used < leafOccupancy && (!bounded || it->key <= fence))
+			{
+				insertLeaf(leaf, *it);
+				used++;
+				inserted++;
+				it = deltaBuffer.erase(it);
+				MemoryTracker::process().release(MEMORY_DELTABUFFER, DELTABUFFERENTRYSIZE);
+			}
+			bufMgr->unPinPage(file, pageNum, inserted > 0);
+			//the leaf is full, so the next key goes through the regular path which splits it
+			if (inserted == 0)
+			{
+				insertIntoTree(*it);
+				it = deltaBuffer.erase(it);
+				MemoryTracker::process().release(MEMORY_DELTABUFFER, DELTABUFFERENTRYSIZE);
+			}
+		}
+	}
+
 	// -----------------------------------------------------------------------------
 	// BTreeIndex::startScan
 	// -----------------------------------------------------------------------------
@@ -435,6 +697,21 @@ namespace badgerdb
 							   const Operator lowOpParm,
 							   const void *highValParm,
 							   const Operator highOpParm)
+	{
+		if (!tryStartScan(lowValParm, lowOpParm, highValParm, highOpParm))
+		{
+			throw NoSuchKeyFoundException();
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::tryStartScan
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::tryStartScan(const void *lowValParm,
+								  const Operator lowOpParm,
+								  const void *highValParm,
+								  const Operator highOpParm)
 	{
 		//set range values
 		lowValInt = *((int *) lowValParm);
@@ -453,14 +730,63 @@ namespace badgerdb
 		//set operator values
 		highOp = highOpParm;
 		lowOp = lowOpParm;
+		slotFilter = selectSlotFilter(lowOp, highOp);
 		//end scan if it has already started
 		if (scanExecuting)
 		{
 			endScan();
 		}
+		BADGERDB_PROBE2(scan_start, lowValInt, highValInt);
+		//find the range of buffered entries satisfying the scan
+		RIDKeyPair<int> bound;
+		RecordId lowestRid = {0, 0, 0};
+		RecordId highestRid = {std::numeric_limits<PageId>::max(), 0, 0};
+		if (lowOp == GTE)
+		{
+			bound.set(lowestRid, lowValInt);
+			deltaScanIter = deltaBuffer.lower_bound(bound);
+		}
+		else
+		{
+			bound.set(highestRid, lowValInt);
+			deltaScanIter = deltaBuffer.upper_bound(bound);
+		}
+		if (highOp == LTE)
+		{
+			bound.set(highestRid, highValInt);
+			deltaScanEnd = deltaBuffer.upper_bound(bound);
+		}
+		else
+		{
+			bound.set(lowestRid, highValInt);
+			deltaScanEnd = deltaBuffer.lower_bound(bound);
+		}
+		//position the tree side of the scan
+		if (startTreeScan())
+		{
+			treeScanDone = false;
+			return true;
+		}
+		//the key may still be waiting in the delta buffer
+		if (deltaScanIter == deltaScanEnd)
+		{
+			return false;
+		}
+		treeScanDone = true;
+		currentPageData = nullptr;
+		scanExecuting = true;
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::startTreeScan
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::startTreeScan()
+	{
 		//start scan
 		currentPageNum = rootPageNum;
-		bufMgr->readPage(file, currentPageNum, currentPageData);
+		readNode(currentPageNum, currentPageData);
 		NonLeafNodeInt *curr = (NonLeafNodeInt *)currentPageData;
 		//if the root is not a leaf
 		if (curr->level != 1)
@@ -475,7 +801,7 @@ namespace badgerdb
 				bufMgr->unPinPage(file, currentPageNum, false);
 				currentPageNum = nextPageNum;
 				//read the page
-				bufMgr->readPage(file, currentPageNum, currentPageData);
+				readNode(currentPageNum, currentPageData);
 				//cast page as a non leaf node
 				curr = (NonLeafNodeInt *)currentPageData;
 				//check if page is leaf
@@ -486,56 +812,27 @@ namespace badgerdb
 			}
 		}
 		//find first entry to scan
-		bool entryFound = false;
-		while (!entryFound)
+		while (true)
 		{
 			//cast page to leaf node
 			LeafNodeInt *curr = (LeafNodeInt *)currentPageData;
-			//if entire page is empty, the key is not in the B+ tree
-			if (curr->ridArray[0].page_number == 0)
+			int first = filterLeaf(curr);
+			//starting entry has been found
+			if (first < currentLeafEnd)
 			{
-				bufMgr->unPinPage(file, currentPageNum, false);
-				throw NoSuchKeyFoundException();
+				scanExecuting = true;
+				nextEntry = first;
+				return true;
 			}
-			//else search node from left to right
-			bool isNull = false;
-			for (int i = 0; i < leafOccupancy && !isNull; i++)
+			bufMgr->unPinPage(file, currentPageNum, false);
+			//the first key not below the range is above it, or this is the last leaf: the key is not in the B+ tree
+			if (first < leafSize(curr) || curr->rightSibPageNo == 0)
 			{
-				//if current entry is null, set isNull to true
-				if (i < leafOccupancy - 1 && curr->ridArray[i + 1].page_number == 0)
-				{
-					isNull = true;
-				}
-				//check if current entry's key is within range
-				int key = curr->keyArray[i];
-				if (isKeyValid(lowValInt, lowOp, highValInt, highOp, key))
-				{
-					//starting entry has been found
-					entryFound = true;
-					scanExecuting = true;
-					nextEntry = i;
-					break;
-				}
-				//check operator edge cases
-				else if ((highOp == LTE && key > highValInt) || (highOp == LT && key >= highValInt))
-				{
-					bufMgr->unPinPage(file, currentPageNum, false);
-					throw NoSuchKeyFoundException();
-				}
-				//if we've reached the end of the current leaf
-				if (isNull || i == leafOccupancy)
-				{
-					bufMgr->unPinPage(file, currentPageNum, false);
-					//if we've in the last leaf node, key is not in the B+ tree
-					if (curr->rightSibPageNo == 0)
-					{
-						throw NoSuchKeyFoundException();
-					}
-					//otherwise, go to next node
-					currentPageNum = curr->rightSibPageNo;
-					bufMgr->readPage(file, currentPageNum, currentPageData);
-				}
+				return false;
 			}
+			//otherwise, go to next node
+			currentPageNum = curr->rightSibPageNo;
+			readNode(currentPageNum, currentPageData);
 		}
 	}
 
@@ -550,41 +847,411 @@ namespace badgerdb
 	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
 	**/
 	void BTreeIndex::scanNext(RecordId &outRid)
+	{
+		if (!tryScanNext(outRid))
+		{
+			throw IndexScanCompletedException();
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::tryScanNext
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::tryScanNext(RecordId &outRid)
+	{
+		int key;
+		return scanNextEntry(outRid, key);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::scanNextEntry
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::scanNextEntry(RecordId &outRid, int &outKey)
 	{
 		//check if scan has started yet
 		if (scanExecuting == false) {
 			throw ScanNotInitializedException();
 
 		}
+		int treeKey;
+		RecordId treeRid;
+		bool treeHasEntry = !treeScanDone && peekTreeEntry(treeKey, treeRid);
+		bool deltaHasEntry = deltaScanIter != deltaScanEnd;
+		//if neither side has entries left in range, end the scan
+		if (!treeHasEntry && !deltaHasEntry)
+		{
+			return false;
+		}
+		//return the smaller key of the two sides, preferring the tree on ties
+		if (treeHasEntry && (!deltaHasEntry || treeKey <= deltaScanIter->key))
+		{
+			outRid = treeRid;
+			outKey = treeKey;
+			nextEntry++;
+		}
+		else
+		{
+			outRid = deltaScanIter->rid;
+			outKey = deltaScanIter->key;
+			++deltaScanIter;
+		}
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::peekTreeEntry
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::peekTreeEntry(int &key, RecordId &rid)
+	{
 		LeafNodeInt *curr = (LeafNodeInt *)currentPageData;
-		//if end of node is reached
-		if (nextEntry == leafOccupancy || curr->ridArray[nextEntry].page_number == 0)
+		if (nextEntry == currentLeafEnd)
 		{
+			//the remaining entries of the node are above the range
+			if (currentLeafEnd < leafSize(curr))
+			{
+				treeScanDone = true;
+				return false;
+			}
+			//end of node is reached
 			bufMgr->unPinPage(file, currentPageNum, false);
-			//if we're in the last node, end scan
+			//if we're in the last node, the tree side is done
 			if (curr->rightSibPageNo == 0) {
-				throw IndexScanCompletedException();
-
+				currentPageData = nullptr;
+				treeScanDone = true;
+				return false;
 			}
 			//otherwise go to next node
 			nextEntry = 0;
 			currentPageNum = curr->rightSibPageNo;
-			bufMgr->readPage(file, currentPageNum, currentPageData);
+			readNode(currentPageNum, currentPageData);
 			curr = (LeafNodeInt *)currentPageData;
+			//keys of a following node are never below the range
+			filterLeaf(curr);
+			if (currentLeafEnd == 0)
+			{
+				treeScanDone = true;
+				return false;
+			}
+		}
+		key = curr->keyArray[nextEntry];
+		rid = curr->ridArray[nextEntry];
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::scanNextBatch
+	// -----------------------------------------------------------------------------
+
+	int BTreeIndex::scanNextBatch(RecordId *outRids, int maxRids, int *outKeys)
+	{
+		if (scanExecuting == false)
+		{
+			throw ScanNotInitializedException();
 		}
-		//check if current entry has key within range
-		int key = curr->keyArray[nextEntry];
-		bool isValid = isKeyValid(lowValInt, lowOp, highValInt, highOp, key);
-		if (isValid)
+		int numRids = 0;
+		while (numRids < maxRids)
 		{
-			outRid = curr->ridArray[nextEntry];
-			nextEntry++;
+			//buffered entries have to be interleaved with the tree ones one at a time
+			if (deltaScanIter != deltaScanEnd)
+			{
+				int key;
+				if (!scanNextEntry(outRids[numRids], key))
+				{
+					break;
+				}
+				if (outKeys != nullptr)
+				{
+					outKeys[numRids] = key;
+				}
+				numRids++;
+				continue;
+			}
+			int key;
+			RecordId rid;
+			if (treeScanDone || !peekTreeEntry(key, rid))
+			{
+				break;
+			}
+			//copy the rest of the qualifying run of the current leaf
+			LeafNodeInt *curr = (LeafNodeInt *)currentPageData;
+			int count = std::min(currentLeafEnd - nextEntry, maxRids - numRids);
+			std::copy(curr->ridArray + nextEntry, curr->ridArray + nextEntry + count, outRids + numRids);
+			if (outKeys != nullptr)
+			{
+				std::copy(curr->keyArray + nextEntry, curr->keyArray + nextEntry + count, outKeys + numRids);
+			}
+			nextEntry += count;
+			numRids += count;
+		}
+		return numRids;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::countScan
+	// -----------------------------------------------------------------------------
+
+	int BTreeIndex::countScan(const void *lowValParm,
+							  const Operator lowOpParm,
+							  const void *highValParm,
+							  const Operator highOpParm)
+	{
+		if (!tryStartScan(lowValParm, lowOpParm, highValParm, highOpParm))
+		{
+			return 0;
+		}
+		int count = std::distance(deltaScanIter, deltaScanEnd);
+		int key;
+		RecordId rid;
+		while (!treeScanDone && peekTreeEntry(key, rid))
+		{
+			count += currentLeafEnd - nextEntry;
+			nextEntry = currentLeafEnd;
+		}
+		endScan();
+		return count;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::FindProbe
+	// -----------------------------------------------------------------------------
+
+	struct BTreeIndex::FindProbe
+	{
+		int key;
+		PageId pageNo;		//next page to visit, 0 once the tree has been searched
+		std::vector<RecordId> rids;
+		std::shared_ptr<std::promise<std::vector<RecordId> > > result;	//only for findAsync; a promise is costly to set up
+	};
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::find
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::find(const void *key, std::vector<RecordId> &outRids)
+	{
+		FindProbe probe;
+		probe.key = *((int *)key);
+		probe.pageNo = rootPageNum;
+		//reuse the memory of the caller's vector
+		probe.rids.swap(outRids);
+		probe.rids.clear();
+		advanceProbe(probe, true);
+		outRids.swap(probe.rids);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::findAsync
+	// -----------------------------------------------------------------------------
+
+	std::future<std::vector<RecordId> > BTreeIndex::findAsync(TaskScheduler &scheduler, const void *key)
+	{
+		std::shared_ptr<FindProbe> probe(new FindProbe());
+		probe->key = *((int *)key);
+		probe->pageNo = rootPageNum;
+		probe->result.reset(new std::promise<std::vector<RecordId> >());
+		std::future<std::vector<RecordId> > result = probe->result->get_future();
+		runProbe(probe, &scheduler);
+		return result;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::runProbe
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::runProbe(std::shared_ptr<FindProbe> probe, TaskScheduler *scheduler)
+	{
+		try
+		{
+			if (advanceProbe(*probe, false))
+			{
+				probe->result->set_value(probe->rids);
+				return;
+			}
+		}
+		catch (...)
+		{
+			probe->result->set_exception(std::current_exception());
+			return;
+		}
+		//bring the missing page in on a worker, then go on from it
+		scheduler->submit([this, probe, scheduler]() {
+			try
+			{
+				Page *page;
+				readNode(probe->pageNo, page);
+				bufMgr->unPinPage(file, probe->pageNo, false);
+			}
+			catch (...)
+			{
+				probe->result->set_exception(std::current_exception());
+				return;
+			}
+			runProbe(probe, scheduler);
+		});
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::advanceProbe
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::advanceProbe(FindProbe &probe, const bool readMisses)
+	{
+		while (probe.pageNo != 0)
+		{
+			if (descendOptimistic(probe))
+			{
+				continue;
+			}
+			Page *page;
+			if (readMisses)
+			{
+				readNode(probe.pageNo, page);
+			}
+			else if (!readNodeIfResident(probe.pageNo, page))
+			{
+				return false;
+			}
+			PageId pageNo = probe.pageNo;
+			NonLeafNodeInt *node = (NonLeafNodeInt *)page;
+			if (node->level != 1)
+			{
+				findNextNonLeaf(node, probe.pageNo, probe.key);
+			}
+			else
+			{
+				LeafNodeInt *leaf = (LeafNodeInt *)page;
+				int *end = leaf->keyArray + leafSize(leaf);
+				int *first = std::lower_bound(leaf->keyArray, end, probe.key);
+				int *last = std::upper_bound(first, end, probe.key);
+				for (int *k = first; k < last; k++)
+				{
+					probe.rids.push_back(leaf->ridArray[k - leaf->keyArray]);
+				}
+				//entries with the key may go on in the right sibling
+				probe.pageNo = last == end ? leaf->rightSibPageNo : 0;
+			}
+			bufMgr->unPinPage(file, pageNo, false);
+		}
+		//entries still in the delta buffer
+		RecordId lowestRid = {0, 0, 0};
+		RIDKeyPair<int> bound;
+		bound.set(lowestRid, probe.key);
+		for (std::multiset<RIDKeyPair<int> >::const_iterator entry = deltaBuffer.lower_bound(bound);
+			 entry != deltaBuffer.end() && entry->key == probe.key; ++entry)
+		{
+			probe.rids.push_back(entry->rid);
+		}
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::descendOptimistic
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::descendOptimistic(FindProbe &probe)
+	{
+		if (probe.pageNo >= nodeSwips.size())
+		{
+			return false;
+		}
+		const Page *page;
+		std::uint64_t token;
+		if (!bufMgr->startOptimisticRead(nodeSwips[probe.pageNo], page, token))
+		{
+			return false;
+		}
+		//a torn read yields a wrong child or level, but within the node; validation rejects it
+		NonLeafNodeInt *node = (NonLeafNodeInt *)page;
+		if (node->level == 1)
+		{
+			return false;
+		}
+		PageId nextPageNum;
+		findNextNonLeaf(node, nextPageNum, probe.key);
+		if (!bufMgr->validateOptimisticRead(token))
+		{
+			return false;
+		}
+		probe.pageNo = nextPageNum;
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::readNode
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::readNode(const PageId pageNo, Page *&page)
+	{
+		if (pageNo < nodeSwips.size())
+		{
+			bufMgr->readPage(file, pageNo, nodeSwips[pageNo], page);
 		}
-		//if not end the scan
 		else
 		{
-			throw IndexScanCompletedException();
+			bufMgr->readPage(file, pageNo, page);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::readNodeIfResident
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::readNodeIfResident(const PageId pageNo, Page *&page)
+	{
+		if (pageNo < nodeSwips.size())
+		{
+			return bufMgr->readPageIfResident(file, pageNo, nodeSwips[pageNo], page);
 		}
+		return bufMgr->readPageIfResident(file, pageNo, page);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::allocNode
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::allocNode(PageId &pageNo, Page *&page)
+	{
+		bufMgr->allocPage(file, pageNo, page);
+		if (nodeSwips.size() <= pageNo)
+		{
+			nodeSwips.resize(pageNo + 1);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::leafSize
+	// -----------------------------------------------------------------------------
+
+	int BTreeIndex::leafSize(LeafNodeInt *leaf)
+	{
+		int low = 0, high = leafOccupancy;
+		while (low < high)
+		{
+			int mid = (low + high) / 2;
+			if (leaf->ridArray[mid].page_number != 0)
+			{
+				low = mid + 1;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+		return low;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::filterLeaf
+	// -----------------------------------------------------------------------------
+
+	int BTreeIndex::filterLeaf(LeafNodeInt *leaf)
+	{
+		int first;
+		slotFilter(leaf->keyArray, leafSize(leaf), lowValInt, highValInt, first, currentLeafEnd);
+		return first;
 	}
 
 	// -----------------------------------------------------------------------------
@@ -597,9 +1264,14 @@ namespace badgerdb
 		{
 			throw ScanNotInitializedException();
 		}
+		BADGERDB_PROBE1(scan_end, currentPageNum);
 		nextEntry = -1;
 		scanExecuting = false;
-		bufMgr->unPinPage(file, currentPageNum, false);
+		//the tree side may have already released its last leaf
+		if (currentPageData != nullptr)
+		{
+			bufMgr->unPinPage(file, currentPageNum, false);
+		}
 		currentPageNum = -1;
 		currentPageData = nullptr;
 	}
@@ -610,6 +1282,37 @@ namespace badgerdb
 
 	void BTreeIndex::findNextNonLeaf(NonLeafNodeInt * curr, PageId &nextPageNum, int key)
 	{
+		nextPageNum = curr->pageNoArray[findChildIndex(curr, key)];
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::findChildIndex
+	// -----------------------------------------------------------------------------
+
+	int BTreeIndex::findChildIndex(NonLeafNodeInt * curr, int key)
+	{
+		if (nonLeafLayout == BLOCKED_LAYOUT)
+		{
+			//count the blocks whose keys are all smaller than key, then the smaller keys of the next block;
+			//branch free counting compares over contiguous keys, one directory and one block of cache lines
+			const int *directory = curr->keyArray + nodeOccupancy;
+			int block = 0;
+			for (int i = 0; i < INTBLOCKEDNONLEAFBLOCKS; i++)
+			{
+				block += directory[i] < key;
+			}
+			if (block == INTBLOCKEDNONLEAFBLOCKS)
+			{
+				return nodeOccupancy;
+			}
+			const int *keys = curr->keyArray + block * NONLEAFBLOCKKEYS;
+			int index = block * NONLEAFBLOCKKEYS;
+			for (int i = 0; i < NONLEAFBLOCKKEYS; i++)
+			{
+				index += keys[i] < key;
+			}
+			return index;
+		}
 		int last = nodeOccupancy;
 		for (int i = last; i >= 0; i--) {
 			if (curr->pageNoArray[last] == 0)
@@ -624,7 +1327,7 @@ namespace badgerdb
 				last--;
 			}
 		}
-		nextPageNum = curr->pageNoArray[last];
+		return last;
 	}
 
 	// -----------------------------------------------------------------------------
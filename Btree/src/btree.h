@@ -11,6 +11,12 @@
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <set>
+#include <deque>
+#include <limits>
+#include <future>
+#include <memory>
+#include <vector>
 
 #include "types.h"
 #include "page.h"
@@ -41,6 +47,15 @@ enum Operator
 	GT		/* Greater Than */
 };
 
+/**
+ * @brief Key layout of the non-leaf nodes of a BTreeIndex. Chosen when the index is created and kept in its meta page.
+ */
+enum NonLeafLayout
+{
+	FLAT_LAYOUT = 0,		/* Keys in a flat sorted array, searched one by one */
+	BLOCKED_LAYOUT = 1	/* Keys in cache line sized blocks, searched through an in-page directory of the last key of every block */
+};
+
 
 /**
  * @brief Number of key slots in B+Tree leaf for INTEGER key.
@@ -54,6 +69,22 @@ const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int
 //                                                     level     extra pageNo                  key       pageNo
 const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
 
+/**
+ * @brief Number of INTEGER keys in a cache line sized block of a BLOCKED_LAYOUT non-leaf.
+ */
+const  int NONLEAFBLOCKKEYS = 64 / sizeof( int );
+
+/**
+ * @brief Number of key slots in a BLOCKED_LAYOUT B+Tree non-leaf for INTEGER key. The slots of keyArray after them
+ * hold the directory, one key per block, so the node is a whole number of blocks and stays even for splitting.
+ */
+const  int INTBLOCKEDNONLEAFSIZE = INTARRAYNONLEAFSIZE * NONLEAFBLOCKKEYS / ( NONLEAFBLOCKKEYS + 1 ) / NONLEAFBLOCKKEYS * NONLEAFBLOCKKEYS;
+
+/**
+ * @brief Number of blocks, and directory keys, of a BLOCKED_LAYOUT B+Tree non-leaf for INTEGER key.
+ */
+const  int INTBLOCKEDNONLEAFBLOCKS = INTBLOCKEDNONLEAFSIZE / NONLEAFBLOCKKEYS;
+
 /**
  * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that 
  * add to or make changes to the leaf node pages of the tree. Is templated for the key member.
@@ -100,6 +131,12 @@ bool operator<( const RIDKeyPair<T>& r1, const RIDKeyPair<T>& r2 )
 		return r1.rid.page_number < r2.rid.page_number;
 }
 
+/**
+ * @brief Approximate number of bytes of memory taken by one entry of the BTreeIndex delta buffer:
+ * the key-rid pair plus the color and three links of its tree node.
+ */
+const std::size_t DELTABUFFERENTRYSIZE = sizeof( RIDKeyPair<int> ) + 4 * sizeof( void* );
+
 /**
  * @brief The meta page, which holds metadata for Index file, is always first page of the btree index file and is cast
  * to the following structure to store or retrieve information from it.
@@ -128,6 +165,11 @@ struct IndexMetaInfo{
    * Page number of root page of the B+ Tree inside the file index file.
    */
 	PageId rootPageNo;
+
+  /**
+   * Key layout of the non-leaf nodes.
+   */
+	NonLeafLayout nonLeafLayout;
 };
 
 /*
@@ -147,7 +189,8 @@ struct NonLeafNodeInt{
 	int level;
 
   /**
-   * Stores keys.
+   * Stores keys. In BLOCKED_LAYOUT the first INTBLOCKEDNONLEAFSIZE slots hold the keys, padded with the largest
+   * integer after the last used one, and the next INTBLOCKEDNONLEAFBLOCKS slots hold the last key of every block.
    */
 	int keyArray[ INTARRAYNONLEAFSIZE ];
 
@@ -185,6 +228,8 @@ struct LeafNodeInt{
 };
 
 
+class TaskScheduler;
+
 /**
  * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
  * relation. This index supports only one scan at a time.
@@ -233,11 +278,44 @@ class BTreeIndex {
    */
 	int			nodeOccupancy;
 
+  /**
+   * Key layout of the non-leaf nodes.
+   */
+	NonLeafLayout	nonLeafLayout;
+
   /**
    * TODO: add comments
    */
   PageId firstRootId;
 
+	// MEMBERS SPECIFIC TO THE DELTA BUFFER
+
+  /**
+   * In-memory delta buffer (memtable) absorbing inserts, kept sorted by key. Scans merge it with the tree.
+   */
+	std::multiset< RIDKeyPair<int> > deltaBuffer;
+
+  /**
+   * Memory budget of the delta buffer in bytes. Zero when the delta buffer is disabled.
+   */
+	std::size_t	deltaBufferBudget;
+
+  /**
+   * Separator a split passes up to the parent of the split node; set by splitLeaf and consumed by the insert.
+   */
+	PageKeyPair<int>	splitSeparator;
+
+	// MEMBERS SPECIFIC TO POINTER SWIZZLING
+
+  /**
+   * Swizzled reference to every node of the index file, by page number. The child links stored in the nodes are page
+   * numbers, written back as they are, so the references to the frames holding the nodes are kept beside them.
+   * Lookups follow and update existing references concurrently; only inserts add references, for new pages.
+   * Pinning a node through its reference skips the hash lookup of the buffer manager but still takes its latch;
+   * only the optimistic descent through the non-leaf nodes goes without it.
+   */
+	std::deque<PageSwip>	nodeSwips;
+
 	// MEMBERS SPECIFIC TO SCANNING
 
   /**
@@ -300,6 +378,142 @@ class BTreeIndex {
    */
 	Operator	highOp;
 
+  /**
+   * Leaf filter specialized for the operators of the scan, selected when the scan starts.
+   */
+	void		(*slotFilter)(const int *keys, int numKeys, int lowVal, int highVal, int &first, int &end);
+
+  /**
+   * One past the last slot in range of the current leaf being scanned.
+   */
+	int			currentLeafEnd;
+
+  /**
+   * True once the tree side of the scan has no entries left in range.
+   */
+	bool		treeScanDone;
+
+  /**
+   * Next delta buffer entry to be returned by the scan.
+   */
+	std::multiset< RIDKeyPair<int> >::const_iterator deltaScanIter;
+
+  /**
+   * Delta buffer entry following the last one in range of the scan.
+   */
+	std::multiset< RIDKeyPair<int> >::const_iterator deltaScanEnd;
+
+  /**
+   * Insert an entry directly into the tree, bypassing the delta buffer.
+   * @param entry		Key-rid pair to insert.
+   */
+	void insertIntoTree(RIDKeyPair<int> entry);
+
+  /**
+   * Descend from the root to the leaf holding the first entry satisfying the scan range and leave it pinned.
+   * @return True if the leaf was found, False if there is no key in the tree that satisfies the scan criteria
+   */
+	bool startTreeScan();
+
+  /**
+   * Look at the next tree entry of the scan without consuming it, moving to the right sibling if the current leaf is exhausted.
+   * @param key		Key of the next entry returned in this
+   * @param rid		RecordId of the next entry returned in this
+   * @return True if there is a tree entry left in range, False otherwise
+   */
+	bool peekTreeEntry(int &key, RecordId &rid);
+
+  /**
+   * Fetch the next entry of the scan, merging the tree and the delta buffer.
+   * @param outRid	RecordId of the entry returned in this
+   * @param outKey	Key of the entry returned in this
+   * @return True if an entry was returned, False if no more entries satisfy the scan criteria
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+   */
+	bool scanNextEntry(RecordId &outRid, int &outKey);
+
+  /**
+   * Rebuild the block directory of a BLOCKED_LAYOUT non-leaf after its keys changed, padding the unused key slots.
+   * Does nothing in FLAT_LAYOUT.
+   * @param node		Non-leaf node
+   */
+	void buildNodeDirectory(NonLeafNodeInt *node);
+
+  /**
+   * Number of used slots of a leaf, found by binary search since used slots are a prefix of the leaf.
+   * @param leaf		Leaf node
+   */
+	int leafSize(LeafNodeInt *leaf);
+
+  /**
+   * Read and pin a node through its swizzled reference.
+   * @param pageNo	Page number of the node
+   * @param page		Pinned node returned in this
+   */
+	void readNode(const PageId pageNo, Page *&page);
+
+  /**
+   * Pin a node through its swizzled reference if it is in the buffer pool.
+   * @param pageNo	Page number of the node
+   * @param page		Pinned node returned in this, set only if the node is present
+   * @return True if the node was present and has been pinned
+   */
+	bool readNodeIfResident(const PageId pageNo, Page *&page);
+
+  /**
+   * Allocate a new node, adding a swizzled reference to it.
+   * @param pageNo	Page number of the new node returned in this
+   * @param page		Pinned new node returned in this
+   */
+	void allocNode(PageId &pageNo, Page *&page);
+
+  /**
+   * Find the slots of a leaf in range of the scan with the key filter kernels and set currentLeafEnd.
+   * @param leaf		Leaf node
+   * @return First slot not below the scan range, the leaf size if none
+   */
+	int filterLeaf(LeafNodeInt *leaf);
+
+  /**
+   * Insert an entry for every tuple of the relation, reading the relation in morsels of MORSELPAGES pages on the
+   * workers of a scheduler. The entries of each morsel are gathered by its task and inserted here in relation order.
+   * @param relationName	Name of the relation
+   * @param scheduler			Scheduler running the morsel scans
+   */
+	void insertRelationParallel(const std::string & relationName, TaskScheduler *scheduler);
+
+  /**
+   * State of a point lookup: the key, the next page to visit and the record ids found so far.
+   */
+	struct FindProbe;
+
+  /**
+   * Walk a lookup down to its leaves and along the right siblings holding its key, then add the delta buffer entries.
+   * @param probe				Lookup to advance
+   * @param readMisses	If false, stop at the first page not in the buffer pool instead of reading it
+   * @return True if the lookup is complete, False if it stopped at probe.pageNo
+   */
+	bool advanceProbe(FindProbe &probe, const bool readMisses);
+
+  /**
+   * Move a lookup from a non-leaf node to its child with an optimistic read of the node, neither latching the buffer
+   * pool nor pinning the node, so that concurrent lookups do not write to the shared frames of the top of the tree.
+   * Only the refbit of the frame is set, when the clock has cleared it; the read is not recorded in the access trace
+   * nor the miss ratio curve of the buffer manager.
+   * @param probe				Lookup to advance
+   * @return True if the lookup moved on, False if the node has to be read with a pin: it is a leaf, its reference
+   *         is not swizzled, or the read conflicted with its eviction
+   */
+	bool descendOptimistic(FindProbe &probe);
+
+  /**
+   * Advance a lookup over the resident pages and, at a miss, continue it from a scheduler task that reads the page.
+   * Completes the promise of the lookup once it is done or has failed.
+   * @param probe				Lookup to run
+   * @param scheduler		Scheduler reading the missing pages
+   */
+	void runProbe(std::shared_ptr<FindProbe> probe, TaskScheduler *scheduler);
+
 	
  public:
 
@@ -313,10 +527,17 @@ class BTreeIndex {
    * @param bufMgrIn						Buffer Manager Instance
    * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
    * @param attrType						Datatype of attribute over which index is built
+   * @param layout							Key layout of the non-leaf nodes. Ignored when the index file exists, which keeps the layout it was created with.
+   * @param scheduler						If not nullptr, the relation is scanned in morsels on its workers when the index file is created.
+   *                            The entries are still inserted by the calling thread, in relation order.
+   * @param compression				Whether the pages of the index file are stored compressed, used when the index file is created
    * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   * @throws  InvalidRecordException    If a record of the relation is too short to hold the attribute. The partly built index file is removed.
    */
 	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const NonLeafLayout layout = FLAT_LAYOUT, TaskScheduler *scheduler = nullptr,
+						const FileCompression compression = RAW_PAGES);
 	
 
   /**
@@ -369,6 +590,28 @@ class BTreeIndex {
    */
   void splitLeaf(LeafNodeInt *leaf, PageId leafPId, PageKeyPair<int> *&newEntry, RIDKeyPair<int> entry);
 
+  /**
+   * Enable the in-memory delta buffer. Subsequent inserts are absorbed into it and only applied to the tree,
+   * in key order, once the buffer reaches its memory budget or the process reaches the budget of its MemoryTracker,
+   * when mergeDeltaBuffer() is called or when the index is destroyed.
+   * Scans merge the buffered entries with the ones in the tree.
+   * @param budgetBytes	Memory budget of the buffer in bytes. Zero merges any buffered entries and disables the buffer.
+   */
+  void enableDeltaBuffer(const std::size_t budgetBytes);
+
+  /**
+   * Apply all entries of the delta buffer to the tree in sorted batches and empty it.
+   * Consecutive entries falling into the same leaf are inserted with a single pin of that leaf.
+   * Entries leave the buffer, and give their memory back, as they are applied, so an insert that throws leaves
+   * only the entries not applied yet buffered. Any executing scan is ended first.
+   */
+  void mergeDeltaBuffer();
+
+  /**
+   * Number of entries currently held in the delta buffer.
+   */
+  std::size_t deltaBufferSize() const { return deltaBuffer.size(); }
+
 
 
   /**
@@ -388,6 +631,18 @@ class BTreeIndex {
 	**/
 	void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
 
+  /**
+	 * Begin a filtered scan of the index like startScan, reporting an empty range through the return value instead of throwing.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @return True if the scan was started, False if there is no key in the B+ tree that satisfies the scan criteria
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @throws  BadScanrangeException If lowVal > highval
+	**/
+	bool tryStartScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
 
   /**
 	 * Fetch the record id of the next index entry that matches the scan.
@@ -398,6 +653,58 @@ class BTreeIndex {
 	**/
 	void scanNext(RecordId& outRid);  // returned record id
 
+  /**
+	 * Fetch the record id of the next index entry that matches the scan like scanNext, reporting the end of the scan
+	 * through the return value instead of throwing.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @return True if a record id was returned, False if no more records satisfy the scan criteria
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	bool tryScanNext(RecordId& outRid);
+
+  /**
+	 * Fetch the record ids of the next index entries that match the scan, copying whole runs of a leaf at a time.
+   * @param outRids	Array receiving the record ids
+   * @param maxRids	Capacity of outRids
+   * @param outKeys	If not nullptr, array of capacity maxRids receiving the key of each record id
+   * @return Number of record ids returned, 0 once no more records satisfy the scan criteria
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	int scanNextBatch(RecordId* outRids, int maxRids, int* outKeys = nullptr);
+
+  /**
+	 * Count the index entries within a range, summing the qualifying slots of each leaf instead of returning them one by one.
+	 * Any executing scan is ended.
+   * @param lowVal	Low value of range, pointer to integer
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer
+   * @param highOp	High operator (LT/LTE)
+   * @return Number of entries in range
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+	**/
+	int countScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  /**
+	 * Find the record ids of every entry with a key. Does not use nor end the executing scan, so lookups can run
+	 * concurrently with each other, but not with inserts.
+   * @param key			Key to look for, pointer to integer
+   * @param outRids	Record ids of the entries found returned in this, in no particular order, empty if none has the key
+	**/
+	void find(const void* key, std::vector<RecordId>& outRids);
+
+  /**
+	 * Find the record ids of every entry with a key without blocking on I/O. The lookup descends the tree on the calling
+	 * thread as long as its pages are in the buffer pool; at the first miss, the page is read by a task of the scheduler,
+	 * which then carries the lookup on. The buffer manager reads pages without holding its latch, so lookups missing
+	 * on different pages overlap their reads, up to one per worker of the scheduler.
+	 * The same restrictions as find() apply, and the index must outlive the returned future.
+   * @param scheduler	Scheduler reading the missing pages
+   * @param key				Key to look for, pointer to integer
+   * @return Future of the record ids of the entries found, empty if none has the key; rethrows any error of the lookup
+	**/
+	std::future<std::vector<RecordId> > findAsync(TaskScheduler &scheduler, const void* key);
+
 
   /**
 	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
@@ -413,6 +720,14 @@ class BTreeIndex {
    * @param
    */
   void findNextNonLeaf(NonLeafNodeInt* curr, PageId &nextPageNum, int key);
+
+  /**
+   * Helper function which finds the index, inside pageNoArray, of the child of a non leaf node which holds the given key.
+   * @param curr The current (parent) node in the B+ Tree
+   * @param key The value of the key we are looking for in the child nodes
+   * @return Index of the child page number in pageNoArray
+   */
+  int findChildIndex(NonLeafNodeInt* curr, int key);
 	
   /**
    * Helper function which determines whether a given key belongs to a certain range of values.
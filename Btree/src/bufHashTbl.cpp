@@ -9,6 +9,7 @@
 #include <iostream>
 #include "buffer.h"
 #include "bufHashTbl.h"
+#include "memory_tracker.h"
 #include "exceptions/hash_already_present_exception.h"
 #include "exceptions/hash_not_found_exception.h"
 #include "exceptions/hash_table_exception.h"
@@ -23,13 +24,34 @@ int BufHashTbl::hash(const File* file, const PageId pageNo)
   return value;
 }
 
-BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+BufHashTbl::BufHashTbl(const int htSize, const int entries)
+	: HTSIZE(htSize), ht(NULL), slab(NULL), slabSize(entries)
 {
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
+  // account for the directory and the slab together, as a table over the budget takes neither
+  std::size_t bytes = htSize * sizeof(hashBucket*) + entries * sizeof(hashBucket);
+  MemoryTracker::process().reserve(MEMORY_HASHTABLE, bytes);
+  try
+  {
+    // allocate an array of pointers to hashBuckets
+    ht = new hashBucket* [htSize];
+    slab = new hashBucket [entries];
+  }
+  catch (...)
+  {
+    delete [] ht;
+    MemoryTracker::process().release(MEMORY_HASHTABLE, bytes);
+    throw;
+  }
   for(int i=0; i < HTSIZE; i++)
     ht[i] = NULL;
+
+  // thread the slab into the free list, in address order
+  freeList = NULL;
+  for (int i = entries - 1; i >= 0; i--)
+  {
+    slab[i].next = freeList;
+    freeList = &slab[i];
+  }
 }
 
 BufHashTbl::~BufHashTbl()
@@ -39,10 +61,36 @@ BufHashTbl::~BufHashTbl()
     while (ht[i]) {
       tmpBuf = ht[i];
       ht[i] = ht[i]->next;
-      delete tmpBuf;
+      freeBucket(tmpBuf);
     }
   }
   delete [] ht;
+  delete [] slab;
+  MemoryTracker::process().release(MEMORY_HASHTABLE, HTSIZE * sizeof(hashBucket*) + slabSize * sizeof(hashBucket));
+}
+
+hashBucket* BufHashTbl::allocBucket()
+{
+  if (freeList)
+  {
+    hashBucket* bucket = freeList;
+    freeList = bucket->next;
+    return bucket;
+  }
+  MemoryTracker::process().charge(MEMORY_HASHTABLE, sizeof(hashBucket));
+  return new hashBucket;
+}
+
+void BufHashTbl::freeBucket(hashBucket* bucket)
+{
+  if (bucket >= slab && bucket < slab + slabSize)
+  {
+    bucket->next = freeList;
+    freeList = bucket;
+    return;
+  }
+  delete bucket;
+  MemoryTracker::process().release(MEMORY_HASHTABLE, sizeof(hashBucket));
 }
 
 void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
@@ -56,7 +104,7 @@ void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId fra
     tmpBuc = tmpBuc->next;
   }
 
-  tmpBuc = new hashBucket;
+  tmpBuc = allocBucket();
   if (!tmpBuc)
   	throw HashTableException();
 
@@ -68,6 +116,12 @@ void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId fra
 }
 
 void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
+{
+  if (!tryLookup(file, pageNo, frameNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
+
+bool BufHashTbl::tryLookup(const File* file, const PageId pageNo, FrameId &frameNo)
 {
   int index = hash(file, pageNo);
   hashBucket* tmpBuc = ht[index];
@@ -75,12 +129,12 @@ void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo)
     if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
     {
       frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
+      return true;
     }
     tmpBuc = tmpBuc->next;
   }
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  return false;
 }
 
 void BufHashTbl::remove(const File* file, const PageId pageNo) {
@@ -98,7 +152,7 @@ void BufHashTbl::remove(const File* file, const PageId pageNo) {
       else
 				ht[index] = tmpBuc->next;
 
-      delete tmpBuc;
+      freeBucket(tmpBuc);
       return;
     }
 		else
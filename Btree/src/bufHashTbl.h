@@ -39,6 +39,8 @@ struct hashBucket {
 
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
+* Entries come from a slab allocated with the table and sized to the entries expected, threaded into a free list, so
+* that the hash table does not go to the heap as pages come and go. Entries beyond the slab are allocated one by one.
 *
 * @warning This class is not threadsafe.
 */
@@ -54,6 +56,27 @@ class BufHashTbl
 	 */
   hashBucket**  ht;
 
+	/**
+	 * Entries allocated with the table, and their number
+	 */
+  hashBucket*   slab;
+  int           slabSize;
+
+	/**
+	 * Entries of the slab not in use, linked through next
+	 */
+  hashBucket*   freeList;
+
+	/**
+	 * Take an entry off the free list, or from the heap once the slab is used up
+	 */
+  hashBucket*  allocBucket();
+
+	/**
+	 * Return an entry to the free list, or to the heap if it is not from the slab
+	 */
+  void  freeBucket(hashBucket* bucket);
+
 	/**
 	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
 	 *
@@ -66,8 +89,11 @@ class BufHashTbl
  public:
 	/**
    * Constructor of BufHashTbl class
+	 *
+	 * @param htSize		Number of buckets
+	 * @param entries		Number of entries allocated up front, e.g. the number of frames of the buffer pool
 	 */
-	BufHashTbl(const int htSize);  // constructor
+	BufHashTbl(const int htSize, const int entries = 0);  // constructor
 
 	/**
    * Destructor of BufHashTbl class
@@ -96,6 +122,17 @@ class BufHashTbl
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool without throwing
+   * on a miss.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, set only if the page is found
+   * @return true if the page entry is in the hash table, false otherwise
+	 */
+  bool tryLookup(const File* file, const PageId pageNo, FrameId &frameNo);
+
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
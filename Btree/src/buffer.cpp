@@ -5,9 +5,15 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <map>
 #include <memory>
 #include <iostream>
+#include <limits>
+#include <vector>
 #include "buffer.h"
+#include "task_scheduler.h"
+#include "probes.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
@@ -16,50 +22,147 @@
 
 namespace badgerdb { 
 
+/**
+ * Number of frame hints kept per thread.
+ */
+static const unsigned FRAMEHINTS = 8;
+
+/**
+ * Frame a thread last found a page in, and the generation of the frame then.
+ */
+struct FrameHint
+{
+  const BufMgr* bufMgr;
+  const File* file;
+  PageId pageNo;
+  FrameId frameNo;
+  std::uint32_t generation;
+};
+
+/**
+ * Frame hints of the calling thread, direct mapped by file and page number.
+ */
+static thread_local FrameHint frameHints[FRAMEHINTS];
+
+static FrameHint& frameHint(const File* file, const PageId pageNo)
+{
+  return frameHints[(pageNo ^ (reinterpret_cast<std::uintptr_t>(file) >> 4)) % FRAMEHINTS];
+}
+
 //----------------------------------------
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
-	bufDescTable = new BufDesc[bufs];
-
-  for (FrameId i = 0; i < bufs; i++) 
+BufMgr::BufMgr(std::uint32_t bufs, std::size_t victimCacheBytes, const std::string& spillFileName,
+               std::uint32_t spillPages)
+	: numBufs(bufs), victimCache(victimCacheBytes), missRatioCurve(bufs) {
+  //account for the frames, descriptors and hash table before taking them, so that a pool over the budget takes nothing
+  MemoryTracker& memory = MemoryTracker::process();
+  memory.reserve(MEMORY_BUFPOOL, bufs * sizeof(Page));
+  try
+  {
+    memory.reserve(MEMORY_BUFDESCTABLE, bufs * sizeof(BufDesc));
+  }
+  catch (...)
+  {
+    memory.release(MEMORY_BUFPOOL, bufs * sizeof(Page));
+    throw;
+  }
+  try
+  {
+    hashTable = new BufHashTbl (hashTableSize(bufs), bufs);  // allocate the buffer hash table, an entry per frame
+  }
+  catch (...)
   {
-  	bufDescTable[i].frameNo = i;
-  	bufDescTable[i].valid = false;
+    memory.release(MEMORY_BUFDESCTABLE, bufs * sizeof(BufDesc));
+    memory.release(MEMORY_BUFPOOL, bufs * sizeof(Page));
+    throw;
   }
 
-  bufPool = new Page[bufs];
+  //the destructor does not run if the constructor throws, so give back what was taken here
+  bufDescTable = NULL;
+  bufPool = NULL;
+  try
+  {
+    bufDescTable = new BufDesc[bufs];
+
+    for (FrameId i = 0; i < bufs; i++) 
+    {
+      bufDescTable[i].frameNo = i;
+      bufDescTable[i].valid = false;
+    }
+
+    bufPool = new Page[bufs];
+    poolBufferIndex = ring.registerBuffer(reinterpret_cast<char*>(bufPool), bufs * sizeof(Page));
 
-  int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-  hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+    clockHand = bufs - 1;
 
-  clockHand = bufs - 1;
+    if (spillPages > 0)
+    {
+      spillCache.reset(new SpillCache(spillFileName, spillPages));
+    }
+  }
+  catch (...)
+  {
+    delete hashTable;
+    delete [] bufDescTable;
+    delete [] bufPool;
+    memory.release(MEMORY_BUFDESCTABLE, bufs * sizeof(BufDesc));
+    memory.release(MEMORY_BUFPOOL, bufs * sizeof(Page));
+    throw;
+  }
 }
 
 
 BufMgr::~BufMgr() {
-  //Flush out all unwritten pages
+  //Flush out all unwritten pages, one batch per file
+  std::map<File*, std::vector<PageTransfer> > dirtyPages;
   for (std::uint32_t i = 0; i < numBufs; i++) 
   {
   	BufDesc* tmpbuf = &(bufDescTable[i]);
   	if (tmpbuf->valid == true && tmpbuf->dirty == true)
 		{
-			tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
+			PageTransfer transfer = {tmpbuf->pageNo, &bufPool[i], poolBufferIndex, true};
+			dirtyPages[tmpbuf->file].push_back(transfer);
   	}
   }
+  for (std::map<File*, std::vector<PageTransfer> >::iterator it = dirtyPages.begin(); it != dirtyPages.end(); ++it)
+  {
+		it->first->writePages(ring, it->second);
+  }
 
 	delete hashTable;
   delete [] bufDescTable;
   delete [] bufPool;
+  MemoryTracker::process().release(MEMORY_BUFDESCTABLE, numBufs * sizeof(BufDesc));
+  MemoryTracker::process().release(MEMORY_BUFPOOL, numBufs * sizeof(Page));
+}
+
+int BufMgr::hashTableSize(const std::uint32_t bufs)
+{
+  return ((((int) (bufs * 1.2))*2)/2)+1;
+}
+
+std::size_t BufMgr::bytesFor(const std::uint32_t bufs)
+{
+  return bufs * (sizeof(Page) + sizeof(BufDesc) + sizeof(hashBucket)) + hashTableSize(bufs) * sizeof(hashBucket*);
+}
+
+std::uint32_t BufMgr::framesWithin(const std::size_t bytes)
+{
+  //the bytes per frame are close to constant, so the estimate is off by a frame at most
+  std::uint32_t frames = std::min<double>(bytes / (bytesFor(1024) / 1024.0), std::numeric_limits<std::uint32_t>::max());
+  while (frames > 0 && bytesFor(frames) > bytes)
+  {
+    frames--;
+  }
+  return frames;
 }
 
-void BufMgr::allocBuf(FrameId & frame) 
+void BufMgr::allocBuf(std::unique_lock<std::mutex>& lock, FrameId & frame) 
 {
   // perform first part of clock algorithm to search for 
   // open buffer frame
-  // Assumes non-concurrent access to buffer manager
   std::uint32_t numScanned = 0;
   bool found = 0;
 
@@ -82,8 +185,8 @@ void BufMgr::allocBuf(FrameId & frame)
       if (bufDescTable[clockHand].pinCnt == 0)
       {
         // hasn't been referenced and is not pinned, use it
-        // remove previous entry from hash table
-        hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
+        BADGERDB_PROBE3(page_evict, bufDescTable[clockHand].file->filename().c_str(), bufDescTable[clockHand].pageNo,
+                        bufDescTable[clockHand].dirty);
         found = true;
         break;
       }
@@ -102,61 +205,332 @@ void BufMgr::allocBuf(FrameId & frame)
     throw BufferExceededException();
   }
   
-  // flush any existing changes to disk if necessary
-  if (bufDescTable[clockHand].dirty)
+  // the clock may move on while the latch is let go below
+  FrameId victim = clockHand;
+  BufDesc* tmpbuf = &(bufDescTable[victim]);
+
+  // flush any existing changes to disk if necessary, without the latch; the page stays in the hash table, pinned
+  // and in progress, so that readers wait for the write rather than read the page from the file before it
+  bool wroteBack = false;
+  if (tmpbuf->dirty)
   {
     bufStats.diskwrites++;
-    //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
-    bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
+    tmpbuf->MarkInProgress();
+    tmpbuf->pinCnt = 1;
+    lock.unlock();
+    try
+    {
+      tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[victim]);
+    }
+    catch (...)
+    {
+      lock.lock();
+      tmpbuf->pinCnt = 0;
+      tmpbuf->Publish();
+      ioDone.notify_all();
+      throw;
+    }
+    lock.lock();
+    tmpbuf->dirty = false;
+    wroteBack = true;
+    BADGERDB_PROBE3(page_writeback, tmpbuf->file->filename().c_str(), tmpbuf->pageNo, victim);
+  }
+
+  if (found)
+  {
+    // remove previous entry from hash table
+    hashTable->remove(tmpbuf->file, tmpbuf->pageNo);
+    // keep a compressed copy of the page, now clean, in case it is read again soon
+    if (victimCache.enabled())
+    {
+      victimCache.insert(tmpbuf->file, tmpbuf->pageNo, bufPool[victim]);
+    }
+    if (spillCache)
+    {
+      spillCache->insert(tmpbuf->file, tmpbuf->pageNo, bufPool[victim]);
+    }
   }
 
 	//Reset all the BufDesc entry for the frame before returning the frame
-  bufDescTable[clockHand].Clear();
+  tmpbuf->Clear();
+  if (wroteBack)
+  {
+    ioDone.notify_all();
+  }
 
   // return new frame number
-  frame = clockHand;
+  frame = victim;
 } // end allocBuf
 
 	
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+{
+  std::uint32_t sampleHash = MissRatioCurve::sampleHash(file, pageNo);
+  std::unique_lock<std::mutex> lock(latch);
+  readPageLocked(lock, file, pageNo, sampleHash, page);
+}
+
+
+void BufMgr::readPage(File* file, const PageId pageNo, PageSwip& swip, Page*& page)
+{
+  std::uint32_t sampleHash = MissRatioCurve::sampleHash(file, pageNo);
+  std::unique_lock<std::mutex> lock(latch);
+  if (!pinSwizzled(file, pageNo, sampleHash, swip, page))
+  {
+    swizzle(swip, readPageLocked(lock, file, pageNo, sampleHash, page));
+  }
+}
+
+
+FrameId BufMgr::readPageLocked(std::unique_lock<std::mutex>& lock, File* file, const PageId pageNo,
+                               const std::uint32_t sampleHash, Page*& page)
 {
   // check to see if it is already in the buffer pool
   // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
   FrameId frameNo = 0;
-	try
-	{
-  	hashTable->lookup(file, pageNo, frameNo);
+  while (true)
+  {
+    if (lookupPublishedFrame(lock, file, pageNo, frameNo))
+    {
+      // set the referenced bit
+      bufDescTable[frameNo].refbit = true;
+      bufDescTable[frameNo].pinCnt++;
+      page = &bufPool[frameNo];
+      recordRead(file, pageNo, sampleHash, frameNo, true);
+      return frameNo;
+    }
+
+    // not in the buffer pool, must allocate a new page
+    // alloc a new frame
+    allocBuf(lock, frameNo);
+
+    // another thread may have read the page in while allocBuf wrote a page back; the frame is left free then
+    FrameId otherFrameNo;
+    if (!hashTable->tryLookup(file, pageNo, otherFrameNo))
+    {
+      break;
+    }
+  }
+
+  // set up the entry properly; the frame is pinned and in progress until the page has been read
+  BufDesc* tmpbuf = &(bufDescTable[frameNo]);
+  tmpbuf->Set(file, pageNo);
+  hashTable->insert(file, pageNo, frameNo);
 
-    // set the referenced bit
-    bufDescTable[frameNo].refbit = true;
-    bufDescTable[frameNo].pinCnt++;
-    page = &bufPool[frameNo];
+  // read the page into the new frame, from the victim cache or the spill cache if it was evicted recently
+  if (victimCache.fetch(file, pageNo, bufPool[frameNo]))
+  {
+    bufStats.victimhits++;
   }
-  catch(const HashNotFoundException &e) //not in the buffer pool, must allocate a new page
+  else
   {
-    // alloc a new frame
-    allocBuf(frameNo);
+    // the spill cache and the file are read without the latch
+    bool spillHit = false;
+    lock.unlock();
+    try
+    {
+      spillHit = spillCache && spillCache->fetch(file, pageNo, bufPool[frameNo]);
+      if (!spillHit)
+      {
+        bufPool[frameNo] = file->readPage(pageNo);
+      }
+    }
+    catch (...)
+    {
+      lock.lock();
+      hashTable->remove(file, pageNo);
+      tmpbuf->Clear();
+      ioDone.notify_all();
+      throw;
+    }
+    lock.lock();
+    if (spillHit)
+    {
+      bufStats.spillhits++;
+    }
+    else
+    {
+      bufStats.diskreads++;
+    }
+  }
 
-    // read the page into the new frame
-    bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
-    bufPool[frameNo] = file->readPage(pageNo);
+  tmpbuf->Publish();
+  ioDone.notify_all();
+  page = &bufPool[frameNo];
+  rememberFrame(file, pageNo, frameNo);
+  recordRead(file, pageNo, sampleHash, frameNo, false);
+  return frameNo;
+}
 
-    // set up the entry properly
-    bufDescTable[frameNo].Set(file, pageNo);
-    page = &bufPool[frameNo];
 
-    // insert in the hash table
-    hashTable->insert(file, pageNo, frameNo);
+void BufMgr::recordRead(const File* file, const PageId pageNo, const std::uint32_t sampleHash, const FrameId frameNo,
+                        const bool hit)
+{
+  if (hit)
+  {
+    BADGERDB_PROBE3(page_hit, file->filename().c_str(), pageNo, frameNo);
+  }
+  else
+  {
+    BADGERDB_PROBE3(page_miss, file->filename().c_str(), pageNo, frameNo);
   }
+  missRatioCurve.reference(file, pageNo, sampleHash);
+  traceAccess(file, pageNo, TRACE_READ);
+}
+
+
+bool BufMgr::lookupFrame(const File* file, const PageId pageNo, FrameId& frameNo)
+{
+  FrameHint& hint = frameHint(file, pageNo);
+  if (hint.bufMgr == this && hint.file == file && hint.pageNo == pageNo && hint.frameNo < numBufs)
+  {
+    BufDesc* tmpbuf = &(bufDescTable[hint.frameNo]);
+    if (tmpbuf->generation.load(std::memory_order_relaxed) == hint.generation && tmpbuf->valid &&
+        tmpbuf->file == file && tmpbuf->pageNo == pageNo)
+    {
+      bufStats.hinthits++;
+      frameNo = hint.frameNo;
+      return true;
+    }
+  }
+  if (!hashTable->tryLookup(file, pageNo, frameNo))
+  {
+    return false;
+  }
+  rememberFrame(file, pageNo, frameNo);
+  return true;
+}
+
+
+bool BufMgr::lookupPublishedFrame(std::unique_lock<std::mutex>& lock, const File* file, const PageId pageNo,
+                                  FrameId& frameNo)
+{
+  while (lookupFrame(file, pageNo, frameNo))
+  {
+    if (!bufDescTable[frameNo].InProgress())
+    {
+      return true;
+    }
+    // the frame may hold another page, or none, once the transfer is done
+    ioDone.wait(lock);
+  }
+  return false;
+}
+
+
+void BufMgr::rememberFrame(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  FrameHint& hint = frameHint(file, pageNo);
+  hint.bufMgr = this;
+  hint.file = file;
+  hint.pageNo = pageNo;
+  hint.frameNo = frameNo;
+  hint.generation = bufDescTable[frameNo].generation.load(std::memory_order_relaxed);
+}
+
+
+bool BufMgr::pinSwizzled(const File* file, const PageId pageNo, const std::uint32_t sampleHash, const PageSwip& swip,
+                         Page*& page)
+{
+  std::uint64_t ref = swip.ref.load(std::memory_order_relaxed);
+  FrameId frameNo = static_cast<FrameId>(ref);
+  if (frameNo >= numBufs)
+  {
+    return false;
+  }
+  BufDesc* tmpbuf = &(bufDescTable[frameNo]);
+  // a frame released since holds another page, or this one again under a newer generation
+  if (!tmpbuf->valid || tmpbuf->generation.load(std::memory_order_relaxed) != static_cast<std::uint32_t>(ref >> 32) ||
+      tmpbuf->file != file ||
+      tmpbuf->pageNo != pageNo)
+  {
+    return false;
+  }
+  tmpbuf->refbit = true;
+  tmpbuf->pinCnt++;
+  page = &bufPool[frameNo];
+  recordRead(file, pageNo, sampleHash, frameNo, true);
+  return true;
+}
+
+
+bool BufMgr::readPageIfResident(File* file, const PageId pageNo, PageSwip& swip, Page*& page)
+{
+  std::uint32_t sampleHash = MissRatioCurve::sampleHash(file, pageNo);
+  std::lock_guard<std::mutex> lock(latch);
+  if (pinSwizzled(file, pageNo, sampleHash, swip, page))
+  {
+    return true;
+  }
+  FrameId frameNo = 0;
+  // a page being read in is not resident yet
+  if (!lookupFrame(file, pageNo, frameNo) || bufDescTable[frameNo].InProgress())
+  {
+    return false;
+  }
+  bufDescTable[frameNo].refbit = true;
+  bufDescTable[frameNo].pinCnt++;
+  page = &bufPool[frameNo];
+  recordRead(file, pageNo, sampleHash, frameNo, true);
+  swizzle(swip, frameNo);
+  return true;
+}
+
+
+bool BufMgr::readPageIfResident(File* file, const PageId pageNo, Page*& page)
+{
+  std::uint32_t sampleHash = MissRatioCurve::sampleHash(file, pageNo);
+  std::lock_guard<std::mutex> lock(latch);
+  FrameId frameNo = 0;
+  // a page being read in is not resident yet
+  if (!lookupFrame(file, pageNo, frameNo) || bufDescTable[frameNo].InProgress())
+  {
+    return false;
+  }
+  bufDescTable[frameNo].refbit = true;
+  bufDescTable[frameNo].pinCnt++;
+  page = &bufPool[frameNo];
+  recordRead(file, pageNo, sampleHash, frameNo, true);
+  return true;
+}
+
+
+std::future<Page*> BufMgr::readPageAsync(TaskScheduler &scheduler, File* file, const PageId pageNo)
+{
+  std::shared_ptr<std::promise<Page*> > result(new std::promise<Page*>());
+  Page* page;
+  if (readPageIfResident(file, pageNo, page))
+  {
+    result->set_value(page);
+    return result->get_future();
+  }
+  std::future<Page*> pageRead = result->get_future();
+  scheduler.submit([this, result, file, pageNo]()
+  {
+    try
+    {
+      Page* page;
+      readPage(file, pageNo, page);
+      result->set_value(page);
+    }
+    catch (...)
+    {
+      result->set_exception(std::current_exception());
+    }
+  });
+  return pageRead;
 }
 
 
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
 {
-  // lookup in hashtable
+  std::lock_guard<std::mutex> lock(latch);
+  // lookup in hashtable, unless the frame is among the hints of the thread
   FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
+  if (!lookupFrame(file, pageNo, frameNo))
+  {
+    throw HashNotFoundException(file->filename(), pageNo);
+  }
 
   if (dirty == true) bufDescTable[frameNo].dirty = dirty;
 
@@ -166,29 +540,56 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
   	throw PageNotPinnedException(file->filename(), pageNo, frameNo);
   }
   else bufDescTable[frameNo].pinCnt--;
+  traceAccess(file, pageNo, dirty ? TRACE_UNPIN_DIRTY : TRACE_UNPIN);
 }
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
+  std::unique_lock<std::mutex> lock(latch);
   FrameId frameNo;
 
   // alloc a new frame
-  allocBuf(frameNo);
+  allocBuf(lock, frameNo);
 
   // allocate a new page in the file
 	//std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
   bufPool[frameNo] = file->allocatePage(pageNo);
+  victimCache.remove(file, pageNo);
+  if (spillCache)
+  {
+    spillCache->remove(file, pageNo);
+  }
   page = &bufPool[frameNo];
 
   // set up the entry properly
   bufDescTable[frameNo].Set(file, pageNo);
+  bufDescTable[frameNo].Publish();
 
   // insert in the hash table
   hashTable->insert(file, pageNo, frameNo);
+  rememberFrame(file, pageNo, frameNo);
+  traceAccess(file, pageNo, TRACE_ALLOC);
 }
 
 void BufMgr::flushFile(const File* file) 
 {
+  std::unique_lock<std::mutex> lock(latch);
+  // wait for the pages of the file being read in or written back
+  std::uint32_t checked = 0;
+  while (checked < numBufs)
+  {
+    if (bufDescTable[checked].file == file && bufDescTable[checked].InProgress())
+    {
+      ioDone.wait(lock);
+      checked = 0;
+    }
+    else
+    {
+      checked++;
+    }
+  }
+  std::vector<FrameId> frames;
+  std::vector<PageTransfer> dirtyPages;
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
@@ -199,37 +600,249 @@ void BufMgr::flushFile(const File* file)
 
 	    if (tmpbuf->dirty == true)
 			{
-				//if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
-				tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
-				tmpbuf->dirty = false;
+				PageTransfer transfer = {tmpbuf->pageNo, &bufPool[i], poolBufferIndex, true};
+				dirtyPages.push_back(transfer);
     	}
-
-    	hashTable->remove(file,tmpbuf->pageNo);
-    	tmpbuf->Clear();
+			frames.push_back(i);
   	}
 		else if (tmpbuf->valid == false && tmpbuf->file == file)
   		throw BadBufferException(tmpbuf->frameNo, tmpbuf->dirty, tmpbuf->valid, tmpbuf->refbit);
   }
+
+	//release the clean frames now; the dirty ones stay in the hash table, pinned and in progress, while they are
+	//written without the latch, so that readers wait for the writes rather than read the pages from the file first
+	File* writeFile = NULL;
+	for (std::size_t i = 0; i < frames.size(); i++)
+	{
+  	BufDesc* tmpbuf = &(bufDescTable[frames[i]]);
+		if (tmpbuf->dirty)
+		{
+			writeFile = tmpbuf->file;
+			tmpbuf->MarkInProgress();
+			tmpbuf->pinCnt = 1;
+		}
+		else
+		{
+			hashTable->remove(file, tmpbuf->pageNo);
+			tmpbuf->Clear();
+		}
+	}
+
+	//write the dirty pages in one batch, then release their frames
+	if (!dirtyPages.empty())
+	{
+		lock.unlock();
+		try
+		{
+			std::lock_guard<std::mutex> ringLock(ringLatch);
+			writeFile->writePages(ring, dirtyPages);
+		}
+		catch (...)
+		{
+			//the pages stay in the pool, dirty
+			lock.lock();
+			for (std::size_t i = 0; i < dirtyPages.size(); i++)
+			{
+				BufDesc* tmpbuf = &(bufDescTable[dirtyPages[i].page - bufPool]);
+				tmpbuf->pinCnt = 0;
+				tmpbuf->Publish();
+			}
+			ioDone.notify_all();
+			throw;
+		}
+		lock.lock();
+		bufStats.diskwrites += dirtyPages.size();
+		for (std::size_t i = 0; i < dirtyPages.size(); i++)
+		{
+			BufDesc* tmpbuf = &(bufDescTable[dirtyPages[i].page - bufPool]);
+			BADGERDB_PROBE3(page_writeback, file->filename().c_str(), dirtyPages[i].page_number, dirtyPages[i].page - bufPool);
+			hashTable->remove(file, tmpbuf->pageNo);
+			tmpbuf->Clear();
+		}
+		ioDone.notify_all();
+	}
+	//the file may be closed next, and its File object reused for another file
+	victimCache.removeFile(file);
+	if (spillCache)
+	{
+		spillCache->removeFile(file);
+	}
+	missRatioCurve.removeFile(file);
+	traceAccess(file, 0, TRACE_FLUSH);
+}
+
+int BufMgr::prefetchPages(File* file, const PageId firstPageNo, const PageId endPageNo)
+{
+  std::unique_lock<std::mutex> lock(latch);
+  PageId maxPages = std::max<std::uint32_t>(1, numBufs / 4);
+  PageId lastPageNo = std::min(endPageNo, file->getNumPages());
+  std::vector<PageTransfer> pages;
+  for (PageId pageNo = firstPageNo; pageNo < lastPageNo && pages.size() < maxPages; pageNo++)
+  {
+    FrameId frameNo = 0;
+    if (hashTable->tryLookup(file, pageNo, frameNo))
+    {
+      continue;
+    }
+    try
+    {
+      allocBuf(lock, frameNo);
+    }
+    catch (const BufferExceededException &e)
+    {
+      break;
+    }
+    catch (...)
+    {
+      //writing back a dirty victim failed; the frames set up so far would stay pinned and in progress
+      abandonTransfers(file, pages);
+      throw;
+    }
+    //another thread may have read the page in while allocBuf wrote a page back
+    FrameId otherFrameNo;
+    if (hashTable->tryLookup(file, pageNo, otherFrameNo))
+    {
+      continue;
+    }
+    //pinned and in progress until read, so that allocBuf does not hand the frame out again and readers wait
+    bufDescTable[frameNo].Set(file, pageNo);
+    hashTable->insert(file, pageNo, frameNo);
+    //read from the file again; the copy in the victim cache, if any, would go stale
+    victimCache.remove(file, pageNo);
+    if (spillCache)
+    {
+      spillCache->remove(file, pageNo);
+    }
+    PageTransfer transfer = {pageNo, &bufPool[frameNo], poolBufferIndex, false};
+    pages.push_back(transfer);
+  }
+  if (pages.empty())
+  {
+    return 0;
+  }
+
+  lock.unlock();
+  try
+  {
+    std::lock_guard<std::mutex> ringLock(ringLatch);
+    file->readPages(ring, pages);
+  }
+  catch (...)
+  {
+    lock.lock();
+    abandonTransfers(file, pages);
+    throw;
+  }
+  lock.lock();
+  int numRead = 0;
+  for (std::size_t i = 0; i < pages.size(); i++)
+  {
+    BufDesc* tmpbuf = &(bufDescTable[pages[i].page - bufPool]);
+    if (pages[i].valid)
+    {
+      tmpbuf->pinCnt = 0;
+      tmpbuf->Publish();
+      traceAccess(file, pages[i].page_number, TRACE_PREFETCH);
+      numRead++;
+    }
+    else
+    {
+      hashTable->remove(file, pages[i].page_number);
+      tmpbuf->Clear();
+    }
+  }
+  bufStats.diskreads += numRead;
+  ioDone.notify_all();
+  return numRead;
+}
+
+void BufMgr::abandonTransfers(const File* file, const std::vector<PageTransfer>& pages)
+{
+  for (std::size_t i = 0; i < pages.size(); i++)
+  {
+    hashTable->remove(file, pages[i].page_number);
+    bufDescTable[pages[i].page - bufPool].Clear();
+  }
+  ioDone.notify_all();
 }
 
 void BufMgr::disposePage(File* file, const PageId pageNo)
 {
+  std::unique_lock<std::mutex> lock(latch);
 	//Deallocate from file altogether
-  //See if it is in the buffer pool
+  //See if it is in the buffer pool; an evicted page may be only in the victim or spill cache
   FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
-
-	// clear the page
-	bufDescTable[frameNo].Clear();
-
-	hashTable->remove(file, pageNo);
+  if (lookupPublishedFrame(lock, file, pageNo, frameNo))
+  {
+    // clear the page
+    bufDescTable[frameNo].Clear();
+    hashTable->remove(file, pageNo);
+  }
+	victimCache.remove(file, pageNo);
+	if (spillCache)
+	{
+		spillCache->remove(file, pageNo);
+	}
+	missRatioCurve.remove(file, pageNo);
 
   // deallocate it in the file	
   file->deletePage(pageNo);
+  traceAccess(file, pageNo, TRACE_DISPOSE);
+}
+
+void BufMgr::startTrace(const std::string& traceFileName)
+{
+  std::unique_ptr<AccessTraceWriter> started(new AccessTraceWriter(traceFileName));
+  std::lock_guard<std::mutex> lock(latch);
+  trace.swap(started);
+}
+
+void BufMgr::stopTrace()
+{
+  std::unique_ptr<AccessTraceWriter> stopped;
+  {
+    std::lock_guard<std::mutex> lock(latch);
+    trace.swap(stopped);
+  }
+  // the buffered records are written out without the latch
+  if (stopped)
+  {
+    stopped->flush();
+  }
+}
+
+double BufMgr::estimateHitRatio(const std::uint32_t frames)
+{
+  std::lock_guard<std::mutex> lock(latch);
+  return missRatioCurve.hitRatio(frames);
+}
+
+void BufMgr::setMissRatioSampling(const double rate, const std::size_t maxPages)
+{
+  std::lock_guard<std::mutex> lock(latch);
+  missRatioCurve = MissRatioCurve(numBufs, rate, maxPages);
+}
+
+BufStats & BufMgr::getBufStats()
+{
+  std::lock_guard<std::mutex> lock(latch);
+  bufStats.halfPoolHitRatio = missRatioCurve.hitRatio(numBufs / 2);
+  bufStats.poolHitRatio = missRatioCurve.hitRatio(numBufs);
+  bufStats.doublePoolHitRatio = missRatioCurve.hitRatio(std::uint64_t(numBufs) * 2);
+  bufStats.quadruplePoolHitRatio = missRatioCurve.hitRatio(std::uint64_t(numBufs) * 4);
+  return bufStats;
+}
+
+void BufMgr::clearBufStats()
+{
+  std::lock_guard<std::mutex> lock(latch);
+  bufStats.clear();
+  missRatioCurve.clear();
 }
 
 void BufMgr::printSelf(void) 
 {
+  std::lock_guard<std::mutex> lock(latch);
   BufDesc* tmpbuf;
 	int validFrames = 0;
   
@@ -9,7 +9,17 @@
 
 #include "file.h"
 #include "bufHashTbl.h"
+#include "victim_cache.h"
+#include "spill_cache.h"
+#include "access_trace.h"
+#include "miss_ratio_curve.h"
+#include "memory_tracker.h"
+#include <atomic>
+#include <condition_variable>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
 
 namespace badgerdb {
 
@@ -18,6 +28,13 @@ namespace badgerdb {
 */
 class BufMgr;
 
+class TaskScheduler;
+
+/**
+ * @brief Default number of pages sequential scans ask BufMgr::prefetchPages to read ahead.
+ */
+const PageId READAHEADPAGES = 16;
+
 /**
 * @brief Class for maintaining information about buffer pool frames
 */
@@ -57,15 +74,23 @@ class BufDesc {
   bool valid;
 
 	/**
-   * Has this buffer frame been reference recently
+   * Has this buffer frame been reference recently. Atomic as optimistic reads set it without the latch.
+	 */
+  std::atomic<bool> refbit;
+
+	/**
+   * Version of the frame, bumped when the frame is released and when it gets a page. Odd while the frame holds no
+   * page or its page is being read in or written back. A PageSwip or an optimistic read taken at an even version is good for as long
+   * as the version does not change.
 	 */
-  bool refbit;
+  std::atomic<std::uint32_t> generation;
 
 	/**
    * Initialize buffer frame for a new user
 	 */
   void Clear()
 	{
+    MarkInProgress();
     pinCnt = 0;
 		file = NULL;
 		pageNo = Page::INVALID_NUMBER;
@@ -91,6 +116,41 @@ class BufDesc {
     refbit = true;
   }
 
+	/**
+	 * Mark the frame in progress, making its generation odd, unless it is already.
+	 */
+  void MarkInProgress()
+	{
+    std::uint32_t current = generation.load(std::memory_order_relaxed);
+    if ((current & 1) == 0)
+    {
+      //the odd version is visible before the frame is overwritten, as in a seqlock
+      generation.store(current + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+    }
+  }
+
+	/**
+	 * Whether the page of the frame is being read in or written back without the latch: the frame holds a page
+	 * but has not been published since it was last marked in progress.
+	 */
+  bool InProgress() const
+	{
+    return valid && (generation.load(std::memory_order_relaxed) & 1) != 0;
+  }
+
+	/**
+	 * Make the version even again once the page of the frame has been read in or allocated.
+	 */
+  void Publish()
+	{
+    std::uint32_t current = generation.load(std::memory_order_relaxed);
+    if ((current & 1) != 0)
+    {
+      generation.store(current + 1, std::memory_order_release);
+    }
+  }
+
   void Print()
 	{
 		if(file != NULL)
@@ -111,12 +171,65 @@ class BufDesc {
    * Constructor of BufDesc class 
 	 */
   BufDesc()
+    : generation(0)
 	{
   	Clear();
   }
 };
 
 
+/**
+* @brief Swizzled reference to a page: the frame holding it and the generation of that frame when it was found.
+* Following a swizzled reference pins the page without looking it up in the hash table. A reference is never
+* unswizzled eagerly: once the clock evicts the page, which first lets it cool down by clearing its refbit, the
+* generation of the frame changes and the next BufMgr::readPage through the reference finds it stale, looks the page
+* up again and swizzles the reference to the new frame. References may be followed and updated by several threads.
+*
+* Pinning through a reference still takes the latch of the BufMgr, so it saves the hash table lookup and nothing else:
+* it does not relieve contention on the latch. Only startOptimisticRead follows a reference without the latch.
+*/
+class PageSwip
+{
+	friend class BufMgr;
+
+ public:
+	/**
+   * Constructor of PageSwip class; the reference starts unswizzled
+	 */
+  PageSwip()
+    : ref(UNSWIZZLED)
+  {
+  }
+
+	/**
+   * True if the reference was swizzled, although the frame may have been released since
+	 */
+  bool swizzled() const
+  {
+    return ref.load(std::memory_order_relaxed) != UNSWIZZLED;
+  }
+
+	/**
+   * Make the reference unswizzled again
+	 */
+  void unswizzle()
+  {
+    ref.store(UNSWIZZLED, std::memory_order_relaxed);
+  }
+
+ private:
+	/**
+   * Value of an unswizzled reference
+	 */
+  static const std::uint64_t UNSWIZZLED = ~std::uint64_t(0);
+
+	/**
+   * Generation of the frame in the high 32 bits, frame number in the low 32 bits
+	 */
+  std::atomic<std::uint64_t> ref;
+};
+
+
 /**
 * @brief Class to maintain statistics of buffer usage 
 */
@@ -137,12 +250,39 @@ struct BufStats
 	 */
   int diskwrites;
 
+	/**
+   * Number of pages read from the victim cache instead of disk
+	 */
+  int victimhits;
+
+	/**
+   * Number of pages read from the spill cache file instead of disk
+	 */
+  int spillhits;
+
+	/**
+   * Number of frames found through the calling thread's frame hints instead of the hash table. A hint only saves the
+   * hash lookup: the latch is taken all the same.
+	 */
+  int hinthits;
+
+	/**
+   * Hit ratios of page reads estimated for pools of half, the same, twice and four times as many frames, from the
+   * sampled reuse distances of the reads since the statistics were last cleared; filled in by BufMgr::getBufStats.
+   * They are the hit ratios of LRU pools, which the clock of BufMgr only approximates, see MissRatioCurve.
+	 */
+  double halfPoolHitRatio;
+  double poolHitRatio;
+  double doublePoolHitRatio;
+  double quadruplePoolHitRatio;
+
 	/**
    * Clear all values 
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = diskreads = diskwrites = victimhits = spillhits = hinthits = 0;
+		halfPoolHitRatio = poolHitRatio = doublePoolHitRatio = quadruplePoolHitRatio = 0;
   }
       
 	/**
@@ -157,6 +297,7 @@ struct BufStats
 
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+* Calls are serialized by a latch, so several threads may read, allocate and unpin pages concurrently.
 */
 class BufMgr 
 {
@@ -186,6 +327,79 @@ class BufMgr
 	 */
   BufStats bufStats;
 
+	/**
+   * Latch held by every public call that reads or changes the frames, the clock or the hash table,
+   * so that the buffer pool can be shared by the workers of a TaskScheduler. Pages stay safe to use
+   * without it while they are pinned.
+   * It is let go while a page is read in by readPage or prefetchPages, or a dirty page is written back before its
+   * frame is reused or by flushFile, so that the transfers of several threads overlap. The frame is pinned and marked in progress
+   * meanwhile; threads wanting its page wait on ioDone.
+	 */
+  std::mutex latch;
+
+	/**
+   * Notified, under the latch, when frames stop being in progress.
+	 */
+  std::condition_variable ioDone;
+
+	/**
+   * Ring performing the batched reads and writes of prefetchPages, flushFile and the destructor.
+   * The buffer pool is registered with it as one buffer.
+	 */
+  IoRing ring;
+
+	/**
+   * Latch serializing the use of the ring, which prefetchPages and flushFile submit to without the latch.
+	 */
+  std::mutex ringLatch;
+
+	/**
+   * Index of the buffer pool among the registered buffers of the ring, -1 if it could not be registered
+	 */
+  int poolBufferIndex;
+
+	/**
+   * Compressed images of recently evicted pages, consulted before reading from disk
+	 */
+  VictimCache victimCache;
+
+	/**
+   * Local cache file of evicted pages, consulted after the victim cache; nullptr if none
+	 */
+  std::unique_ptr<SpillCache> spillCache;
+
+	/**
+   * Trace the page accesses are recorded to, nullptr if not tracing
+	 */
+  std::unique_ptr<AccessTraceWriter> trace;
+
+	/**
+   * Online estimate of the hit ratio at other pool sizes, from sampled reuse distances of the page reads
+	 */
+  MissRatioCurve missRatioCurve;
+
+	/**
+   * Record a page access if tracing. Called under the latch.
+	 */
+  void traceAccess(const File* file, const PageId pageNo, const TraceOp op)
+  {
+		if (trace)
+		{
+			trace->record(file, pageNo, op);
+		}
+  }
+
+	/**
+   * Account for a page read in the miss ratio curve, the trace and the page_hit or page_miss probe. Called under the
+   * latch.
+	 *
+	 * @param sampleHash	MissRatioCurve::sampleHash of the page, computed before the latch was taken
+	 * @param frameNo		Frame now holding the page
+	 * @param hit				True if the page was in the pool already
+	 */
+  void recordRead(const File* file, const PageId pageNo, const std::uint32_t sampleHash, const FrameId frameNo,
+                  const bool hit);
+
 	/**
    * Advance clock to next frame in the buffer pool
 	 */
@@ -195,12 +409,93 @@ class BufMgr
   }
 
 	/**
-	 * Allocate a free frame.  
+	 * Allocate a free frame. Called with the latch held; the latch is let go while the page the frame held is
+	 * written back, if it is dirty, so the pages in the pool may have changed when it returns.
 	 *
+	 * @param lock			Lock holding the latch
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  void allocBuf(FrameId & frame);
+  void allocBuf(std::unique_lock<std::mutex>& lock, FrameId & frame);
+
+	/**
+	 * Find the frame holding a page, first through the small cache of frame hints of the calling thread, which holds
+	 * the frames of the pages it used last and is checked against the frame descriptors, then through the hash table.
+	 * Called with the latch held, which the hints do not spare.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frameNo Frame number reference, set only if the page is found
+	 * @return true if the page is in the buffer pool
+	 */
+  bool lookupFrame(const File* file, const PageId pageNo, FrameId& frameNo);
+
+	/**
+	 * Find the frame holding a page like lookupFrame, waiting for the page while it is being read in or written back.
+	 *
+	 * @param lock			Lock holding the latch
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frameNo Frame number reference, set only if the page is found
+	 * @return true if the page is in the buffer pool
+	 */
+  bool lookupPublishedFrame(std::unique_lock<std::mutex>& lock, const File* file, const PageId pageNo,
+                            FrameId& frameNo);
+
+	/**
+	 * Remember the frame of a page among the frame hints of the calling thread. Called with the latch held.
+	 */
+  void rememberFrame(const File* file, const PageId pageNo, const FrameId frameNo);
+
+	/**
+	 * Give up on pages set up for a read that will not happen: unhash them, release their frames and wake the
+	 * threads waiting for them. Called with the latch held.
+	 *
+	 * @param file   	File object
+	 * @param pages		Pages whose frames are pinned and in progress
+	 */
+  void abandonTransfers(const File* file, const std::vector<PageTransfer>& pages);
+
+	/**
+	 * Body of readPage, called with the latch held. The latch is let go while the page is read from the spill cache
+	 * or the file.
+	 *
+	 * @param lock			Lock holding the latch
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @param sampleHash	MissRatioCurve::sampleHash of the page
+	 * @param page  	Reference to page pointer
+	 * @return Frame holding the page
+	 */
+  FrameId readPageLocked(std::unique_lock<std::mutex>& lock, File* file, const PageId pageNo,
+                         const std::uint32_t sampleHash, Page*& page);
+
+	/**
+	 * Pin the page a swizzled reference points to, if it is still there. Called with the latch held.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param sampleHash	MissRatioCurve::sampleHash of the page
+	 * @param swip		Reference to the page
+	 * @param page  	Reference to page pointer, set only if the reference is valid
+	 * @return true if the reference was valid and the page has been pinned
+	 */
+  bool pinSwizzled(const File* file, const PageId pageNo, const std::uint32_t sampleHash, const PageSwip& swip,
+                   Page*& page);
+
+	/**
+	 * Number of buckets of the hash table of a pool of the given number of frames
+	 */
+  static int hashTableSize(const std::uint32_t bufs);
+
+	/**
+	 * Swizzle a reference to the page held by a frame.
+	 */
+  void swizzle(PageSwip& swip, const FrameId frameNo)
+  {
+    swip.ref.store((std::uint64_t(bufDescTable[frameNo].generation.load(std::memory_order_relaxed)) << 32) | frameNo,
+                   std::memory_order_relaxed);
+  }
 
  public:
 	/**
@@ -209,19 +504,44 @@ class BufMgr
   Page* bufPool;
 
 	/**
-   * Constructor of BufMgr class
-	 */
-  BufMgr(std::uint32_t bufs);
+   * Constructor of BufMgr class. The frames, their descriptors and the hash table are accounted for by the
+   * MemoryTracker of the process; the victim and spill caches reserve memory from it as they fill.
+	 *
+	 * @param bufs						Number of frames in the buffer pool
+	 * @param victimCacheBytes	Memory budget of the compressed cache of evicted pages, 0 for none
+	 * @param spillFileName		Name of the local cache file evicted pages spill to
+	 * @param spillPages			Number of pages in the spill cache file, 0 for none
+	 * @throws MemoryBudgetExceededException If the pool does not fit in the memory budget of the process
+	 */
+  BufMgr(std::uint32_t bufs, std::size_t victimCacheBytes = 0, const std::string& spillFileName = "",
+         std::uint32_t spillPages = 0);
 	
 	/**
    * Destructor of BufMgr class
 	 */
   ~BufMgr();
 
+	/**
+	 * Bytes a pool of the given number of frames accounts for: its frames, their descriptors, and its hash table with
+	 * an entry per frame. The caches come on top.
+	 *
+	 * @param bufs						Number of frames
+	 */
+  static std::size_t bytesFor(const std::uint32_t bufs);
+
+	/**
+	 * Largest number of frames of a pool accounting for at most the given bytes, e.g. to size a pool to the memory
+	 * left in the budget: BufMgr(BufMgr::framesWithin(MemoryTracker::process().bytesAvailable() / 2)).
+	 *
+	 * @param bytes						Number of bytes
+	 */
+  static std::uint32_t framesWithin(const std::size_t bytes);
+
 	/**
 	 * Reads the given page from the file into a frame and returns the pointer to page.
 	 * If the requested page is already present in the buffer pool pointer to that frame is returned
-	 * otherwise a new frame is allocated from the buffer pool for reading the page.
+	 * otherwise a new frame is allocated from the buffer pool for reading the page, which is filled from the victim
+	 * cache, or else from the spill cache file, if either holds the page, and from the file otherwise.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
@@ -229,6 +549,112 @@ class BufMgr
 	 */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
+	/**
+	 * Reads the given page like readPage, going through a swizzled reference to it. While the page stays in the frame
+	 * the reference points to, it is pinned without a hash table lookup; otherwise it is read like readPage and the
+	 * reference is swizzled to its frame. Either way the latch is taken as readPage takes it.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param swip		Reference to the page, kept by the caller for every later read of the page
+	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 */
+  void readPage(File* file, const PageId PageNo, PageSwip& swip, Page*& page);
+
+	/**
+	 * Pins the given page if it is already present in the buffer pool, without ever reading it from the file.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file
+	 * @param page  	Reference to page pointer, set only if the page is present.
+	 * @return true if the page was present and has been pinned, false otherwise
+	 */
+  bool readPageIfResident(File* file, const PageId PageNo, Page*& page);
+
+	/**
+	 * Pins the given page like readPageIfResident, going through a swizzled reference to it as readPage does.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file
+	 * @param swip		Reference to the page
+	 * @param page  	Reference to page pointer, set only if the page is present.
+	 * @return true if the page was present and has been pinned, false otherwise
+	 */
+  bool readPageIfResident(File* file, const PageId PageNo, PageSwip& swip, Page*& page);
+
+	/**
+	 * Starts an optimistic read of the page a swizzled reference points to. Neither the latch nor a pin is taken, so
+	 * the page may be evicted and its frame refilled while it is being read: what is read from it is only good if
+	 * validateOptimisticRead accepts the token afterwards, and must not be trusted before, e.g. as an array index
+	 * reaching outside the page. Changes made to a pinned page are not detected; readers must not run concurrently
+	 * with writers of the same page. The refbit of the frame is set, but the read is not recorded in the access trace
+	 * nor the miss ratio curve, which thus under-count the pages read this way.
+	 *
+	 * @param swip		Reference to the page
+	 * @param page  	Reference to page pointer, set to the page, not pinned
+	 * @param token		Token for validateOptimisticRead returned via this reference
+	 * @return false if the reference is not swizzled or stale; the page then has to be read with readPage
+	 */
+  bool startOptimisticRead(const PageSwip& swip, const Page*& page, std::uint64_t& token) const
+  {
+    std::uint64_t ref = swip.ref.load(std::memory_order_relaxed);
+    FrameId frameNo = static_cast<FrameId>(ref);
+    std::uint32_t generation = static_cast<std::uint32_t>(ref >> 32);
+    if (frameNo >= numBufs || (generation & 1) != 0 ||
+        bufDescTable[frameNo].generation.load(std::memory_order_acquire) != generation)
+    {
+      return false;
+    }
+    // keep the page warm for the clock, writing only once the clock has cleared the bit; if the frame was refilled
+    // meanwhile, its new page is warmed instead
+    if (!bufDescTable[frameNo].refbit.load(std::memory_order_relaxed))
+    {
+      bufDescTable[frameNo].refbit.store(true, std::memory_order_relaxed);
+    }
+    page = &bufPool[frameNo];
+    token = ref;
+    return true;
+  }
+
+	/**
+	 * Check that the frame read since startOptimisticRead still holds the same page.
+	 *
+	 * @param token		Token returned by startOptimisticRead
+	 * @return true if the read is good, false if it has to be done again with readPage
+	 */
+  bool validateOptimisticRead(const std::uint64_t token) const
+  {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return bufDescTable[static_cast<FrameId>(token)].generation.load(std::memory_order_relaxed) ==
+           static_cast<std::uint32_t>(token >> 32);
+  }
+
+	/**
+	 * Reads the given page like readPage without blocking the caller on the file.
+	 * A page present in the buffer pool is pinned right away and returned in a ready future; otherwise the read
+	 * runs on a worker of the scheduler and the future becomes ready, or holds its exception, once it is done.
+	 * The worker reads the page without holding the latch of the buffer manager, so reads of different pages overlap,
+	 * up to one per worker.
+	 *
+	 * @param scheduler	Scheduler whose workers read missing pages
+	 * @param file   		File object
+	 * @param PageNo  	Page number in the file to be read
+	 * @return Future of the pinned page
+	 */
+  std::future<Page*> readPageAsync(TaskScheduler &scheduler, File* file, const PageId PageNo);
+
+	/**
+	 * Reads the pages of a range that are not in the buffer pool with one batch of reads, leaving them unpinned.
+	 * Used for read-ahead by sequential scans and to warm the pool up. At most a quarter of the pool is read per
+	 * call, so that read-ahead does not push out the pages in use; pages that do not exist or are not used are skipped.
+	 *
+	 * @param file   				File object
+	 * @param firstPageNo		First page number of the range
+	 * @param endPageNo			One past the last page number of the range
+	 * @return Number of pages read
+	 */
+  int prefetchPages(File* file, const PageId firstPageNo, const PageId endPageNo);
+
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
 	 *
@@ -250,7 +676,7 @@ class BufMgr
   void allocPage(File* file, PageId &PageNo, Page*& page); 
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
+	 * Writes out all dirty pages of the file to disk, with one batch of writes.
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
 	 * Otherwise Error returned.
 	 *
@@ -275,20 +701,67 @@ class BufMgr
   void  printSelf();
 
 	/**
-   * Get buffer pool usage statistics
+	 * Start recording the page accesses to a trace file, for replay by the bufsim tool at other pool sizes and
+	 * under other replacement policies. Reads, allocations, unpins (clean or dirty), read-ahead pages, disposed pages
+	 * and flushed files are recorded; optimistic reads through startOptimisticRead take no latch and are not.
+	 * A trace already being recorded is closed first.
+	 *
+	 * @param traceFileName	Name of the trace file, replaced if it exists
+	 * @throws BadTraceException If the trace file cannot be created
+	 */
+  void startTrace(const std::string& traceFileName);
+
+	/**
+	 * Stop recording page accesses and close the trace file.
+	 *
+	 * @throws BadTraceException If writing the trace failed, or it named more files than it has ids for; the trace is
+	 *                           truncated then
 	 */
-  BufStats & getBufStats()
+  void stopTrace();
+
+	/**
+   * Get the compressed cache of evicted pages
+	 */
+  const VictimCache & getVictimCache() const
   {
-		return bufStats;
+		return victimCache;
   }
 
 	/**
-   * Clear buffer pool usage statistics
+   * Get the local cache file of evicted pages, nullptr if none
 	 */
-  void clearBufStats() 
+  SpillCache * getSpillCache()
   {
-		bufStats.clear();
+		return spillCache.get();
   }
+
+	/**
+	 * Estimated hit ratio of the page reads since the statistics were last cleared, had the pool the given number of
+	 * frames. Estimated from the reuse distances of a sample of the pages, for an LRU pool of up to MRCMAXSCALE times
+	 * the size of this one; larger sizes are estimated as that size.
+	 *
+	 * @param frames		Number of frames
+	 */
+  double estimateHitRatio(const std::uint32_t frames);
+
+	/**
+	 * Restart the miss ratio curve with another sampling of the pages. Higher rates give better estimates for small
+	 * pools at the cost of more work per read; the rate drops by itself once more pages are sampled than the limit.
+	 *
+	 * @param rate					Fraction of the pages sampled, in (0, 1]
+	 * @param maxPages			Largest number of pages sampled at once
+	 */
+  void setMissRatioSampling(const double rate, const std::size_t maxPages = MRCSAMPLEDPAGES);
+
+	/**
+   * Get buffer pool usage statistics, with the hit ratios estimated at other pool sizes brought up to date
+	 */
+  BufStats & getBufStats();
+
+	/**
+   * Clear buffer pool usage statistics
+	 */
+  void clearBufStats();
 };
 
 }
@@ -0,0 +1,111 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Buffer pool simulator. Replays an access trace recorded by BufMgr::startTrace through models of the CLOCK policy
+ * of BufMgr, LRU, 2Q and ARC at a range of pool sizes, and prints the miss ratio of each policy at each size: the
+ * miss ratio curves to size a buffer pool and pick its policy from.
+ *
+ * Only page reads count as hits or misses. Allocated and read-ahead pages enter the pool without counting, disposed
+ * pages and flushed files leave it. Pins are not modelled, so no page is ever held in the pool against the policy,
+ * and neither are the victim and spill caches behind the pool; the CLOCK column is the miss ratio of BufMgr without
+ * those caches and with few pages pinned at a time.
+ *
+ * Build with "make bufsim".
+ * Usage: badgerdb_bufsim trace [frames ...]
+ * Without frame counts, the pool sizes are the powers of two from 8 up to the number of distinct pages.
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+#include "access_trace.h"
+#include "pool_model.h"
+#include "exceptions/badgerdb_exception.h"
+
+using namespace badgerdb;
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " trace [frames ...]" << std::endl;
+		return 1;
+	}
+
+	std::vector<TraceRecord> trace;
+	std::size_t numFiles = 0;
+	try
+	{
+		AccessTraceReader reader(argv[1]);
+		TraceRecord record;
+		while (reader.next(record))
+		{
+			trace.push_back(record);
+		}
+		numFiles = reader.numFiles();
+	}
+	catch (const BadgerDbException &e)
+	{
+		std::cerr << e.message() << std::endl;
+		return 1;
+	}
+
+	std::unordered_set<TracePageKey> distinctPages;
+	std::uint64_t reads = 0;
+	for (std::size_t i = 0; i < trace.size(); i++)
+	{
+		if (trace[i].op == TRACE_READ || trace[i].op == TRACE_ALLOC || trace[i].op == TRACE_PREFETCH)
+		{
+			distinctPages.insert(tracePageKey(trace[i]));
+		}
+		reads += trace[i].op == TRACE_READ;
+	}
+
+	std::vector<std::size_t> poolSizes;
+	for (int i = 2; i < argc; i++)
+	{
+		if (atol(argv[i]) > 0)
+		{
+			poolSizes.push_back(atol(argv[i]));
+		}
+	}
+	if (poolSizes.empty())
+	{
+		for (std::size_t frames = 8; ; frames *= 2)
+		{
+			poolSizes.push_back(frames);
+			if (frames >= distinctPages.size())
+			{
+				break;
+			}
+		}
+	}
+
+	std::cout << trace.size() << " accesses, " << reads << " page reads of " << distinctPages.size()
+			  << " distinct pages in " << numFiles << " files" << std::endl;
+	std::cout << "frames";
+	for (int p = 0; p < NUMPOLICIES; p++)
+	{
+		std::cout << "\t" << policyNames[p];
+	}
+	std::cout << std::endl << std::fixed << std::setprecision(4);
+	for (std::size_t s = 0; s < poolSizes.size(); s++)
+	{
+		std::cout << poolSizes[s];
+		for (int p = 0; p < NUMPOLICIES; p++)
+		{
+			std::unique_ptr<PoolModel> model(makeModel(p, poolSizes[s]));
+			std::cout << "\t" << replay(trace, *model);
+		}
+		std::cout << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,26 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "memory_budget_exceeded_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+MemoryBudgetExceededException::MemoryBudgetExceededException(
+    const std::string& component, const std::size_t bytes,
+    const std::size_t budget)
+    : BadgerDbException(""), component_(component), bytes_(bytes),
+      budget_(budget) {
+  std::stringstream ss;
+  ss << "Memory budget of " << budget_ << " bytes exceeded by a request of "
+     << bytes_ << " bytes for " << component_;
+  message_.assign(ss.str());
+}
+
+}
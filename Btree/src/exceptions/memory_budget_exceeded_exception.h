@@ -0,0 +1,62 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when memory is requested that would take
+ *        the process over the budget of its MemoryTracker.
+ */
+class MemoryBudgetExceededException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a memory budget exceeded exception for the given request.
+   *
+   * @param component  Name of the component requesting the memory.
+   * @param bytes      Number of bytes requested.
+   * @param budget     Budget of the tracker, in bytes.
+   */
+  MemoryBudgetExceededException(const std::string& component,
+                                const std::size_t bytes,
+                                const std::size_t budget);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~MemoryBudgetExceededException() throw() {}
+
+  /**
+   * Returns the number of bytes requested.
+   */
+  virtual std::size_t bytes() const { return bytes_; }
+
+ protected:
+  /**
+   * Name of the component requesting the memory.
+   */
+  const std::string component_;
+
+  /**
+   * Number of bytes requested.
+   */
+  const std::size_t bytes_;
+
+  /**
+   * Budget of the tracker, in bytes.
+   */
+  const std::size_t budget_;
+};
+
+}
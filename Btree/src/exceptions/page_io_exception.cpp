@@ -0,0 +1,28 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_io_exception.h"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+PageIoException::PageIoException(
+    const PageId page_number, const std::string& file, const int error)
+    : BadgerDbException(""),
+      page_number_(page_number),
+      filename_(file),
+      error_(error) {
+  std::stringstream ss;
+  ss << "Transfer of page " << page_number_
+     << " of file '" << filename_ << "' failed: " << strerror(error_);
+  message_.assign(ss.str());
+}
+
+}
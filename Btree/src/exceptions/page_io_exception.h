@@ -0,0 +1,72 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when the operating system fails a
+ *        batched read or write of a page.
+ */
+class PageIoException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page I/O exception for the given page number, filename and
+   * error number.
+   *
+   * @param page_number  Page number whose transfer failed.
+   * @param file         Name of file that the transfer was made to.
+   * @param error        Error number reported by the operating system.
+   */
+  PageIoException(const PageId page_number, const std::string& file,
+                  const int error);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~PageIoException() throw() {}
+
+  /**
+   * Returns the page number whose transfer failed.
+   */
+  virtual PageId page_number() const { return page_number_; }
+
+  /**
+   * Returns name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+  /**
+   * Returns the error number reported by the operating system.
+   */
+  virtual int error() const { return error_; }
+
+ protected:
+  /**
+   * Page number whose transfer failed.
+   */
+  const PageId page_number_;
+
+  /**
+   * Name of file which caused this exception.
+   */
+  const std::string filename_;
+
+  /**
+   * Error number reported by the operating system.
+   */
+  const int error_;
+};
+
+}
@@ -11,22 +11,136 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <algorithm>
+#include <cstdint>
+#include <map>
 #include <cstdio>
+#include <cstring>
+#include <cstddef>
 #include <cassert>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_io_exception.h"
 #include "file_iterator.h"
 #include "page.h"
+#include "page_codec.h"
+#include "probes.h"
 
 namespace badgerdb {
 
+/**
+ * Header of a compressed file, following the FileHeader. Its magic number
+ * cannot start a raw file: there it would be read as the free space bounds of
+ * page 1, which are at most Page::SIZE.
+ */
+struct CompressedFileHeader {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint64_t first_map_chunk;
+};
+
+static const std::uint32_t COMPRESSED_MAGIC = 0xBADC0DE5;
+static const std::uint32_t COMPRESSED_VERSION = 1;
+
+/**
+ * Position and size of the stored image of a page of a compressed file.
+ */
+struct PageExtent {
+  std::uint64_t offset;
+  // Bytes reserved for the image, 0 if the page has never been written.
+  std::uint32_t capacity;
+  // Bytes used; Page::SIZE for an image stored uncompressed.
+  std::uint32_t length;
+};
+
+/**
+ * Number of page offset map entries in one chunk.
+ */
+static const std::size_t MAP_CHUNK_ENTRIES =
+    (Page::SIZE - 2 * sizeof(std::uint64_t)) / sizeof(PageExtent);
+
+/**
+ * Chunk of the page offset map, covering MAP_CHUNK_ENTRIES consecutive page
+ * numbers. Chunks are chained from the CompressedFileHeader.
+ */
+struct MapChunk {
+  std::uint64_t next_chunk;
+  std::uint64_t unused;
+  PageExtent slots[MAP_CHUNK_ENTRIES];
+};
+
+static_assert(sizeof(MapChunk) == Page::SIZE,
+              "Map chunks must be exactly one page long.");
+
+/**
+ * Slot sizes are multiples of this, so that a page can grow a little in place.
+ */
+static const std::uint32_t SLOT_GRANULE = 256;
+
+/**
+ * Offset of the first slot of a compressed file.
+ */
+static const std::uint64_t DATA_OFFSET =
+    sizeof(FileHeader) + sizeof(CompressedFileHeader);
+
+/**
+ * In memory copy of the page offset map of an open compressed file, and its
+ * free space.
+ */
+struct CompressedLayout {
+  // Slot of each page, indexed by page number.
+  std::vector<PageExtent> slots;
+  // Offset of each map chunk.
+  std::vector<std::uint64_t> map_chunks;
+  // Unused space between slots, by size.
+  std::multimap<std::uint64_t, std::uint64_t> free_space;
+  // End of the last slot or chunk.
+  std::uint64_t end_offset;
+
+  /**
+   * Reserves space for a slot, from the free space if some is large enough,
+   * at the end of the file otherwise.
+   */
+  std::uint64_t allocate(const std::uint64_t size) {
+    std::multimap<std::uint64_t, std::uint64_t>::iterator hole =
+        free_space.lower_bound(size);
+    if (hole == free_space.end()) {
+      const std::uint64_t offset = end_offset;
+      end_offset += size;
+      return offset;
+    }
+    const std::uint64_t offset = hole->second;
+    const std::uint64_t left = hole->first - size;
+    free_space.erase(hole);
+    release(offset + size, left);
+    return offset;
+  }
+
+  /**
+   * Returns space to the free space.
+   */
+  void release(const std::uint64_t offset, const std::uint64_t size) {
+    if (size >= SLOT_GRANULE) {
+      free_space.insert(std::make_pair(size, offset));
+    }
+  }
+};
+
 File::StreamMap File::open_streams_;
 File::CountMap File::open_counts_;
+File::CountMap File::open_fds_;
+File::LayoutMap File::open_layouts_;
+File::LatchMap File::open_latches_;
+std::recursive_mutex File::open_files_latch_;
 
 void File::remove(const std::string& filename) {
+  std::lock_guard<std::recursive_mutex> lock(open_files_latch_);
   if (!exists(filename)) {
     throw FileNotFoundException(filename);
   }
@@ -37,6 +151,7 @@ void File::remove(const std::string& filename) {
 }
 
 bool File::isOpen(const std::string& filename) {
+  std::lock_guard<std::recursive_mutex> lock(open_files_latch_);
   if (!exists(filename)) {
     return false;
   }
@@ -64,7 +179,14 @@ PageId File::getFirstPageNo() {
   return header.first_used_page;
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
+PageId File::getNumPages() {
+  const FileHeader& header = readHeader();
+  return header.num_pages;
+}
+
+File::File(const std::string& name, const bool create_new,
+           const FileCompression compression)
+    : filename_(name), fd_(-1) {
   openIfNeeded(create_new);
 
   if (create_new) {
@@ -72,13 +194,23 @@ File::File(const std::string& name, const bool create_new) : filename_(name) {
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
                          0 /* num_free_pages */, 0 /* first_free_page */};
     writeHeader(header);
+    if (compression == COMPRESSED_PAGES) {
+      createLayout();
+    }
   }
 }
 
 void File::openIfNeeded(const bool create_new) {
+  std::lock_guard<std::recursive_mutex> lock(open_files_latch_);
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
     stream_ = open_streams_[filename_];
+    fd_ = open_fds_[filename_];
+    latch_ = open_latches_[filename_];
+    LayoutMap::iterator layout = open_layouts_.find(filename_);
+    if (layout != open_layouts_.end()) {
+      layout_ = layout->second;
+    }
   } else {
     std::ios_base::openmode mode =
         std::fstream::in | std::fstream::out | std::fstream::binary;
@@ -97,25 +229,48 @@ void File::openIfNeeded(const bool create_new) {
       }
     }
     stream_.reset(new std::fstream(filename_, mode));
+    fd_ = ::open(filename_.c_str(), O_RDWR);
+    if (fd_ < 0) {
+      throw FileOpenException(filename_);
+    }
+    latch_.reset(new std::recursive_mutex());
     open_streams_[filename_] = stream_;
+    open_fds_[filename_] = fd_;
+    open_latches_[filename_] = latch_;
     open_counts_[filename_] = 1;
+    if (!create_new) {
+      loadLayout();
+    }
   }
 }
 
 void File::close() {
+  std::lock_guard<std::recursive_mutex> lock(open_files_latch_);
 	if(open_counts_[filename_] > 0)
   	--open_counts_[filename_];
 
   stream_.reset();
+  fd_ = -1;
+  layout_.reset();
 	assert(open_counts_[filename_] >= 0);
 
   if (open_counts_[filename_] == 0) {
     open_streams_.erase(filename_);
     open_counts_.erase(filename_);
+    open_layouts_.erase(filename_);
+    open_latches_.erase(filename_);
+    CountMap::iterator fd = open_fds_.find(filename_);
+    if (fd != open_fds_.end()) {
+      if (fd->second >= 0) {
+        ::close(fd->second);
+      }
+      open_fds_.erase(fd);
+    }
   }
 }
 
 FileHeader File::readHeader() const {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
   FileHeader header;
   stream_->seekg(0 /* pos */, std::ios::beg);
   stream_->read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
@@ -123,11 +278,49 @@ FileHeader File::readHeader() const {
 }
 
 void File::writeHeader(const FileHeader& header) {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
   stream_->seekp(0 /* pos */, std::ios::beg);
   stream_->write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
   stream_->flush();
 }
 
+IoRequest File::pageRequest(const PageId page_number, const std::size_t offset,
+                            const bool write, char* buffer,
+                            const std::size_t length,
+                            const int buffer_index) const {
+  IoRequest request;
+  request.fd = fd_;
+  request.write = write;
+  request.offset = static_cast<std::uint64_t>(pagePosition(page_number)) + offset;
+  request.buffer = buffer;
+  request.length = length;
+  request.bufferIndex = buffer_index;
+  request.result = 0;
+  return request;
+}
+
+void File::submitRequests(IoRing& ring, std::vector<IoRequest>& requests,
+                          const std::vector<PageId>& page_numbers) const {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
+  ring.submit(requests.data(), requests.size());
+  for (std::size_t i = 0; i < requests.size(); ++i) {
+    const IoRequest& request = requests[i];
+    if (request.result < 0) {
+      throw PageIoException(page_numbers[i], filename_, -request.result);
+    }
+    if (request.write) {
+      BADGERDB_PROBE3(file_write, filename_.c_str(), page_numbers[i], request.result);
+    } else {
+      BADGERDB_PROBE3(file_read, filename_.c_str(), page_numbers[i], request.result);
+    }
+    if (!request.write &&
+        static_cast<std::size_t>(request.result) < request.length) {
+      memset(request.buffer + request.result, 0,
+             request.length - request.result);
+    }
+  }
+}
+
 
 
 
@@ -140,8 +333,9 @@ PageFile PageFile::open(const std::string& filename) {
   return PageFile(filename, false /* create_new */);
 }
 
-PageFile::PageFile(const std::string& name, const bool create_new)
-: File(name, create_new)
+PageFile::PageFile(const std::string& name, const bool create_new,
+                   const FileCompression compression)
+: File(name, create_new, compression)
 {
 }
 
@@ -163,6 +357,7 @@ PageFile& PageFile::operator=(const PageFile& rhs) {
 }
 
 Page PageFile::allocatePage(PageId &new_page_number) {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
   FileHeader header = readHeader();
   Page new_page;
   Page existing_page;
@@ -247,9 +442,7 @@ Page PageFile::readPage(const PageId page_number) const {
 
 Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(PageHeader));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
+  readImage(page_number, reinterpret_cast<char*>(&page), Page::SIZE);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
@@ -258,6 +451,7 @@ Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
 }
 
 void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
 	PageHeader header = readPageHeader(new_page_number);
 	if (header.current_page_number == Page::INVALID_NUMBER)
 	{
@@ -274,6 +468,7 @@ void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
 }
 
 void PageFile::deletePage(const PageId page_number) {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
   FileHeader header = readHeader();
 
   Page existing_page = readPage(page_number);
@@ -315,16 +510,318 @@ FileIterator PageFile::end() {
 
 void PageFile::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
+  writeImage(page_number, header, new_page.data_);
+}
+
+/**
+ * Decompresses the stored image of a page of a compressed file.
+ */
+static void decodeImage(const std::string& filename, const PageId page_number,
+                        const char* stored, const std::size_t stored_length,
+                        char* image, const std::size_t length) {
+  if (stored_length == Page::SIZE) {
+    memcpy(image, stored, length);
+    return;
+  }
+  char full[Page::SIZE];
+  if (!decompressPage(stored, stored_length, full, Page::SIZE)) {
+    throw PageIoException(page_number, filename, EIO);
+  }
+  memcpy(image, full, length);
+}
+
+void File::readImage(const PageId page_number, char* image,
+                     const std::size_t length) const {
+  if (!layout_) {
+    readAt(page_number, pagePosition(page_number), image, length);
+    BADGERDB_PROBE3(file_read, filename_.c_str(), page_number, length);
+    return;
+  }
+  PageExtent slot = PageExtent();
+  {
+    std::lock_guard<std::recursive_mutex> lock(*latch_);
+    if (page_number < layout_->slots.size()) {
+      slot = layout_->slots[page_number];
+    }
+  }
+  if (slot.capacity == 0) {
+    memset(image, 0, length);
+    return;
+  }
+  char stored[Page::SIZE];
+  readAt(page_number, slot.offset, stored, slot.length);
+  BADGERDB_PROBE3(file_read, filename_.c_str(), page_number, slot.length);
+  decodeImage(filename_, page_number, stored, slot.length, image, length);
+}
+
+void File::readAt(const PageId page_number, const std::uint64_t offset,
+                  char* buffer, const std::size_t length) const {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t result = ::pread(fd_, buffer + done, length - done,
+                                   offset + done);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
+      throw PageIoException(page_number, filename_, errno);
+    }
+    if (result == 0) {
+      memset(buffer + done, 0, length - done);
+      return;
+    }
+    done += result;
+  }
+}
+
+void File::writeImage(const PageId page_number, const PageHeader& header,
+                      const char* data) {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
+  if (!layout_) {
+    stream_->seekp(pagePosition(page_number), std::ios::beg);
+    stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
+    stream_->write(data, Page::DATA_SIZE);
+    stream_->flush();
+    BADGERDB_PROBE3(file_write, filename_.c_str(), page_number, Page::SIZE);
+    return;
+  }
+  char image[Page::SIZE];
+  memcpy(image, &header, sizeof(PageHeader));
+  memcpy(image + sizeof(PageHeader), data, Page::DATA_SIZE);
+  char packed[compressBound(Page::SIZE)];
+  std::size_t length = compressPage(image, Page::SIZE, packed);
+  const char* stored = packed;
+  if (length >= Page::SIZE) {
+    // Incompressible; store the image as is.
+    stored = image;
+    length = Page::SIZE;
+  }
+
+  extendLayout(page_number);
+  PageExtent& slot = layout_->slots[page_number];
+  if (slot.capacity < length) {
+    // Move the page to a larger slot.
+    layout_->release(slot.offset, slot.capacity);
+    slot.capacity =
+        (length + SLOT_GRANULE - 1) / SLOT_GRANULE * SLOT_GRANULE;
+    slot.offset = layout_->allocate(slot.capacity);
+  }
+  slot.length = length;
+  stream_->seekp(slot.offset, std::ios::beg);
+  stream_->write(stored, length);
+  const std::uint64_t chunk =
+      layout_->map_chunks[page_number / MAP_CHUNK_ENTRIES];
+  stream_->seekp(chunk + offsetof(MapChunk, slots) +
+                     (page_number % MAP_CHUNK_ENTRIES) * sizeof(PageExtent),
+                 std::ios::beg);
+  stream_->write(reinterpret_cast<const char*>(&slot), sizeof(PageExtent));
   stream_->flush();
+  BADGERDB_PROBE3(file_write, filename_.c_str(), page_number, length);
+}
+
+void File::readImages(IoRing& ring,
+                      std::vector<PageTransfer>& transfers) const {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
+  std::vector<IoRequest> requests;
+  std::vector<PageId> page_numbers;
+  // Stored images of a compressed file, decompressed once all are read.
+  std::vector<char> stored(layout_ ? transfers.size() * Page::SIZE : 0);
+  for (std::size_t i = 0; i < transfers.size(); ++i) {
+    const PageTransfer& transfer = transfers[i];
+    if (!transfer.valid) {
+      continue;
+    }
+    if (!layout_) {
+      requests.push_back(pageRequest(transfer.page_number, 0, false /* write */,
+                                     reinterpret_cast<char*>(transfer.page),
+                                     Page::SIZE, transfer.buffer_index));
+      page_numbers.push_back(transfer.page_number);
+      continue;
+    }
+    const PageExtent slot = transfer.page_number < layout_->slots.size() ?
+        layout_->slots[transfer.page_number] : PageExtent();
+    if (slot.capacity == 0) {
+      memset(reinterpret_cast<char*>(transfer.page), 0, Page::SIZE);
+      continue;
+    }
+    IoRequest request = {fd_, false /* write */, slot.offset,
+                         &stored[i * Page::SIZE], slot.length,
+                         -1 /* bufferIndex */, 0 /* result */};
+    requests.push_back(request);
+    page_numbers.push_back(transfer.page_number);
+  }
+  submitRequests(ring, requests, page_numbers);
+
+  for (std::size_t i = 0; layout_ && i < transfers.size(); ++i) {
+    const PageTransfer& transfer = transfers[i];
+    if (transfer.valid && transfer.page_number < layout_->slots.size() &&
+        layout_->slots[transfer.page_number].capacity > 0) {
+      decodeImage(filename_, transfer.page_number, &stored[i * Page::SIZE],
+                  layout_->slots[transfer.page_number].length,
+                  reinterpret_cast<char*>(transfer.page), Page::SIZE);
+    }
+  }
+}
+
+void File::createLayout() {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
+  CompressedFileHeader header = {COMPRESSED_MAGIC, COMPRESSED_VERSION,
+                                 0 /* first_map_chunk */};
+  stream_->seekp(sizeof(FileHeader), std::ios::beg);
+  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
+  stream_->flush();
+  layout_.reset(new CompressedLayout());
+  layout_->end_offset = DATA_OFFSET;
+  std::lock_guard<std::recursive_mutex> files_lock(open_files_latch_);
+  open_layouts_[filename_] = layout_;
+}
+
+void File::loadLayout() {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
+  CompressedFileHeader header;
+  stream_->seekg(sizeof(FileHeader), std::ios::beg);
+  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  const bool compressed = stream_->gcount() == sizeof(header) &&
+      header.magic == COMPRESSED_MAGIC;
+  // A raw file too short to hold the header has failed the stream.
+  stream_->clear();
+  if (!compressed) {
+    return;
+  }
+
+  std::shared_ptr<CompressedLayout> layout(new CompressedLayout());
+  // Extents of the chunks and slots in use, to find the free space between
+  // them.
+  std::vector<std::pair<std::uint64_t, std::uint64_t> > extents;
+  MapChunk chunk;
+  for (std::uint64_t offset = header.first_map_chunk; offset != 0;
+       offset = chunk.next_chunk) {
+    stream_->seekg(offset, std::ios::beg);
+    stream_->read(reinterpret_cast<char*>(&chunk), sizeof(chunk));
+    layout->map_chunks.push_back(offset);
+    layout->slots.insert(layout->slots.end(), chunk.slots,
+                         chunk.slots + MAP_CHUNK_ENTRIES);
+    extents.push_back(std::make_pair(offset, sizeof(MapChunk)));
+  }
+  for (std::size_t i = 0; i < layout->slots.size(); ++i) {
+    if (layout->slots[i].capacity > 0) {
+      extents.push_back(std::make_pair(layout->slots[i].offset,
+                                       layout->slots[i].capacity));
+    }
+  }
+  std::sort(extents.begin(), extents.end());
+  std::uint64_t end = DATA_OFFSET;
+  for (std::size_t i = 0; i < extents.size(); ++i) {
+    if (extents[i].first > end) {
+      layout->release(end, extents[i].first - end);
+    }
+    end = std::max(end, extents[i].first + extents[i].second);
+  }
+  layout->end_offset = end;
+  layout_ = layout;
+  open_layouts_[filename_] = layout_;
+}
+
+void File::extendLayout(const PageId page_number) {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
+  while (layout_->slots.size() <= page_number) {
+    MapChunk chunk;
+    memset(&chunk, 0, sizeof(chunk));
+    const std::uint64_t offset = layout_->allocate(sizeof(MapChunk));
+    stream_->seekp(offset, std::ios::beg);
+    stream_->write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+    // Link the chunk from the previous one, or from the header for the first.
+    const std::uint64_t link = layout_->map_chunks.empty() ?
+        sizeof(FileHeader) + offsetof(CompressedFileHeader, first_map_chunk) :
+        layout_->map_chunks.back() + offsetof(MapChunk, next_chunk);
+    stream_->seekp(link, std::ios::beg);
+    stream_->write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    stream_->flush();
+    layout_->map_chunks.push_back(offset);
+    layout_->slots.resize(layout_->slots.size() + MAP_CHUNK_ENTRIES,
+                          PageExtent());
+  }
+}
+
+void PageFile::readPages(IoRing& ring,
+                         std::vector<PageTransfer>& transfers) const {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
+  const FileHeader header = readHeader();
+  for (std::size_t i = 0; i < transfers.size(); ++i) {
+    PageTransfer& transfer = transfers[i];
+    transfer.valid = transfer.page_number != Page::INVALID_NUMBER &&
+        transfer.page_number < header.num_pages;
+  }
+  readImages(ring, transfers);
+  for (std::size_t i = 0; i < transfers.size(); ++i) {
+    transfers[i].valid = transfers[i].valid && transfers[i].page->isUsed();
+  }
+}
+
+void PageFile::writePages(IoRing& ring,
+                          const std::vector<PageTransfer>& transfers) {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
+  if (layout_) {
+    // Compressed pages have no fixed place to write a batch to; write them one
+    // at a time, after checking all of them.
+    std::vector<PageHeader> headers;
+    for (std::size_t i = 0; i < transfers.size(); ++i) {
+      headers.push_back(readPageHeader(transfers[i].page_number));
+      if (headers[i].current_page_number == Page::INVALID_NUMBER) {
+        throw InvalidPageException(transfers[i].page_number, filename_);
+      }
+    }
+    for (std::size_t i = 0; i < transfers.size(); ++i) {
+      PageHeader header = transfers[i].page->header_;
+      header.next_page_number = headers[i].next_page_number;
+      writeImage(transfers[i].page_number, header, transfers[i].page->data_);
+    }
+    return;
+  }
+  std::vector<PageHeader> headers(transfers.size());
+  std::vector<IoRequest> requests;
+  std::vector<PageId> page_numbers;
+  for (std::size_t i = 0; i < transfers.size(); ++i) {
+    requests.push_back(pageRequest(transfers[i].page_number, 0, false /* write */,
+                                   reinterpret_cast<char*>(&headers[i]),
+                                   sizeof(PageHeader), -1 /* buffer_index */));
+    page_numbers.push_back(transfers[i].page_number);
+  }
+  submitRequests(ring, requests, page_numbers);
+
+  requests.clear();
+  page_numbers.clear();
+  for (std::size_t i = 0; i < transfers.size(); ++i) {
+    const PageTransfer& transfer = transfers[i];
+    if (headers[i].current_page_number == Page::INVALID_NUMBER) {
+      // Page has been deleted since it was read.
+      throw InvalidPageException(transfer.page_number, filename_);
+    }
+    // Keep the next page pointer on disk, as writePage does.
+    const PageId next_page_number = headers[i].next_page_number;
+    headers[i] = transfer.page->header_;
+    headers[i].next_page_number = next_page_number;
+    requests.push_back(pageRequest(transfer.page_number, 0, true /* write */,
+                                   reinterpret_cast<char*>(&headers[i]),
+                                   sizeof(PageHeader), -1 /* buffer_index */));
+    requests.push_back(pageRequest(transfer.page_number, sizeof(PageHeader),
+                                   true /* write */, transfer.page->data_,
+                                   Page::DATA_SIZE, transfer.buffer_index));
+    page_numbers.push_back(transfer.page_number);
+    page_numbers.push_back(transfer.page_number);
+  }
+  submitRequests(ring, requests, page_numbers);
+}
+
+bool PageFile::isPageUsed(const PageId page_number) const {
+  return readPageHeader(page_number).current_page_number !=
+      Page::INVALID_NUMBER;
 }
 
 PageHeader PageFile::readPageHeader(PageId page_number) const {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(PageHeader));
+  readImage(page_number, reinterpret_cast<char*>(&header), sizeof(PageHeader));
   return header;
 }
 
@@ -339,8 +836,9 @@ BlobFile BlobFile::open(const std::string& filename) {
   return BlobFile(filename, false /* create_new */);
 }
 
-BlobFile::BlobFile(const std::string& name, const bool create_new)
-: File(name, create_new) {
+BlobFile::BlobFile(const std::string& name, const bool create_new,
+                   const FileCompression compression)
+: File(name, create_new, compression) {
 }
 
 BlobFile::~BlobFile() {
@@ -361,6 +859,7 @@ BlobFile& BlobFile::operator=(const BlobFile& rhs) {
 }
 
 Page BlobFile::allocatePage(PageId &new_page_number) {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
   FileHeader header = readHeader();
 	Page new_page;
 
@@ -380,15 +879,46 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 
 Page BlobFile::readPage(const PageId page_number) const {
 	Page page;
-	stream_->seekg(pagePosition(page_number), std::ios::beg);
-	stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
+	readImage(page_number, reinterpret_cast<char*>(&page), Page::SIZE);
 	return page;
 }
 
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
-	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
-	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
-	stream_->flush();
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
+	writeImage(new_page_number, new_page.header_, new_page.data_);
+}
+
+void BlobFile::readPages(IoRing& ring,
+                         std::vector<PageTransfer>& transfers) const {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
+  const FileHeader header = readHeader();
+  for (std::size_t i = 0; i < transfers.size(); ++i) {
+    PageTransfer& transfer = transfers[i];
+    transfer.valid = transfer.page_number != Page::INVALID_NUMBER &&
+        transfer.page_number < header.num_pages;
+  }
+  readImages(ring, transfers);
+}
+
+void BlobFile::writePages(IoRing& ring,
+                          const std::vector<PageTransfer>& transfers) {
+  std::lock_guard<std::recursive_mutex> lock(*latch_);
+  if (layout_) {
+    for (std::size_t i = 0; i < transfers.size(); ++i) {
+      writeImage(transfers[i].page_number, transfers[i].page->header_,
+                 transfers[i].page->data_);
+    }
+    return;
+  }
+  std::vector<IoRequest> requests;
+  std::vector<PageId> page_numbers;
+  for (std::size_t i = 0; i < transfers.size(); ++i) {
+    requests.push_back(pageRequest(transfers[i].page_number, 0, true /* write */,
+                                   reinterpret_cast<char*>(transfers[i].page),
+                                   Page::SIZE, transfers[i].buffer_index));
+    page_numbers.push_back(transfers[i].page_number);
+  }
+  submitRequests(ring, requests, page_numbers);
 }
 
 //delePage should not be called for a blob_file, not supported
@@ -11,12 +11,24 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "page.h"
+#include "io_ring.h"
 
 namespace badgerdb {
 
 class FileIterator;
+struct CompressedLayout;
+
+/**
+ * @brief How a new file stores its pages on disk.
+ */
+enum FileCompression {
+  RAW_PAGES = 0,        // every page is an 8 KB image at a fixed position
+  COMPRESSED_PAGES = 1  // every page is compressed into a variable size slot found through a page offset map
+};
 
 /**
  * @brief Header metadata for files on disk which contain pages.
@@ -56,6 +68,34 @@ struct FileHeader {
   }
 };
 
+/**
+ * @brief One page of a batch read or written by File::readPages or
+ *        File::writePages.
+ */
+struct PageTransfer {
+  /**
+   * Number of the page.
+   */
+  PageId page_number;
+
+  /**
+   * Memory the page is read into or written from.
+   */
+  Page* page;
+
+  /**
+   * Registered buffer of the ring holding page, -1 if none.
+   */
+  int buffer_index;
+
+  /**
+   * Set by readPages to whether the page exists in the file and, for a
+   * PageFile, is currently used. The contents of an invalid page are
+   * undefined.
+   */
+  bool valid;
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
@@ -68,7 +108,16 @@ struct FileHeader {
  * detects this (by looking in the open_streams_ map) and just returns a file object with
  * the already created stream for the file without actually opening the UNIX file again. 
  *
- * @warning This class is not threadsafe.
+ * Files may be used from several threads. Stream accesses to a file are serialized by a latch of that file,
+ * shared by all File objects of it like its stream, so transfers on different files run concurrently. Updates
+ * of the open file maps are serialized by a separate latch. Each call is atomic on its own; a sequence of calls
+ * is not.
+ *
+ * A file created with COMPRESSED_PAGES stores each page compressed with compressPage in a slot of the size it
+ * needs, rounded up. A page offset map, kept in chained 8 KB chunks within the file and in memory while the file
+ * is open, gives the position and length of each slot. A page that grows past its slot moves to a free slot or
+ * to the end of the file. Pages are compressed and decompressed by the File calls themselves, so callers such as
+ * BufMgr only ever see whole pages. The mode is recorded in the file and detected when it is opened.
  */
 
 
@@ -80,12 +129,15 @@ class File {
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param compression How a new file stores its pages. An existing file
+   *                    keeps the mode it was created with.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const FileCompression compression = RAW_PAGES);
 
   /**
    * Deletes an existing file.
@@ -143,6 +195,31 @@ class File {
    */
   virtual void writePage(const PageId page_number, const Page& new_page) = 0;
 
+  /**
+   * Reads a batch of pages through a ring, submitting all reads at once.
+   * Pages that are not valid, as readPage would report with an
+   * InvalidPageException, are marked so instead.
+   *
+   * @param ring        Ring performing the reads.
+   * @param transfers   Pages to read.
+   * @throws  PageIoException  If a read fails.
+   */
+  virtual void readPages(IoRing& ring,
+                         std::vector<PageTransfer>& transfers) const = 0;
+
+  /**
+   * Writes a batch of pages through a ring, submitting all writes at once.
+   * Has the same effect as calling writePage on each page.
+   *
+   * @param ring        Ring performing the writes.
+   * @param transfers   Pages to write.
+   * @throws  InvalidPageException  If a page of a PageFile has been deleted;
+   *                                nothing is written then.
+   * @throws  PageIoException       If a write fails.
+   */
+  virtual void writePages(IoRing& ring,
+                          const std::vector<PageTransfer>& transfers) = 0;
+
   /**
    * Deletes a page from the file.
    *
@@ -157,6 +234,11 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns true if the pages of the file are stored compressed.
+   */
+  bool isCompressed() const { return layout_ != nullptr; }
+
  	/**
    * Returns pageid of first page in the file.
    *
@@ -164,6 +246,14 @@ class File {
    */
 	PageId getFirstPageNo();
 
+ 	/**
+   * Returns the number of pages in the file, including the header. Pages are
+   * numbered from 1 up to one less than this.
+   *
+   * @return  Number of pages.
+   */
+	PageId getNumPages();
+
  protected:
   /**
    * Returns the position of the page with the given number in the file (as an
@@ -176,6 +266,72 @@ class File {
     return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
   }
 
+  /**
+   * Reads the start of the image of a page, its header followed by its data.
+   * A page of a compressed file that has never been written reads as zeros.
+   *
+   * @param page_number   Number of page.
+   * @param image         Receives the image.
+   * @param length        Number of bytes of the image to read, at most
+   *                      Page::SIZE.
+   * @throws  PageIoException  If the read fails or the stored image of a
+   *                           compressed page is corrupt.
+   */
+  void readImage(const PageId page_number, char* image,
+                 const std::size_t length) const;
+
+  /**
+   * Reads bytes of the file at an offset through the descriptor, without
+   * taking the latch, so that reads of different pages run concurrently.
+   * Bytes past the end of the file read as zeros.
+   *
+   * @param page_number   Number of the page the bytes belong to, for errors.
+   * @param offset        Offset of the bytes in the file.
+   * @param buffer        Receives the bytes.
+   * @param length        Number of bytes.
+   * @throws  PageIoException  If the read fails.
+   */
+  void readAt(const PageId page_number, const std::uint64_t offset,
+              char* buffer, const std::size_t length) const;
+
+  /**
+   * Writes the image of a page.
+   *
+   * @param page_number   Number of page.
+   * @param header        Header of the page.
+   * @param data          Page::DATA_SIZE bytes of data of the page.
+   */
+  void writeImage(const PageId page_number, const PageHeader& header,
+                  const char* data);
+
+  /**
+   * Reads the whole images of a batch of pages through a ring, submitting all
+   * reads at once. Only the transfers marked valid are read.
+   *
+   * @param ring        Ring performing the reads.
+   * @param transfers   Pages to read.
+   * @throws  PageIoException  If a read fails or a stored image is corrupt.
+   */
+  void readImages(IoRing& ring, std::vector<PageTransfer>& transfers) const;
+
+  /**
+   * Creates the page offset map of a new compressed file.
+   */
+  void createLayout();
+
+  /**
+   * Loads the page offset map of the file if it is compressed.
+   */
+  void loadLayout();
+
+  /**
+   * Makes sure the page offset map has an entry for a page, adding chunks to
+   * it as needed.
+   *
+   * @param page_number   Number of page.
+   */
+  void extendLayout(const PageId page_number);
+
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
@@ -186,6 +342,8 @@ class File {
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileOpenException       If the underlying file cannot be opened
+   *                                  for reading and writing.
    */
   void openIfNeeded(const bool create_new);
 
@@ -218,11 +376,45 @@ class File {
    */
   static StreamMap open_streams_;
 
+  /**
+   * Descriptors for opened files, used for batched transfers alongside the
+   * streams. Streams flush every write and seek before every read, so both
+   * always see the same contents.
+   */
+  static CountMap open_fds_;
+
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  typedef std::map<std::string, std::shared_ptr<CompressedLayout> > LayoutMap;
+
+  /**
+   * Page offset maps of opened compressed files.
+   */
+  static LayoutMap open_layouts_;
+
+  typedef std::map<std::string, std::shared_ptr<std::recursive_mutex> > LatchMap;
+
+  /**
+   * Latches of opened files, shared by all File objects of a file like its
+   * stream.
+   */
+  static LatchMap open_latches_;
+
+  /**
+   * Latch serializing updates of the open file maps.
+   */
+  static std::recursive_mutex open_files_latch_;
+
+  /**
+   * Latch serializing stream accesses to the file, so that transfers of
+   * different files run concurrently. Recursive since compound operations
+   * such as allocatePage are made of smaller latched ones.
+   */
+  std::shared_ptr<std::recursive_mutex> latch_;
+
   /**
    * Name of the file this object represents.
    */
@@ -233,6 +425,43 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * Descriptor for underlying filesystem object.
+   */
+  int fd_;
+
+  /**
+   * Page offset map of the file, null if its pages are not compressed.
+   */
+  std::shared_ptr<CompressedLayout> layout_;
+
+  /**
+   * Returns a request transferring part of a page.
+   *
+   * @param page_number   Number of page.
+   * @param offset        Offset of the part in the page.
+   * @param write         Whether to write rather than read.
+   * @param buffer        Memory to transfer to or from.
+   * @param length        Length of the part.
+   * @param buffer_index  Registered buffer of the ring holding buffer, -1 if none.
+   */
+  IoRequest pageRequest(const PageId page_number, const std::size_t offset,
+                        const bool write, char* buffer,
+                        const std::size_t length,
+                        const int buffer_index) const;
+
+  /**
+   * Submits a batch of requests to a ring and checks their results. Reads
+   * stopping at the end of the file are completed with zeros.
+   *
+   * @param ring          Ring performing the requests.
+   * @param requests      Requests to perform.
+   * @param page_numbers  Number of the page of each request.
+   * @throws  PageIoException  If a request fails.
+   */
+  void submitRequests(IoRing& ring, std::vector<IoRequest>& requests,
+                      const std::vector<PageId>& page_numbers) const;
+
   friend class FileIterator;
 };
 
@@ -264,12 +493,15 @@ class PageFile : public File {
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param compression How a new file stores its pages. An existing file
+   *                    keeps the mode it was created with.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  PageFile(const std::string& name, const bool create_new);
+  PageFile(const std::string& name, const bool create_new,
+             const FileCompression compression = RAW_PAGES);
 
   /**
    * Copy constructor.
@@ -319,6 +551,39 @@ class PageFile : public File {
    */
   void writePage(const PageId page_number, const Page& new_page) override;
 
+  /**
+   * Reads a batch of pages through a ring, submitting all reads at once.
+   * Pages off the end of the file or not currently used are marked invalid.
+   *
+   * @param ring        Ring performing the reads.
+   * @param transfers   Pages to read.
+   * @throws  PageIoException  If a read fails.
+   */
+  void readPages(IoRing& ring,
+                 std::vector<PageTransfer>& transfers) const override;
+
+  /**
+   * Writes a batch of pages through a ring like writePage: the page headers
+   * on disk are read in one batch for their next page numbers, then headers
+   * and data are written in a second one.
+   *
+   * @param ring        Ring performing the transfers.
+   * @param transfers   Pages to write.
+   * @throws  InvalidPageException  If a page has been deleted; nothing is
+   *                                written then.
+   * @throws  PageIoException       If a transfer fails.
+   */
+  void writePages(IoRing& ring,
+                  const std::vector<PageTransfer>& transfers) override;
+
+  /**
+   * Returns true if the page with the given number is currently used, as
+   * opposed to free.  No bounds checking is performed.
+   *
+   * @param page_number   Number of page.
+   */
+  bool isPageUsed(const PageId page_number) const;
+
   /**
    * Deletes a page from the file.
    *
@@ -412,12 +677,15 @@ class BlobFile : public File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param compression How a new file stores its pages. An existing file
+   *                    keeps the mode it was created with.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  BlobFile(const std::string& name, const bool create_new);
+  BlobFile(const std::string& name, const bool create_new,
+             const FileCompression compression = RAW_PAGES);
 
   /**
    * Copy constructor.
@@ -467,6 +735,27 @@ class BlobFile : public File {
    */
   void writePage(const PageId page_number, const Page& new_page) override;
 
+  /**
+   * Reads a batch of pages through a ring, submitting all reads at once.
+   * Pages off the end of the file are marked invalid.
+   *
+   * @param ring        Ring performing the reads.
+   * @param transfers   Pages to read.
+   * @throws  PageIoException  If a read fails.
+   */
+  void readPages(IoRing& ring,
+                 std::vector<PageTransfer>& transfers) const override;
+
+  /**
+   * Writes a batch of pages through a ring, submitting all writes at once.
+   *
+   * @param ring        Ring performing the writes.
+   * @param transfers   Pages to write.
+   * @throws  PageIoException  If a write fails.
+   */
+  void writePages(IoRing& ring,
+                  const std::vector<PageTransfer>& transfers) override;
+
   /**
    * Deletes a page from the file.
    *
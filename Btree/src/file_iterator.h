@@ -103,6 +103,15 @@ class FileIterator {
 	inline Page operator*() const
   { return file_->readPage(current_page_number_); }
 
+  /**
+   * Returns the number of the page the iterator is pointing to, without
+   * reading the page.
+   *
+   * @return  Page number.
+   */
+	inline PageId getCurrentPageNo() const
+  { return current_page_number_; }
+
  private:
   /**
    * File we're iterating over.
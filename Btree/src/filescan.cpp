@@ -5,6 +5,8 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <limits>
 #include "filescan.h"
 #include "exceptions/end_of_file_exception.h"
 
@@ -17,6 +19,27 @@ FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
 	curDirtyFlag = false;
   curPage = NULL;
 	filePageIter = file->begin();
+	scanStart = filePageIter;
+	endPageNo = std::numeric_limits<PageId>::max();
+	readAheadEnd = 0;
+}
+
+FileScan::FileScan(const std::string &name, BufMgr *bufferMgr, PageId firstPageNo, PageId endPageNo)
+{
+  file = new PageFile(name, false);	//dont create new file
+	bufMgr = bufferMgr;
+	curDirtyFlag = false;
+  curPage = NULL;
+	this->endPageNo = std::min(endPageNo, file->getNumPages());
+
+	// start at the first used page of the range
+	while (firstPageNo < this->endPageNo && !file->isPageUsed(firstPageNo))
+	{
+		firstPageNo++;
+	}
+	scanStart = firstPageNo < this->endPageNo ? FileIterator(file, firstPageNo) : file->end();
+	filePageIter = scanStart;
+	readAheadEnd = 0;
 }
 
 FileScan::~FileScan()
@@ -24,10 +47,10 @@ FileScan::~FileScan()
   // generally must unpin last page of the scan
   if (curPage != NULL)
   {
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
+    bufMgr->unPinPage(file, filePageIter.getCurrentPageNo(), curDirtyFlag);
     curPage = NULL;
 		curDirtyFlag = false;
-    filePageIter = file->begin();
+    filePageIter = scanStart;
   }
   bufMgr->flushFile(file);
   delete file;
@@ -35,25 +58,31 @@ FileScan::~FileScan()
 
 void FileScan::scanNext(RecordId& outRid)
 {
-  std::string rec;
-
-  if (filePageIter == file->end())
+  if (!tryScanNext(outRid))
 	{
 		throw EndOfFileException();
 	}
+}
+
+bool FileScan::tryScanNext(RecordId& outRid)
+{
+  if (atEnd())
+	{
+		return false;
+	}
 
   // special case of the first record of the first page of the file
   if (curPage == NULL)
   {
     // need to get the first page of the file
-		filePageIter = file->begin();
-    if(filePageIter == file->end())
+		filePageIter = scanStart;
+    if(atEnd())
 		{
-			throw EndOfFileException();
+			return false;
 		}
 	 
 		// read the first page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage); 
+    readCurrentPage();
 		curDirtyFlag = false;
 
 		// get the first record off the page
@@ -61,11 +90,8 @@ void FileScan::scanNext(RecordId& outRid)
 
 		if(pageRecordIter != curPage->end()) 
 		{
-		  // get pointer to record
-		  rec = *pageRecordIter;
-
 			outRid = pageRecordIter.getCurrentRecord();
-			return;
+			return true;
 		}
   }
 
@@ -76,32 +102,45 @@ void FileScan::scanNext(RecordId& outRid)
   while (pageRecordIter == curPage->end())
   {
     // unpin the current page
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
+    bufMgr->unPinPage(file, filePageIter.getCurrentPageNo(), curDirtyFlag);
     curPage = NULL;
     curDirtyFlag = false;
 
     filePageIter++;
-    if (filePageIter == file->end())
+    if (atEnd())
     {
       curPage = NULL;
-			throw EndOfFileException();
+			return false;
     }
 
     // read the next page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage);
+    readCurrentPage();
 
     // get the first record off the page
     pageRecordIter = curPage->begin(); 
   }
 
   // curRec points at a valid record
-  // see if the record satisfies the scan's predicate 
-  // get a pointer to the record
-  rec = *pageRecordIter;
-
 	// return rid of the record
 	outRid = pageRecordIter.getCurrentRecord();
-	return;
+	return true;
+}
+
+void FileScan::readCurrentPage()
+{
+  PageId pageNo = filePageIter.getCurrentPageNo();
+  // once past the pages read ahead, read the next ones in one batch
+  if (pageNo >= readAheadEnd)
+  {
+    readAheadEnd = pageNo + std::min(READAHEADPAGES, endPageNo - pageNo);
+    bufMgr->prefetchPages(file, pageNo, readAheadEnd);
+  }
+  bufMgr->readPage(file, pageNo, curPage);
+}
+
+bool FileScan::atEnd()
+{
+  return filePageIter == file->end() || filePageIter.getCurrentPageNo() >= endPageNo;
 }
 
 // returns pointer to the current record.  page is left pinned
@@ -111,6 +150,11 @@ std::string FileScan::getRecord()
   return *pageRecordIter;
 }
 
+const char* FileScan::getRecordData(std::size_t& length)
+{
+  return curPage->getRecordData(pageRecordIter.getCurrentRecord(), length);
+}
+
 // mark current page of scan dirty
 void FileScan::markDirty()
 {
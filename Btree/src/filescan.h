@@ -26,14 +26,24 @@ class FileScan
 
   FileScan(const std::string &name, BufMgr *bufMgr);
 
+  //scan only the pages numbered from firstPageNo up to, but not including, endPageNo
+  FileScan(const std::string &name, BufMgr *bufMgr, PageId firstPageNo, PageId endPageNo);
+
   ~FileScan();
 
   //return RecordId of next record that satisfies the scan 
   void scanNext(RecordId& outRid);
 
+  //same as scanNext, but returns false at the end of the file instead of throwing
+  bool tryScanNext(RecordId& outRid);
+
   //read current record, returning pointer and length
   std::string getRecord();
 
+  //read current record without copying it, returning a pointer into the pinned page and the length;
+  //the pointer stays valid until the scan moves on
+  const char* getRecordData(std::size_t& length);
+
   //marks current page of scan dirty
   void markDirty();
 
@@ -56,6 +66,21 @@ class FileScan
   FileIterator  filePageIter;
   PageIterator  pageRecordIter;
 
+  /**
+   * First page of the scan, and the page number the scan stops at.
+   */
+  FileIterator  scanStart;
+  PageId        endPageNo;
+  //pages before this one have been read ahead
+  PageId        readAheadEnd;
+  //pin the current page, reading the next pages ahead when needed
+  void          readCurrentPage();
+
+  /**
+   * True if the page iterator has passed the last page of the scan
+   */
+  bool  	      atEnd();
+
   /**
    * True if page has been updated
    */
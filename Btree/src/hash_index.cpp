@@ -0,0 +1,381 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "hash_index.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_record_exception.h"
+
+namespace badgerdb
+{
+
+	static_assert(sizeof(HashIndexMetaInfo) <= Page::SIZE, "Hash index meta info must fit in a page.");
+	static_assert(sizeof(HashBucketInt) <= Page::SIZE, "Hash bucket must fit in a page.");
+
+	// -----------------------------------------------------------------------------
+	// HashIndex::HashIndex -- Constructor
+	// -----------------------------------------------------------------------------
+
+	HashIndex::HashIndex(const std::string &relationName,
+						 std::string &outIndexName,
+						 BufMgr *bufMgrIn,
+						 const int attrByteOffset,
+						 const Datatype attrType)
+	{
+		bufMgr = bufMgrIn;
+		attributeType = attrType;
+		this->attrByteOffset = attrByteOffset;
+		//compute indexName
+		std::ostringstream idxStr;
+		idxStr << relationName << '.' << attrByteOffset << ".hash";
+		outIndexName = idxStr.str();
+		try
+		{
+			file = new BlobFile(outIndexName, false);
+			//File Exists, load and check the meta page
+			Page *headerPage;
+			headerPageNum = file->getFirstPageNo();
+			bufMgr->readPage(file, headerPageNum, headerPage);
+			meta = *((HashIndexMetaInfo *)headerPage);
+			bufMgr->unPinPage(file, headerPageNum, false);
+			if (relationName.compare(0, sizeof(meta.relationName) - 1, meta.relationName) != 0
+				|| meta.attrByteOffset != attrByteOffset || meta.attrType != attrType)
+			{
+				bufMgr->flushFile(file);
+				delete file;
+				throw BadIndexInfoException(outIndexName);
+			}
+		}
+		catch (FileNotFoundException &e)
+		{
+			//File Does Not Exist, create the meta page and the initial buckets
+			file = new BlobFile(outIndexName, true);
+			try
+			{
+				Page *headerPage;
+				bufMgr->allocPage(file, headerPageNum, headerPage);
+				bufMgr->unPinPage(file, headerPageNum, true);
+
+				memset(&meta, 0, sizeof(meta));
+				strncpy(meta.relationName, relationName.c_str(), sizeof(meta.relationName) - 1);
+				meta.attrByteOffset = attrByteOffset;
+				meta.attrType = attrType;
+				meta.level = 0;
+				meta.nextSplit = 0;
+				meta.numBuckets = HASHINITIALBUCKETS;
+				meta.numEntries = 0;
+				meta.freeOverflowPageNo = 0;
+				for (int i = 0; i < HASHINITIALBUCKETS; i++)
+				{
+					Page *bucketPage;
+					bufMgr->allocPage(file, meta.bucketPageNo[i], bucketPage);
+					HashBucketInt *bucket = (HashBucketInt *)bucketPage;
+					bucket->numEntries = 0;
+					bucket->overflowPageNo = 0;
+					bufMgr->unPinPage(file, meta.bucketPageNo[i], true);
+				}
+				writeMetaInfo();
+
+				//insert entries for every tuple in the base relation
+				FileScan scanner(relationName, bufMgr);
+				RecordId currRid;
+				std::size_t length;
+				while (scanner.tryScanNext(currRid))
+				{
+					const char *record = scanner.getRecordData(length);
+					//a record too short to hold the key is not of this relation
+					if ((std::size_t)attrByteOffset + sizeof(int) > length)
+					{
+						throw InvalidRecordException(currRid, currRid.page_number);
+					}
+					insertEntry(record + attrByteOffset, currRid);
+				}
+				writeMetaInfo();
+			}
+			catch (...)
+			{
+				//drop the partly built index, so that it is not reopened as a whole one
+				bufMgr->flushFile(file);
+				delete file;
+				File::remove(outIndexName);
+				throw;
+			}
+			bufMgr->flushFile(file);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// HashIndex::~HashIndex -- destructor
+	// -----------------------------------------------------------------------------
+
+	HashIndex::~HashIndex()
+	{
+		try
+		{
+			writeMetaInfo();
+			bufMgr->flushFile(file);
+		}
+		catch (...)
+		{
+			//the destructor must not throw; the file keeps the meta page of the last flush
+		}
+		delete file;
+		file = nullptr;
+	}
+
+	// -----------------------------------------------------------------------------
+	// HashIndex::hash
+	// -----------------------------------------------------------------------------
+
+	std::uint32_t HashIndex::hash(int key)
+	{
+		//finalizer of MurmurHash3, so that consecutive keys land in different buckets
+		std::uint32_t h = (std::uint32_t)key;
+		h ^= h >> 16;
+		h *= 0x85ebca6b;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35;
+		h ^= h >> 16;
+		return h;
+	}
+
+	// -----------------------------------------------------------------------------
+	// HashIndex::bucketOf
+	// -----------------------------------------------------------------------------
+
+	int HashIndex::bucketOf(int key) const
+	{
+		std::uint32_t h = hash(key);
+		std::uint32_t roundBuckets = (std::uint32_t)HASHINITIALBUCKETS << meta.level;
+		int bucket = h % roundBuckets;
+		//buckets already split in this round are addressed with the next round's function
+		if (bucket < meta.nextSplit)
+		{
+			bucket = h % (roundBuckets << 1);
+		}
+		return bucket;
+	}
+
+	// -----------------------------------------------------------------------------
+	// HashIndex::writeMetaInfo
+	// -----------------------------------------------------------------------------
+
+	void HashIndex::writeMetaInfo()
+	{
+		Page *headerPage;
+		bufMgr->readPage(file, headerPageNum, headerPage);
+		*((HashIndexMetaInfo *)headerPage) = meta;
+		bufMgr->unPinPage(file, headerPageNum, true);
+	}
+
+	// -----------------------------------------------------------------------------
+	// HashIndex::allocBucketPage
+	// -----------------------------------------------------------------------------
+
+	void HashIndex::allocBucketPage(PageId &pageNo, Page *&page)
+	{
+		if (meta.freeOverflowPageNo != 0)
+		{
+			pageNo = meta.freeOverflowPageNo;
+			bufMgr->readPage(file, pageNo, page);
+			meta.freeOverflowPageNo = ((HashBucketInt *)page)->overflowPageNo;
+		}
+		else
+		{
+			bufMgr->allocPage(file, pageNo, page);
+		}
+		HashBucketInt *bucket = (HashBucketInt *)page;
+		bucket->numEntries = 0;
+		bucket->overflowPageNo = 0;
+	}
+
+	// -----------------------------------------------------------------------------
+	// HashIndex::appendToChain
+	// -----------------------------------------------------------------------------
+
+	void HashIndex::appendToChain(PageId bucketPageNo, int key, const RecordId rid)
+	{
+		PageId pageNo = bucketPageNo;
+		Page *page;
+		bufMgr->readPage(file, pageNo, page);
+		HashBucketInt *bucket = (HashBucketInt *)page;
+		//walk to the first page of the chain with a free slot
+		while (bucket->numEntries == HASHBUCKETSIZE)
+		{
+			PageId nextPageNo = bucket->overflowPageNo;
+			bool dirty = false;
+			if (nextPageNo == 0)
+			{
+				//every page of the chain is full, extend it
+				Page *overflowPage;
+				allocBucketPage(nextPageNo, overflowPage);
+				bufMgr->unPinPage(file, nextPageNo, true);
+				bucket->overflowPageNo = nextPageNo;
+				dirty = true;
+			}
+			bufMgr->unPinPage(file, pageNo, dirty);
+			pageNo = nextPageNo;
+			bufMgr->readPage(file, pageNo, page);
+			bucket = (HashBucketInt *)page;
+		}
+		bucket->keyArray[bucket->numEntries] = key;
+		bucket->ridArray[bucket->numEntries] = rid;
+		bucket->numEntries++;
+		bufMgr->unPinPage(file, pageNo, true);
+	}
+
+	// -----------------------------------------------------------------------------
+	// HashIndex::insertEntry
+	// -----------------------------------------------------------------------------
+
+	void HashIndex::insertEntry(const void *key, const RecordId rid)
+	{
+		int intKey = *((int *)key);
+		appendToChain(meta.bucketPageNo[bucketOf(intKey)], intKey, rid);
+		meta.numEntries++;
+		//grow by one bucket when the primary pages get too full
+		if (meta.numBuckets < HASHMAXBUCKETS
+			&& meta.numEntries > HASHMAXLOADFACTOR * meta.numBuckets * HASHBUCKETSIZE)
+		{
+			splitBucket();
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// HashIndex::splitBucket
+	// -----------------------------------------------------------------------------
+
+	void HashIndex::splitBucket()
+	{
+		//gather every entry of the chain being split
+		std::vector<int> keys;
+		std::vector<RecordId> rids;
+		PageId bucketPageNo = meta.bucketPageNo[meta.nextSplit];
+		PageId pageNo = bucketPageNo;
+		while (pageNo != 0)
+		{
+			Page *page;
+			bufMgr->readPage(file, pageNo, page);
+			HashBucketInt *bucket = (HashBucketInt *)page;
+			keys.insert(keys.end(), bucket->keyArray, bucket->keyArray + bucket->numEntries);
+			rids.insert(rids.end(), bucket->ridArray, bucket->ridArray + bucket->numEntries);
+			PageId nextPageNo = bucket->overflowPageNo;
+			//the primary page is emptied in place, overflow pages go to the free list
+			bucket->numEntries = 0;
+			if (pageNo == bucketPageNo)
+			{
+				bucket->overflowPageNo = 0;
+			}
+			else
+			{
+				bucket->overflowPageNo = meta.freeOverflowPageNo;
+				meta.freeOverflowPageNo = pageNo;
+			}
+			bufMgr->unPinPage(file, pageNo, true);
+			pageNo = nextPageNo;
+		}
+
+		//add the new bucket and advance the split pointer
+		int newBucket = meta.numBuckets;
+		Page *newPage;
+		allocBucketPage(meta.bucketPageNo[newBucket], newPage);
+		bufMgr->unPinPage(file, meta.bucketPageNo[newBucket], true);
+		meta.numBuckets++;
+		meta.nextSplit++;
+		if (meta.nextSplit == (HASHINITIALBUCKETS << meta.level))
+		{
+			meta.level++;
+			meta.nextSplit = 0;
+		}
+
+		//redistribute the gathered entries between the old and the new bucket
+		for (std::size_t i = 0; i < keys.size(); i++)
+		{
+			appendToChain(meta.bucketPageNo[bucketOf(keys[i])], keys[i], rids[i]);
+		}
+		writeMetaInfo();
+	}
+
+	// -----------------------------------------------------------------------------
+	// HashIndex::find
+	// -----------------------------------------------------------------------------
+
+	void HashIndex::find(const void *key, std::vector<RecordId> &outRids)
+	{
+		int intKey = *((int *)key);
+		std::size_t found = outRids.size();
+		PageId pageNo = meta.bucketPageNo[bucketOf(intKey)];
+		while (pageNo != 0)
+		{
+			Page *page;
+			bufMgr->readPage(file, pageNo, page);
+			HashBucketInt *bucket = (HashBucketInt *)page;
+			for (int i = 0; i < bucket->numEntries; i++)
+			{
+				if (bucket->keyArray[i] == intKey)
+				{
+					outRids.push_back(bucket->ridArray[i]);
+				}
+			}
+			PageId nextPageNo = bucket->overflowPageNo;
+			bufMgr->unPinPage(file, pageNo, false);
+			pageNo = nextPageNo;
+		}
+		if (outRids.size() == found)
+		{
+			throw NoSuchKeyFoundException();
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// HashIndex::deleteEntry
+	// -----------------------------------------------------------------------------
+
+	void HashIndex::deleteEntry(const void *key, const RecordId rid)
+	{
+		int intKey = *((int *)key);
+		PageId prevPageNo = 0;
+		PageId pageNo = meta.bucketPageNo[bucketOf(intKey)];
+		while (pageNo != 0)
+		{
+			Page *page;
+			bufMgr->readPage(file, pageNo, page);
+			HashBucketInt *bucket = (HashBucketInt *)page;
+			for (int i = 0; i < bucket->numEntries; i++)
+			{
+				if (bucket->keyArray[i] == intKey && bucket->ridArray[i] == rid)
+				{
+					//fill the hole with the last entry of the page
+					bucket->numEntries--;
+					bucket->keyArray[i] = bucket->keyArray[bucket->numEntries];
+					bucket->ridArray[i] = bucket->ridArray[bucket->numEntries];
+					meta.numEntries--;
+					//unlink an emptied overflow page and keep it for reuse
+					if (bucket->numEntries == 0 && prevPageNo != 0)
+					{
+						Page *prevPage;
+						bufMgr->readPage(file, prevPageNo, prevPage);
+						((HashBucketInt *)prevPage)->overflowPageNo = bucket->overflowPageNo;
+						bufMgr->unPinPage(file, prevPageNo, true);
+						bucket->overflowPageNo = meta.freeOverflowPageNo;
+						meta.freeOverflowPageNo = pageNo;
+					}
+					bufMgr->unPinPage(file, pageNo, true);
+					return;
+				}
+			}
+			PageId nextPageNo = bucket->overflowPageNo;
+			bufMgr->unPinPage(file, pageNo, false);
+			prevPageNo = pageNo;
+			pageNo = nextPageNo;
+		}
+		throw NoSuchKeyFoundException();
+	}
+
+}
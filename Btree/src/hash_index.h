@@ -0,0 +1,258 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of buckets a HashIndex starts with.
+ */
+const int HASHINITIALBUCKETS = 4;
+
+/**
+ * @brief Number of key slots in a hash bucket page for INTEGER key.
+ */
+//                                                     numEntries    overflow ptr                    key               rid
+const int HASHBUCKETSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+
+/**
+ * @brief Maximum number of primary buckets, bounded by the bucket directory kept in the meta page.
+ * Once reached, buckets are no longer split and keep growing their overflow chains.
+ */
+//                                                relationName   attrByteOffset, attrType, level, nextSplit, numBuckets, numEntries    freeOverflowPageNo
+const int HASHMAXBUCKETS = ( Page::SIZE - 20 * sizeof( char ) - 6 * sizeof( int ) - sizeof( PageId ) ) / sizeof( PageId );
+
+/**
+ * @brief Fraction of the primary bucket slots that may be used before the next bucket is split.
+ */
+const double HASHMAXLOADFACTOR = 0.75;
+
+/**
+ * @brief The meta page of a hash index file, always the first page of the file.
+ * Besides the index description it holds the linear hashing state and the directory
+ * mapping every primary bucket to its page.
+ */
+struct HashIndexMetaInfo{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Offset of attribute, over which index is built, inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute over which index is built.
+   */
+	Datatype attrType;
+
+  /**
+   * Number of times the initial set of buckets has been doubled.
+   */
+	int level;
+
+  /**
+   * Next bucket to be split in the current round.
+   */
+	int nextSplit;
+
+  /**
+   * Number of primary buckets.
+   */
+	int numBuckets;
+
+  /**
+   * Number of entries in the index.
+   */
+	int numEntries;
+
+  /**
+   * First page of the list of emptied overflow pages available for reuse, 0 if none.
+   */
+	PageId freeOverflowPageNo;
+
+  /**
+   * Page number of every primary bucket.
+   */
+	PageId bucketPageNo[ HASHMAXBUCKETS ];
+};
+
+/**
+ * @brief Structure of bucket and overflow pages when the key is of INTEGER type.
+ * Entries are stored unordered in the first numEntries slots.
+*/
+struct HashBucketInt{
+  /**
+   * Number of used slots.
+   */
+	int numEntries;
+
+  /**
+   * Page number of the next overflow page of the bucket, 0 if none.
+   */
+	PageId overflowPageNo;
+
+  /**
+   * Stores keys.
+   */
+	int keyArray[ HASHBUCKETSIZE ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ HASHBUCKETSIZE ];
+};
+
+/**
+ * @brief HashIndex class. It implements a disk based linear hashing index on a single attribute
+ * of a relation, for equality lookups. Every bucket is a page with a chain of overflow pages; buckets
+ * are split one at a time in round robin order whenever the load factor exceeds HASHMAXLOADFACTOR.
+*/
+class HashIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * In-memory copy of the meta page, written back when the bucket layout changes and when the index is closed.
+   */
+	HashIndexMetaInfo	meta;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Offset of attribute, over which index is built, inside records.
+   */
+	int 		attrByteOffset;
+
+  /**
+   * Hash a key. Different keys are spread over all bits of the result.
+   * @param key		Key to hash
+   * @return Hash value
+   */
+	static std::uint32_t hash(int key);
+
+  /**
+   * Find the primary bucket holding the given key under the current linear hashing state.
+   * @param key		Key to look up
+   * @return Bucket number
+   */
+	int bucketOf(int key) const;
+
+  /**
+   * Write the in-memory meta information to the meta page.
+   */
+	void writeMetaInfo();
+
+  /**
+   * Get an empty page to extend an overflow chain with, reusing an emptied overflow page when possible.
+   * The page is returned pinned.
+   * @param pageNo	Page number of the new page returned in this
+   * @param page		Pointer to the pinned page returned in this
+   */
+	void allocBucketPage(PageId &pageNo, Page *&page);
+
+  /**
+   * Append an entry to the chain starting at the given bucket page, adding an overflow page if the chain is full.
+   * @param bucketPageNo	Page number of the primary bucket page
+   * @param key		Key to insert
+   * @param rid		RecordId to insert
+   */
+	void appendToChain(PageId bucketPageNo, int key, const RecordId rid);
+
+  /**
+   * Split bucket nextSplit, moving the entries that now hash to the new bucket, and advance the linear hashing state.
+   */
+	void splitBucket();
+
+ public:
+
+  /**
+   * HashIndex Constructor.
+	 * Check to see if the corresponding index file exists. If so, open the file.
+	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   * @throws  InvalidRecordException    If a record of the relation is too short to hold the attribute. The partly built index file is removed.
+   */
+	HashIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+
+  /**
+   * HashIndex Destructor.
+	 * Write the meta page, flush the index file from the buffer manager and delete the file instance thereby closing the index file.
+	 * Does not throw; a failed write or flush is swallowed.
+	 */
+	~HashIndex();
+
+  /**
+	 * Insert a new entry using the pair <value,rid>.
+	 * The entry is appended to the chain of the bucket the key hashes to, which may split the next bucket in line.
+   * @param key			Key to insert, pointer to integer/double/char string
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	void insertEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Find the record ids of all entries with the given key.
+   * @param key			Key to look up, pointer to integer/double/char string
+   * @param outRids	RecordIds of the matching entries are appended to this
+	 * @throws  NoSuchKeyFoundException If there is no entry with the given key.
+	**/
+	void find(const void* key, std::vector<RecordId>& outRids);
+
+  /**
+	 * Delete the entry <value,rid> from the index.
+	 * Overflow pages emptied by the delete are unlinked from their chain and kept for reuse.
+   * @param key			Key of the entry, pointer to integer/double/char string
+   * @param rid			Record ID of the entry
+	 * @throws  NoSuchKeyFoundException If the entry is not in the index.
+	**/
+	void deleteEntry(const void* key, const RecordId rid);
+
+  /**
+   * Number of entries in the index.
+   */
+	int size() const { return meta.numEntries; }
+};
+
+}
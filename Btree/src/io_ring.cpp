@@ -0,0 +1,312 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "io_ring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define BADGERDB_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace badgerdb {
+
+#ifdef BADGERDB_IO_URING
+/**
+ * Largest buffer the kernel accepts for registration.
+ */
+static const std::size_t MAXREGISTEREDBYTES = std::size_t(1) << 30;
+
+/**
+ * Result of a request not completed yet.
+ */
+static const long INCOMPLETE = -(1L << 40);
+#endif
+
+IoRing::IoRing(const unsigned entries, const bool useUring)
+  : ringFd(-1), sqEntries(0), sqRing(NULL), sqRingSize(0), cqRing(NULL), cqRingSize(0), sqes(NULL), sqesSize(0),
+    bufferRegistered(false)
+{
+#ifdef BADGERDB_IO_URING
+  if (!useUring)
+  {
+    return;
+  }
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ringFd = syscall(__NR_io_uring_setup, entries, &params);
+  if (ringFd < 0)
+  {
+    // not supported by the kernel, or forbidden in this sandbox
+    ringFd = -1;
+    return;
+  }
+  sqEntries = params.sq_entries;
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (singleMmap)
+  {
+    sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+  }
+  sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+  if (sqRing == MAP_FAILED)
+  {
+    sqRing = NULL;
+    teardown();
+    return;
+  }
+  if (singleMmap)
+  {
+    cqRing = sqRing;
+  }
+  else
+  {
+    cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    if (cqRing == MAP_FAILED)
+    {
+      cqRing = NULL;
+      teardown();
+      return;
+    }
+  }
+  sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  sqes = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED)
+  {
+    sqes = NULL;
+    teardown();
+    return;
+  }
+  char* sq = static_cast<char*>(sqRing);
+  sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  char* cq = static_cast<char*>(cqRing);
+  cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes = cq + params.cq_off.cqes;
+#else
+  (void)entries;
+  (void)useUring;
+#endif
+}
+
+IoRing::~IoRing()
+{
+  teardown();
+}
+
+void IoRing::teardown()
+{
+#ifdef BADGERDB_IO_URING
+  if (bufferRegistered)
+  {
+    syscall(__NR_io_uring_register, ringFd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+    bufferRegistered = false;
+  }
+  if (sqes != NULL)
+  {
+    munmap(sqes, sqesSize);
+  }
+  if (cqRing != NULL && cqRing != sqRing)
+  {
+    munmap(cqRing, cqRingSize);
+  }
+  if (sqRing != NULL)
+  {
+    munmap(sqRing, sqRingSize);
+  }
+  sqRing = cqRing = sqes = NULL;
+  if (ringFd >= 0)
+  {
+    close(ringFd);
+  }
+#endif
+  ringFd = -1;
+}
+
+int IoRing::registerBuffer(char* buffer, const std::size_t length)
+{
+#ifdef BADGERDB_IO_URING
+  if (ringFd < 0 || bufferRegistered || length > MAXREGISTEREDBYTES)
+  {
+    return -1;
+  }
+  iovec vec;
+  vec.iov_base = buffer;
+  vec.iov_len = length;
+  // fails when the pinned memory would exceed RLIMIT_MEMLOCK; transfers then simply use unregistered memory
+  if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, &vec, 1) < 0)
+  {
+    return -1;
+  }
+  bufferRegistered = true;
+  return 0;
+#else
+  (void)buffer;
+  (void)length;
+  return -1;
+#endif
+}
+
+void IoRing::submit(IoRequest* requests, const std::size_t count)
+{
+#ifdef BADGERDB_IO_URING
+  std::size_t next = 0;
+  std::size_t done = 0;
+  for (std::size_t i = 0; i < count; i++)
+  {
+    requests[i].result = INCOMPLETE;
+  }
+  while (ringFd >= 0 && done < count)
+  {
+    // queue as many requests as the submission ring holds
+    unsigned tail = *sqTail;
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    while (next < count && tail - head < sqEntries)
+    {
+      IoRequest& request = requests[next];
+      unsigned index = tail & *sqMask;
+      io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes) + index;
+      memset(sqe, 0, sizeof(*sqe));
+      bool fixed = request.bufferIndex >= 0 && bufferRegistered;
+      if (request.write)
+      {
+        sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+      }
+      else
+      {
+        sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+      }
+      sqe->fd = request.fd;
+      sqe->off = request.offset;
+      sqe->addr = reinterpret_cast<std::uint64_t>(request.buffer);
+      sqe->len = request.length;
+      sqe->buf_index = fixed ? request.bufferIndex : 0;
+      sqe->user_data = next;
+      sqArray[index] = index;
+      tail++;
+      next++;
+    }
+    __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+    // one system call submits the queued requests and waits for every request in flight
+    unsigned toSubmit = tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    unsigned inFlight = next - done;
+    if (syscall(__NR_io_uring_enter, ringFd, toSubmit, inFlight, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+        errno != EINTR && errno != EAGAIN && errno != EBUSY)
+    {
+      // the ring is unusable, but the kernel may still be transferring to or from the buffers of the requests it
+      // took; wait for those, then drop the ring so that the rest of the batch and later batches use pread/pwrite
+      std::size_t taken = next - (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE));
+      done += reapCompletions(requests);
+      while (done < taken)
+      {
+        if (syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+            errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+          // transfers could still land in buffers the caller gets back: nothing safe is left to do
+          std::abort();
+        }
+        done += reapCompletions(requests);
+      }
+      teardown();
+      break;
+    }
+    done += reapCompletions(requests);
+  }
+  // requests the ring did not take, as there is none or it failed, are done with pread/pwrite
+  for (std::size_t i = 0; i < count; i++)
+  {
+    if (requests[i].result == INCOMPLETE)
+    {
+      requests[i].result = 0;
+      transferDirect(requests[i]);
+    }
+  }
+#else
+  for (std::size_t i = 0; i < count; i++)
+  {
+    requests[i].result = 0;
+    transferDirect(requests[i]);
+  }
+#endif
+}
+
+std::size_t IoRing::reapCompletions(IoRequest* requests)
+{
+  std::size_t reaped = 0;
+#ifdef BADGERDB_IO_URING
+  unsigned cqIndex = *cqHead;
+  while (cqIndex != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+  {
+    io_uring_cqe* cqe = static_cast<io_uring_cqe*>(cqes) + (cqIndex & *cqMask);
+    IoRequest& request = requests[cqe->user_data];
+    request.result = cqe->res;
+    if (request.result < 0 || static_cast<std::size_t>(request.result) < request.length)
+    {
+      transferDirect(request);
+    }
+    cqIndex++;
+    reaped++;
+  }
+  __atomic_store_n(cqHead, cqIndex, __ATOMIC_RELEASE);
+#else
+  (void)requests;
+#endif
+  return reaped;
+}
+
+void IoRing::transferDirect(IoRequest& request)
+{
+  std::size_t transferred = request.result > 0 ? request.result : 0;
+  while (transferred < request.length)
+  {
+    ssize_t bytes;
+    if (request.write)
+    {
+      bytes = pwrite(request.fd, request.buffer + transferred, request.length - transferred, request.offset + transferred);
+    }
+    else
+    {
+      bytes = pread(request.fd, request.buffer + transferred, request.length - transferred, request.offset + transferred);
+    }
+    if (bytes < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (bytes < 0)
+    {
+      request.result = -errno;
+      return;
+    }
+    if (bytes == 0)
+    {
+      // end of file
+      break;
+    }
+    transferred += bytes;
+  }
+  request.result = transferred;
+}
+
+}
@@ -0,0 +1,165 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief Default number of submission queue entries of an IoRing.
+ */
+const unsigned IORINGENTRIES = 256;
+
+/**
+ * @brief One read or write of a batch submitted to an IoRing.
+ */
+struct IoRequest
+{
+  /**
+   * Descriptor of the file to transfer from or to.
+   */
+  int fd;
+
+  /**
+   * True for a write, false for a read.
+   */
+  bool write;
+
+  /**
+   * Byte offset in the file.
+   */
+  std::uint64_t offset;
+
+  /**
+   * Memory to transfer to or from, and its length in bytes.
+   */
+  char* buffer;
+  std::size_t length;
+
+  /**
+   * Registered buffer of the ring holding buffer, -1 if none.
+   */
+  int bufferIndex;
+
+  /**
+   * Set on completion to the number of bytes transferred, or to minus the error number.
+   */
+  long result;
+};
+
+/**
+ * @brief Batched file I/O through a Linux io_uring, driven by raw system calls.
+ * A whole batch is queued on the submission ring and handed to the kernel with one io_uring_enter call, which
+ * also waits for its completions. Where io_uring is not available, each request falls back to pread/pwrite. If
+ * io_uring_enter fails, the ring waits for the requests the kernel took, is torn down, and the rest of the batch
+ * and every later one go through pread/pwrite.
+ * An IoRing is not thread safe; BufMgr only uses its ring under its ringLatch.
+ */
+class IoRing
+{
+ public:
+  /**
+   * Set the ring up.
+   * @param entries		Number of submission queue entries; larger batches are submitted in several rounds
+   * @param useUring	If false, always use pread/pwrite
+   */
+  IoRing(const unsigned entries = IORINGENTRIES, const bool useUring = true);
+
+  /**
+   * Unregister the buffers and tear the ring down. No request is in flight then, as submit waits for all of them.
+   */
+  ~IoRing();
+
+  IoRing(const IoRing&) = delete;
+  IoRing& operator=(const IoRing&) = delete;
+
+  /**
+   * Register a buffer with the kernel, so that transfers to and from it skip mapping the user pages each time.
+   * Only one buffer can be registered.
+   * @param buffer		Start of the buffer
+   * @param length		Length of the buffer in bytes
+   * @return Index to set as IoRequest::bufferIndex for transfers within the buffer, -1 if it could not be registered
+   */
+  int registerBuffer(char* buffer, const std::size_t length);
+
+  /**
+   * Perform a batch of transfers and wait for all of them. Short and failed transfers are retried once with
+   * pread/pwrite, as are the requests left when the ring fails; the result of each request is set. Aborts the
+   * process if the ring fails and the transfers the kernel took cannot be waited for, as they could still land in
+   * the buffers.
+   * @param requests	Requests to perform
+   * @param count			Number of requests
+   */
+  void submit(IoRequest* requests, const std::size_t count);
+
+  /**
+   * True if requests go through io_uring rather than pread/pwrite.
+   */
+  bool usesUring() const { return ringFd >= 0; }
+
+ private:
+  /**
+   * Descriptor of the ring, -1 when falling back to pread/pwrite.
+   */
+  int ringFd;
+
+  /**
+   * Number of submission queue entries.
+   */
+  unsigned sqEntries;
+
+  /**
+   * Mappings of the submission ring, the completion ring and the submission queue entries.
+   */
+  void* sqRing;
+  std::size_t sqRingSize;
+  void* cqRing;
+  std::size_t cqRingSize;
+  void* sqes;
+  std::size_t sqesSize;
+
+  /**
+   * Fields of the rings shared with the kernel.
+   */
+  unsigned* sqHead;
+  unsigned* sqTail;
+  unsigned* sqMask;
+  unsigned* sqArray;
+  unsigned* cqHead;
+  unsigned* cqTail;
+  unsigned* cqMask;
+  void* cqes;
+
+  /**
+   * True once a buffer is registered.
+   */
+  bool bufferRegistered;
+
+  /**
+   * Release the ring and fall back to pread/pwrite.
+   */
+  void teardown();
+
+  /**
+   * Take every completion off the completion ring, setting the result of its request and finishing it with
+   * pread/pwrite if it fell short.
+   * @param requests	Batch the completions belong to
+   * @return Number of completions taken
+   */
+  std::size_t reapCompletions(IoRequest* requests);
+
+  /**
+   * Perform, or finish, one request with pread/pwrite.
+   * @param request		Request whose result is updated
+   */
+  static void transferDirect(IoRequest& request);
+};
+
+}
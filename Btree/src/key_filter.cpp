@@ -0,0 +1,181 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "key_filter.h"
+
+//the vector kernels are x86 only; elsewhere every level falls back to the portable kernels
+#if defined(__x86_64__) || defined(__i386__)
+#define BADGERDB_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace badgerdb
+{
+
+	// -----------------------------------------------------------------------------
+	// Portable kernels
+	// -----------------------------------------------------------------------------
+
+	static int countKeysLessScalar(const int *keys, int numKeys, int value)
+	{
+		int count = 0;
+		for (int i = 0; i < numKeys; i++)
+		{
+			count += keys[i] < value;
+		}
+		return count;
+	}
+
+	static int countKeysGreaterScalar(const int *keys, int numKeys, int value)
+	{
+		int count = 0;
+		for (int i = 0; i < numKeys; i++)
+		{
+			count += keys[i] > value;
+		}
+		return count;
+	}
+
+#ifdef BADGERDB_X86_KERNELS
+	// -----------------------------------------------------------------------------
+	// AVX2 kernels, eight keys per compare
+	// -----------------------------------------------------------------------------
+
+	__attribute__((target("avx2"))) static int countKeysLessAvx2(const int *keys, int numKeys, int value)
+	{
+		__m256i pivot = _mm256_set1_epi32(value);
+		int count = 0;
+		int i = 0;
+		for (; i + 8 <= numKeys; i += 8)
+		{
+			__m256i block = _mm256_loadu_si256((const __m256i *)(keys + i));
+			__m256i less = _mm256_cmpgt_epi32(pivot, block);
+			count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(less)));
+		}
+		return count + countKeysLessScalar(keys + i, numKeys - i, value);
+	}
+
+	__attribute__((target("avx2"))) static int countKeysGreaterAvx2(const int *keys, int numKeys, int value)
+	{
+		__m256i pivot = _mm256_set1_epi32(value);
+		int count = 0;
+		int i = 0;
+		for (; i + 8 <= numKeys; i += 8)
+		{
+			__m256i block = _mm256_loadu_si256((const __m256i *)(keys + i));
+			__m256i greater = _mm256_cmpgt_epi32(block, pivot);
+			count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(greater)));
+		}
+		return count + countKeysGreaterScalar(keys + i, numKeys - i, value);
+	}
+
+	// -----------------------------------------------------------------------------
+	// AVX-512 kernels, sixteen keys per compare
+	// -----------------------------------------------------------------------------
+
+	__attribute__((target("avx512f"))) static int countKeysLessAvx512(const int *keys, int numKeys, int value)
+	{
+		__m512i pivot = _mm512_set1_epi32(value);
+		int count = 0;
+		int i = 0;
+		for (; i + 16 <= numKeys; i += 16)
+		{
+			__m512i block = _mm512_loadu_si512((const void *)(keys + i));
+			count += __builtin_popcount(_mm512_cmplt_epi32_mask(block, pivot));
+		}
+		return count + countKeysLessScalar(keys + i, numKeys - i, value);
+	}
+
+	__attribute__((target("avx512f"))) static int countKeysGreaterAvx512(const int *keys, int numKeys, int value)
+	{
+		__m512i pivot = _mm512_set1_epi32(value);
+		int count = 0;
+		int i = 0;
+		for (; i + 16 <= numKeys; i += 16)
+		{
+			__m512i block = _mm512_loadu_si512((const void *)(keys + i));
+			count += __builtin_popcount(_mm512_cmpgt_epi32_mask(block, pivot));
+		}
+		return count + countKeysGreaterScalar(keys + i, numKeys - i, value);
+	}
+#endif
+
+	// -----------------------------------------------------------------------------
+	// Slot filters
+	// -----------------------------------------------------------------------------
+
+	/**
+	 * Find the slots of a sorted key array within a range whose operators and kernels are fixed at compile time.
+	 * Each bound is a single call of a count kernel.
+	 */
+	template <Operator LowOp, Operator HighOp, int (*CountLess)(const int *, int, int), int (*CountGreater)(const int *, int, int)>
+	static void filterSlots(const int *keys, int numKeys, int lowVal, int highVal, int &first, int &end)
+	{
+		//in a sorted array the number of keys below the range is the first slot in range,
+		//and the number of keys not above it is one past the last slot in range
+		first = LowOp == GTE ? CountLess(keys, numKeys, lowVal) : numKeys - CountGreater(keys, numKeys, lowVal);
+		end = HighOp == LT ? CountLess(keys, numKeys, highVal) : numKeys - CountGreater(keys, numKeys, highVal);
+	}
+
+	/**
+	 * Select the instantiation of filterSlots for an operator pair, given the kernels of one implementation.
+	 */
+	template <int (*CountLess)(const int *, int, int), int (*CountGreater)(const int *, int, int)>
+	static SlotFilter selectSlotFilter(Operator lowOp, Operator highOp)
+	{
+		if (lowOp == GTE)
+		{
+			return highOp == LT ? filterSlots<GTE, LT, CountLess, CountGreater> : filterSlots<GTE, LTE, CountLess, CountGreater>;
+		}
+		return highOp == LT ? filterSlots<GT, LT, CountLess, CountGreater> : filterSlots<GT, LTE, CountLess, CountGreater>;
+	}
+
+	// -----------------------------------------------------------------------------
+	// Run time dispatch
+	// -----------------------------------------------------------------------------
+
+	KeyFilterLevel keyFilterLevel()
+	{
+#ifdef BADGERDB_X86_KERNELS
+		static const KeyFilterLevel level = __builtin_cpu_supports("avx512f") ? AVX512_FILTER
+											: __builtin_cpu_supports("avx2")  ? AVX2_FILTER
+																			   : SCALAR_FILTER;
+		return level;
+#else
+		return SCALAR_FILTER;
+#endif
+	}
+
+	SlotFilter selectSlotFilter(Operator lowOp, Operator highOp, KeyFilterLevel level)
+	{
+		switch (level)
+		{
+#ifdef BADGERDB_X86_KERNELS
+		case AVX512_FILTER:
+			return selectSlotFilter<countKeysLessAvx512, countKeysGreaterAvx512>(lowOp, highOp);
+		case AVX2_FILTER:
+			return selectSlotFilter<countKeysLessAvx2, countKeysGreaterAvx2>(lowOp, highOp);
+#endif
+		default:
+			return selectSlotFilter<countKeysLessScalar, countKeysGreaterScalar>(lowOp, highOp);
+		}
+	}
+
+	const char *keyFilterImplementation()
+	{
+		switch (keyFilterLevel())
+		{
+		case AVX512_FILTER:
+			return "avx512";
+		case AVX2_FILTER:
+			return "avx2";
+		default:
+			return "scalar";
+		}
+	}
+
+}
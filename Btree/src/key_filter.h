@@ -0,0 +1,70 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Kernels filtering arrays of INTEGER keys against a scan range.
+ * Each kernel has AVX-512, AVX2 and portable implementations; the widest one the CPU supports is picked at run time,
+ * once per scan. Only the portable one is built for other than x86 targets.
+ */
+
+/**
+ * @brief Implementations of the kernels, narrowest first.
+ */
+enum KeyFilterLevel
+{
+	SCALAR_FILTER,
+	AVX2_FILTER,
+	AVX512_FILTER
+};
+
+/**
+ * Widest implementation of the kernels the CPU supports.
+ */
+KeyFilterLevel keyFilterLevel();
+
+/**
+ * @brief Function finding the slots of a sorted key array within a scan range whose operators are fixed when it is selected.
+ * @param keys			Keys, in increasing order
+ * @param numKeys		Number of keys
+ * @param lowVal		Low value of range
+ * @param highVal		High value of range
+ * @param first			First slot whose key is not below the range returned in this, numKeys if none
+ * @param end				One past the last slot whose key is in range returned in this; the range is empty if end <= first
+ */
+typedef void (*SlotFilter)(const int *keys, int numKeys, int lowVal, int highVal, int &first, int &end);
+
+/**
+ * Whether a key is in a range whose operators are fixed at compile time, as a straight-line pair of comparisons.
+ */
+template <Operator LowOp, Operator HighOp, typename T>
+inline bool keyInRange(T key, T lowVal, T highVal)
+{
+	return (LowOp == GTE ? key >= lowVal : key > lowVal) && (HighOp == LT ? key < highVal : key <= highVal);
+}
+
+/**
+ * Select the slot filter for an operator pair and a kernel implementation. Called once per scan rather than once per key;
+ * the filter calls its kernels directly, without dispatching again.
+ * @param lowOp			Low operator (GT/GTE)
+ * @param highOp		High operator (LT/LTE)
+ * @param level			Implementation of the kernels, at most keyFilterLevel()
+ */
+SlotFilter selectSlotFilter(Operator lowOp, Operator highOp, KeyFilterLevel level = keyFilterLevel());
+
+/**
+ * Name of the kernel implementation picked for this CPU: "avx512", "avx2" or "scalar".
+ */
+const char *keyFilterImplementation();
+
+}
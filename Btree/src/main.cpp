@@ -5,8 +5,19 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
 #include <vector>
 #include "btree.h"
+#include "hash_index.h"
+#include "bitmap_index.h"
+#include "static_index.h"
+#include "key_filter.h"
+#include "batch_pipeline.h"
+#include "task_scheduler.h"
+#include "pool_model.h"
 #include "page.h"
 #include "filescan.h"
 #include "page_iterator.h"
@@ -19,6 +30,10 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/invalid_record_exception.h"
+#include "exceptions/memory_budget_exceeded_exception.h"
+#include "exceptions/file_open_exception.h"
 
 #define checkPassFail(a, b)                                               \
 	{                                                                     \
@@ -43,6 +58,7 @@ const std::string relationName = "relA";
 //If the relation size is changed then the second parameter 2 chechPassFail may need to be changed to number of record that are expected to be found during the scan, else tests will erroneously be reported to have failed.
 const int relationSize = 5000;
 std::string intIndexName, doubleIndexName, stringIndexName;
+std::string hashIndexName, bitmapIndexName, staticIndexName;
 
 // This is the structure for tuples in the base relation
 
@@ -69,6 +85,31 @@ void intEmpty();
 void intSingle();
 void intNegative();
 void intMaxed();
+void intDeltaBuffer();
+void intHash();
+int hashFind(HashIndex *index, int key, std::vector<RecordId> &rids);
+void intBitmap();
+int bitmapRangeMismatches(BitmapIndex *index);
+void intStatic(int modelError);
+int staticScan(StaticIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int staticRangeMismatches(StaticIndex *index);
+void keyFilterKernels();
+void intLayout(NonLeafLayout layout, FileCompression compression);
+void intFindAsync();
+int findAsyncMismatches(BTreeIndex *index, TaskScheduler &scheduler);
+int btreeRangeMismatches(BTreeIndex *index);
+int relationCount(int lowVal, Operator lowOp, int highVal, Operator highOp);
+void batchTests();
+int batchFileCount(int lowVal, Operator lowOp, int highVal, Operator highOp);
+int batchIndexCount(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+void traceReplay();
+void stampPages(BufMgr &pool, File &file, std::vector<RecordId> &rids, std::vector<int> &stamps);
+int readStampMismatches(BufMgr &pool, File &file, const std::vector<RecordId> &rids, const std::vector<int> &stamps);
+void victimCacheTests();
+void spillCacheTests();
+void missRatioCurveTests();
+void memoryTrackerTests();
+void ioRingTests();
 
 void createRelationForward();
 void createRelationBackward();
@@ -83,8 +124,22 @@ void test4();
 void test5();
 void test6();
 void test7();
+void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
 void errorTests();
 void deleteRelation();
+void deleteIndex(const std::string &indexName);
 
 int main(int argc, char **argv)
 {
@@ -151,6 +206,19 @@ int main(int argc, char **argv)
 	test5();
 	test6();
 	test7();
+	test8();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
 	errorTests();
 
 	delete bufMgr;
@@ -197,6 +265,7 @@ void test4()
 	std::cout << "Test for empty tree" << std::endl;
 	createRelationRandomInput(600);
 	intSingle();
+	deleteIndex(intIndexName);
 	deleteRelation();
 }
 void test5()
@@ -206,6 +275,7 @@ void test5()
 	std::cout << "createRelationRando" << std::endl;
 	createRelationRandomInput(0);
 	intEmpty();
+	deleteIndex(intIndexName);
 	deleteRelation();
 }
 void test6()
@@ -215,6 +285,7 @@ void test6()
 	std::cout << "createRelationRando" << std::endl;
 	createRelationForwardInput(-1000, 1000);
 	intNegative();
+	deleteIndex(intIndexName);
 	deleteRelation();
 }
 void test7()
@@ -224,8 +295,135 @@ void test7()
 	std::cout << "createRelationRando" << std::endl;
 	createRelationRandom();
 	intMaxed();
+	deleteIndex(intIndexName);
 	deleteRelation();
 }
+void test8()
+{
+	//Testing inserts held in the delta buffer
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationForward" << std::endl;
+	createRelationForward();
+	intDeltaBuffer();
+	deleteIndex(intIndexName);
+	deleteRelation();
+}
+void test9()
+{
+	//Testing the hash index
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationRandom" << std::endl;
+	createRelationRandom();
+	intHash();
+	deleteIndex(hashIndexName);
+	deleteRelation();
+}
+void test10()
+{
+	//Testing the bitmap index
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationForward" << std::endl;
+	createRelationForwardInput(-100, 100);
+	intBitmap();
+	deleteIndex(bitmapIndexName);
+	deleteRelation();
+}
+void test11()
+{
+	//Testing the static index
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationRandom" << std::endl;
+	createRelationRandom();
+	intStatic(0);
+	deleteIndex(staticIndexName);
+	intStatic(4);
+	deleteIndex(staticIndexName);
+	intStatic(64);
+	deleteIndex(staticIndexName);
+	deleteRelation();
+}
+void test12()
+{
+	//Testing the key filter kernels, and every node layout with raw and compressed pages
+	std::cout << "--------------------" << std::endl;
+	keyFilterKernels();
+	std::cout << "createRelationRandom" << std::endl;
+	createRelationRandom();
+	intLayout(FLAT_LAYOUT, RAW_PAGES);
+	intLayout(FLAT_LAYOUT, COMPRESSED_PAGES);
+	intLayout(BLOCKED_LAYOUT, RAW_PAGES);
+	intLayout(BLOCKED_LAYOUT, COMPRESSED_PAGES);
+	deleteRelation();
+}
+void test13()
+{
+	//Testing lookups run through a task scheduler
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationRandom" << std::endl;
+	createRelationRandom();
+	intFindAsync();
+	deleteIndex(intIndexName);
+	deleteRelation();
+}
+void test14()
+{
+	//Testing an access trace recorded by BufMgr and replayed through the pool models of bufsim
+	std::cout << "--------------------" << std::endl;
+	traceReplay();
+}
+void test15()
+{
+	//Testing the compressed cache of evicted pages
+	std::cout << "--------------------" << std::endl;
+	victimCacheTests();
+}
+void test16()
+{
+	//Testing the local cache file of evicted pages
+	std::cout << "--------------------" << std::endl;
+	spillCacheTests();
+}
+void test17()
+{
+	//Testing the online estimate of the miss ratio curve
+	std::cout << "--------------------" << std::endl;
+	missRatioCurveTests();
+}
+void test18()
+{
+	//Testing the accounting of library memory against a budget
+	std::cout << "--------------------" << std::endl;
+	memoryTrackerTests();
+}
+void test19()
+{
+	// Run the batch pipeline over relations in every order and compare it with the scans of a row at a time
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationForward" << std::endl;
+	createRelationForward();
+	batchTests();
+	deleteIndex(intIndexName);
+	deleteRelation();
+
+	std::cout << "createRelationBackward" << std::endl;
+	createRelationBackward();
+	batchTests();
+	deleteIndex(intIndexName);
+	deleteRelation();
+
+	std::cout << "createRelationRandom" << std::endl;
+	createRelationRandom();
+	batchTests();
+	deleteIndex(intIndexName);
+	deleteRelation();
+}
+void test20()
+{
+	//Testing batches of page transfers through io_uring and through pread/pwrite
+	std::cout << "--------------------" << std::endl;
+	ioRingTests();
+}
+
 // -----------------------------------------------------------------------------
 // createRelationForward
 // -----------------------------------------------------------------------------
@@ -578,6 +776,992 @@ void intMaxed()
 	checkPassFail(intScan(&index, -3000, GT, 0, LT), 0);
 	checkPassFail(intScan(&index, -3000, GT, 0, LTE), 1);
 }
+void intDeltaBuffer()
+{
+	std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+		index.enableDeltaBuffer(1 << 20);
+
+		// index the first 500 records a second time, under keys 10000 and up
+		FileScan scanner(relationName, bufMgr);
+		RecordId scanRid, firstRid;
+		std::size_t length;
+		while (scanner.tryScanNext(scanRid))
+		{
+			int key = reinterpret_cast<const RECORD *>(scanner.getRecordData(length))->i;
+			if (key < 500)
+			{
+				firstRid = key == 0 ? scanRid : firstRid;
+				key += 10000;
+				index.insertEntry(&key, scanRid);
+			}
+		}
+		checkPassFail((int)index.deltaBufferSize(), 500)
+		checkPassFail(MemoryTracker::process().bytesUsed(MEMORY_DELTABUFFER), 500 * DELTABUFFERENTRYSIZE)
+
+		// scans see the entries still held in the buffer
+		checkPassFail(intScan(&index, 10000, GTE, 10500, LT), 500)
+		checkPassFail(intScan(&index, 10100, GT, 10200, LTE), 100)
+		checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+
+		index.mergeDeltaBuffer();
+		checkPassFail((int)index.deltaBufferSize(), 0)
+		checkPassFail(MemoryTracker::process().bytesUsed(MEMORY_DELTABUFFER), 0)
+		checkPassFail(intScan(&index, 10000, GTE, 10500, LT), 500)
+		checkPassFail(intScan(&index, 10100, GT, 10200, LTE), 100)
+		checkPassFail(intScan(&index, 3000, GTE, 4000, LT), 1000)
+
+		// leave some entries in the buffer for the destructor to merge
+		for (int key = 20000; key < 20050; key++)
+		{
+			index.insertEntry(&key, firstRid);
+		}
+	}
+
+	std::cout << "Reopen the B+ Tree index on the integer field" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+	checkPassFail(intScan(&index, 10000, GTE, 10500, LT), 500)
+	checkPassFail(intScan(&index, 20000, GTE, 20050, LT), 50)
+	checkPassFail(intScan(&index, 300, GT, 400, LT), 99)
+}
+void intHash()
+{
+	std::cout << "Create a hash index on the integer field" << std::endl;
+	std::vector<RecordId> rids;
+	{
+		HashIndex index(relationName, hashIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+		checkPassFail(index.size(), relationSize)
+
+		// every key finds as many records as the relation holds
+		int mismatches = 0;
+		for (int key = -10; key < relationSize + 10; key++)
+		{
+			int expected = relationCount(key, GTE, key, LTE);
+			if (hashFind(&index, key, rids) != expected)
+			{
+				mismatches++;
+			}
+		}
+		checkPassFail(mismatches, 0)
+
+		// duplicates of a key are found and deleted one at a time
+		hashFind(&index, 100, rids);
+		RecordId rid100 = rids[0];
+		int key = 100;
+		index.insertEntry(&key, rid100);
+		index.insertEntry(&key, rid100);
+		checkPassFail(hashFind(&index, 100, rids), 3)
+		index.deleteEntry(&key, rid100);
+		checkPassFail(hashFind(&index, 100, rids), 2)
+
+		key = 200;
+		hashFind(&index, 200, rids);
+		index.deleteEntry(&key, rids[0]);
+		checkPassFail(hashFind(&index, 200, rids), 0)
+		std::cout << "Delete a missing entry" << std::endl;
+		try
+		{
+			index.deleteEntry(&key, rid100);
+			std::cout << "NoSuchKeyFoundException Test 1 Failed." << std::endl;
+		}
+		catch (const NoSuchKeyFoundException &e)
+		{
+			std::cout << "NoSuchKeyFoundException Test 1 Passed." << std::endl;
+		}
+		checkPassFail(index.size(), relationSize)
+	}
+
+	std::cout << "Reopen the hash index on the integer field" << std::endl;
+	HashIndex index(relationName, hashIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+	checkPassFail(index.size(), relationSize)
+	checkPassFail(hashFind(&index, 100, rids), 2)
+	checkPassFail(hashFind(&index, 200, rids), 0)
+	checkPassFail(hashFind(&index, relationSize - 1, rids), 1)
+	checkPassFail(hashFind(&index, relationSize, rids), 0)
+}
+
+void intBitmap()
+{
+	std::cout << "Create a bitmap index on the integer field" << std::endl;
+	{
+		BitmapIndex index(relationName, bitmapIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+		checkPassFail(index.numRecords(), 200)
+		checkPassFail(index.numValues(), 200)
+
+		// equals finds as many records as the relation holds, and their RecordIds
+		int mismatches = 0;
+		Bitmap bitmap;
+		std::vector<RecordId> rids;
+		for (int value = -110; value < 110; value++)
+		{
+			index.equals(&value, bitmap);
+			rids.clear();
+			index.getRecordIds(bitmap, rids);
+			int expected = relationCount(value, GTE, value, LTE);
+			if (bitmap.count() != expected || (int)rids.size() != expected)
+			{
+				mismatches++;
+			}
+		}
+		checkPassFail(mismatches, 0)
+		checkPassFail(bitmapRangeMismatches(&index), 0)
+
+		// ranges combine with and and or
+		Bitmap low, high;
+		int int0 = 0, int50 = 50, intm50 = -50;
+		index.range(&intm50, GTE, &int50, LT, low);
+		index.range(&int0, GT, &int50, LTE, high);
+		low.andWith(high);
+		checkPassFail(low.count(), relationCount(0, GT, 50, LT))
+		index.range(&intm50, GTE, &int0, LTE, low);
+		low.orWith(high);
+		checkPassFail(low.count(), relationCount(-50, GTE, 50, LTE))
+	}
+
+	std::cout << "Reopen the bitmap index on the integer field" << std::endl;
+	BitmapIndex index(relationName, bitmapIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+	checkPassFail(index.numValues(), 200)
+	checkPassFail(bitmapRangeMismatches(&index), 0)
+}
+
+int bitmapRangeMismatches(BitmapIndex *index)
+{
+	// every operator pair, over ranges inside, across and outside the values of the relation
+	const Operator lowOps[2] = {GT, GTE};
+	const Operator highOps[2] = {LT, LTE};
+	const int bounds[][2] = {{-100, 99}, {-3, 3}, {25, 40}, {-150, -90}, {90, 150}, {7, 7}, {100, 200}, {-300, -101}};
+	int mismatches = 0;
+	Bitmap bitmap;
+	for (int l = 0; l < 2; l++)
+	{
+		for (int h = 0; h < 2; h++)
+		{
+			for (std::size_t b = 0; b < sizeof(bounds) / sizeof(bounds[0]); b++)
+			{
+				index->range(&bounds[b][0], lowOps[l], &bounds[b][1], highOps[h], bitmap);
+				if (bitmap.count() != relationCount(bounds[b][0], lowOps[l], bounds[b][1], highOps[h]))
+				{
+					mismatches++;
+				}
+			}
+		}
+	}
+	return mismatches;
+}
+
+void intStatic(int modelError)
+{
+	std::cout << "Create a static index on the integer field, model error " << modelError << std::endl;
+	{
+		StaticIndex index(relationName, staticIndexName, bufMgr, offsetof(tuple, i), INTEGER, modelError);
+		checkPassFail(index.size(), relationSize)
+		checkPassFail(staticScan(&index, 25, GT, 40, LT), 14)
+		checkPassFail(staticScan(&index, 3000, GTE, 4000, LT), 1000)
+		checkPassFail(staticRangeMismatches(&index), 0)
+		checkPassFail((index.numModelSegments() > 0), (modelError > 0))
+	}
+
+	std::cout << "Reopen the static index on the integer field" << std::endl;
+	StaticIndex index(relationName, staticIndexName, bufMgr, offsetof(tuple, i), INTEGER, modelError);
+	checkPassFail(index.size(), relationSize)
+	checkPassFail(staticRangeMismatches(&index), 0)
+}
+
+int staticScan(StaticIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+	if (!index->tryStartScan(&lowVal, lowOp, &highVal, highOp))
+	{
+		return 0;
+	}
+	int numResults = 0;
+	RecordId scanRid;
+	while (index->tryScanNext(scanRid))
+	{
+		numResults++;
+	}
+	index->endScan();
+	return numResults;
+}
+
+int staticRangeMismatches(StaticIndex *index)
+{
+	// every operator pair, over ranges inside, across and outside the keys of the relation
+	const Operator lowOps[2] = {GT, GTE};
+	const Operator highOps[2] = {LT, LTE};
+	const int bounds[][2] = {{0, relationSize}, {-3, 3}, {25, 40}, {996, 1001}, {1234, 1234},
+							 {relationSize - 10, relationSize + 10}, {relationSize, 2 * relationSize}, {-100, -1}};
+	int mismatches = 0;
+	for (int l = 0; l < 2; l++)
+	{
+		for (int h = 0; h < 2; h++)
+		{
+			for (std::size_t b = 0; b < sizeof(bounds) / sizeof(bounds[0]); b++)
+			{
+				if (staticScan(index, bounds[b][0], lowOps[l], bounds[b][1], highOps[h])
+					!= relationCount(bounds[b][0], lowOps[l], bounds[b][1], highOps[h]))
+				{
+					mismatches++;
+				}
+			}
+		}
+	}
+	// and every single key
+	for (int key = 0; key < relationSize; key += 7)
+	{
+		if (staticScan(index, key, GTE, key, LTE) != 1)
+		{
+			mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+void keyFilterKernels()
+{
+	std::cout << "Check the key filter kernels up to " << keyFilterImplementation() << std::endl;
+	const Operator lowOps[2] = {GT, GTE};
+	const Operator highOps[2] = {LT, LTE};
+	int mismatches = 0;
+	std::vector<int> keys;
+	for (int level = SCALAR_FILTER; level <= keyFilterLevel(); level++)
+	{
+		for (int numKeys = 0; numKeys < 100; numKeys++)
+		{
+			// sorted keys with duplicates, and bounds around and between them
+			keys.resize(numKeys);
+			for (int i = 0; i < numKeys; i++)
+			{
+				keys[i] = random() % 64 - 32;
+			}
+			std::sort(keys.begin(), keys.end());
+			int lowVal = random() % 80 - 40;
+			int highVal = lowVal + random() % 40;
+			for (int l = 0; l < 2; l++)
+			{
+				for (int h = 0; h < 2; h++)
+				{
+					int first, end;
+					selectSlotFilter(lowOps[l], highOps[h], KeyFilterLevel(level))(keys.data(), numKeys, lowVal, highVal, first, end);
+					int expectedFirst = 0, expectedEnd = 0;
+					for (int i = 0; i < numKeys; i++)
+					{
+						expectedFirst += lowOps[l] == GT ? keys[i] <= lowVal : keys[i] < lowVal;
+						expectedEnd += highOps[h] == LT ? keys[i] < highVal : keys[i] <= highVal;
+					}
+					if (first != expectedFirst || end != expectedEnd)
+					{
+						mismatches++;
+					}
+				}
+			}
+		}
+	}
+	checkPassFail(mismatches, 0)
+}
+
+void intLayout(NonLeafLayout layout, FileCompression compression)
+{
+	std::cout << "Create a B+ Tree index on the integer field, "
+			  << (layout == BLOCKED_LAYOUT ? "blocked" : "flat") << " layout, "
+			  << (compression == COMPRESSED_PAGES ? "compressed" : "raw") << " pages" << std::endl;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, layout, nullptr, compression);
+		checkPassFail(btreeRangeMismatches(&index), 0)
+
+		// index the first 500 records a second time, under keys 10000 and up, through the delta buffer
+		index.enableDeltaBuffer(1 << 20);
+		FileScan scanner(relationName, bufMgr);
+		RecordId scanRid;
+		std::size_t length;
+		while (scanner.tryScanNext(scanRid))
+		{
+			int key = reinterpret_cast<const RECORD *>(scanner.getRecordData(length))->i;
+			if (key < 500)
+			{
+				key += 10000;
+				index.insertEntry(&key, scanRid);
+			}
+		}
+		index.mergeDeltaBuffer();
+		checkPassFail(intScan(&index, 10000, GTE, 10500, LT), 500)
+		checkPassFail(btreeRangeMismatches(&index), 0)
+	}
+
+	std::cout << "Reopen the B+ Tree index on the integer field" << std::endl;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+		checkPassFail(index.countScan(&relationSize, GTE, &relationSize, LTE), 0)
+		int low = 10000, high = 10500;
+		checkPassFail(index.countScan(&low, GTE, &high, LT), 500)
+		checkPassFail(btreeRangeMismatches(&index), 0)
+	}
+	deleteIndex(intIndexName);
+}
+
+int btreeRangeMismatches(BTreeIndex *index)
+{
+	// every operator pair, over ranges inside, across and outside the keys of the relation, scanned and counted
+	const Operator lowOps[2] = {GT, GTE};
+	const Operator highOps[2] = {LT, LTE};
+	const int bounds[][2] = {{0, relationSize}, {-3, 3}, {25, 40}, {996, 1001}, {1234, 1234}, {681, 683},
+							 {relationSize - 10, relationSize + 10}, {relationSize, 9999}, {-100, -1}};
+	int mismatches = 0;
+	RecordId scanRid;
+	for (int l = 0; l < 2; l++)
+	{
+		for (int h = 0; h < 2; h++)
+		{
+			for (std::size_t b = 0; b < sizeof(bounds) / sizeof(bounds[0]); b++)
+			{
+				int expected = relationCount(bounds[b][0], lowOps[l], bounds[b][1], highOps[h]);
+				int scanned = 0;
+				if (index->tryStartScan(&bounds[b][0], lowOps[l], &bounds[b][1], highOps[h]))
+				{
+					while (index->tryScanNext(scanRid))
+					{
+						scanned++;
+					}
+					index->endScan();
+				}
+				if (scanned != expected || index->countScan(&bounds[b][0], lowOps[l], &bounds[b][1], highOps[h]) != expected)
+				{
+					mismatches++;
+				}
+			}
+		}
+	}
+	return mismatches;
+}
+
+void intFindAsync()
+{
+	std::cout << "Create a B+ Tree index on the integer field, looking keys up asynchronously" << std::endl;
+	TaskScheduler scheduler(4);
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+		checkPassFail(findAsyncMismatches(&index, scheduler), 0)
+	}
+
+	// the pages of the reopened index are read by the workers of the scheduler
+	std::cout << "Reopen the index, looking keys up asynchronously" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+	checkPassFail(findAsyncMismatches(&index, scheduler), 0)
+
+	std::cout << "Look a missing key up asynchronously" << std::endl;
+	int missing = relationSize + 5;
+	std::future<std::vector<RecordId> > result = index.findAsync(scheduler, &missing);
+	checkPassFail(result.get().size(), 0)
+
+	// a task submitted once the workers have started exiting is run by the submitting thread
+	std::cout << "Submit tasks while the scheduler shuts down" << std::endl;
+	TaskScheduler racing(2);
+	std::atomic<int> ran(0);
+	const int numTasks = 10000;
+	std::thread submitter([&racing, &ran, numTasks]() {
+		for (int i = 0; i < numTasks; i++)
+		{
+			racing.submit([&ran]() { ran++; });
+		}
+	});
+	racing.shutdown();
+	submitter.join();
+	checkPassFail(ran.load(), numTasks)
+}
+
+int findAsyncMismatches(BTreeIndex *index, TaskScheduler &scheduler)
+{
+	// record ids of every key, by a scan of the relation
+	std::map<int, std::vector<RecordId> > expected;
+	{
+		FileScan scanner(relationName, bufMgr);
+		RecordId scanRid;
+		std::size_t length;
+		while (scanner.tryScanNext(scanRid))
+		{
+			expected[reinterpret_cast<const RECORD *>(scanner.getRecordData(length))->i].push_back(scanRid);
+		}
+	}
+
+	// issue every lookup before waiting for any, so that they overlap
+	std::vector<int> keys;
+	std::vector<std::future<std::vector<RecordId> > > results;
+	for (int key = -10; key < relationSize + 10; key++)
+	{
+		keys.push_back(key);
+		results.push_back(index->findAsync(scheduler, &key));
+	}
+
+	int mismatches = 0;
+	for (std::size_t k = 0; k < keys.size(); k++)
+	{
+		std::vector<RecordId> rids;
+		try
+		{
+			rids = results[k].get();
+		}
+		catch (const NoSuchKeyFoundException &e)
+		{
+		}
+		std::vector<RecordId> &truth = expected[keys[k]];
+		if (rids.size() != truth.size())
+		{
+			mismatches++;
+			continue;
+		}
+		for (std::size_t r = 0; r < truth.size(); r++)
+		{
+			if (std::find(rids.begin(), rids.end(), truth[r]) == rids.end())
+			{
+				mismatches++;
+				break;
+			}
+		}
+	}
+	return mismatches;
+}
+
+void traceReplay()
+{
+	std::cout << "Record the page reads of a small pool and replay them through the CLOCK model" << std::endl;
+	const std::string pagesName = "relA.pages";
+	const std::string traceName = "relA.trace";
+	const std::uint32_t frames = 8;
+	const int numPages = 12;
+	const int numPasses = 4;
+	int diskreads;
+	{
+		// read more pages than fit in the pool cyclically, unpinning every page at once
+		BufMgr pool(frames);
+		BlobFile file(pagesName, true);
+		pool.startTrace(traceName);
+		std::vector<PageId> pageNos(numPages);
+		Page *page;
+		for (int i = 0; i < numPages; i++)
+		{
+			pool.allocPage(&file, pageNos[i], page);
+			pool.unPinPage(&file, pageNos[i], true);
+		}
+		pool.clearBufStats();
+		for (int pass = 0; pass < numPasses; pass++)
+		{
+			for (int i = 0; i < numPages; i++)
+			{
+				pool.readPage(&file, pageNos[i], page);
+				pool.unPinPage(&file, pageNos[i], false);
+			}
+		}
+		diskreads = pool.getBufStats().diskreads;
+		pool.flushFile(&file);
+		pool.stopTrace();
+	}
+	File::remove(pagesName);
+
+	std::vector<TraceRecord> trace;
+	int reads = 0;
+	{
+		AccessTraceReader reader(traceName);
+		TraceRecord record;
+		while (reader.next(record))
+		{
+			trace.push_back(record);
+			reads += record.op == TRACE_READ;
+		}
+		checkPassFail(reader.numFiles(), 1)
+		checkPassFail(reader.fileName(0), pagesName)
+	}
+	File::remove(traceName);
+	checkPassFail(reads, numPages * numPasses)
+
+	// the CLOCK model follows BufMgr::allocBuf, so it misses on the same reads
+	std::unique_ptr<PoolModel> clock(makeModel(0, frames));
+	int misses = (int)(replay(trace, *clock) * reads + 0.5);
+	checkPassFail(misses, diskreads)
+}
+
+void stampPages(BufMgr &pool, File &file, std::vector<RecordId> &rids, std::vector<int> &stamps)
+{
+	// allocate the pages and insert a record holding a stamp into each
+	Page *page;
+	for (std::size_t i = 0; i < rids.size(); i++)
+	{
+		PageId pageNo;
+		pool.allocPage(&file, pageNo, page);
+		stamps[i] = (int)i;
+		rids[i] = page->insertRecord(std::string((const char *)&stamps[i], sizeof(int)));
+		pool.unPinPage(&file, pageNo, true);
+	}
+}
+
+int readStampMismatches(BufMgr &pool, File &file, const std::vector<RecordId> &rids, const std::vector<int> &stamps)
+{
+	int mismatches = 0;
+	Page *page;
+	for (std::size_t i = 0; i < rids.size(); i++)
+	{
+		pool.readPage(&file, rids[i].page_number, page);
+		mismatches += *(const int *)page->getRecord(rids[i]).data() != stamps[i];
+		pool.unPinPage(&file, rids[i].page_number, false);
+	}
+	return mismatches;
+}
+
+void victimCacheTests()
+{
+	const std::string pagesName = "relA.pages";
+	const std::uint32_t frames = 8;
+	std::vector<RecordId> rids(2 * frames);
+	std::vector<int> stamps(rids.size());
+	{
+		BufMgr pool(frames, 1 << 20);
+		PageFile file(pagesName, true);
+		stampPages(pool, file, rids, stamps);
+
+		// twice as many pages as frames, read cyclically: every read misses the pool and hits the cache
+		std::cout << "Read back pages evicted into the victim cache" << std::endl;
+		pool.clearBufStats();
+		int mismatches = readStampMismatches(pool, file, rids, stamps);
+		mismatches += readStampMismatches(pool, file, rids, stamps);
+		checkPassFail(mismatches, 0)
+		checkPassFail(pool.getBufStats().victimhits, (int)rids.size() * 2)
+		checkPassFail(pool.getBufStats().diskreads, 0)
+
+		// a page written after its image was cached is cached again when evicted, replacing the stale image
+		std::cout << "Read back a page changed since it was last evicted" << std::endl;
+		Page *page;
+		pool.readPage(&file, rids[0].page_number, page);
+		stamps[0] = 1000;
+		page->updateRecord(rids[0], std::string((const char *)&stamps[0], sizeof(int)));
+		pool.unPinPage(&file, rids[0].page_number, true);
+		checkPassFail(readStampMismatches(pool, file, rids, stamps), 0)
+
+		// the first half of the pages is cached and the second half in the pool now
+		std::cout << "Drop the images of disposed pages and flushed files" << std::endl;
+		std::size_t cachedPages = pool.getVictimCache().numPages();
+		pool.disposePage(&file, rids[0].page_number);
+		checkPassFail(pool.getVictimCache().numPages(), cachedPages - 1)
+		pool.flushFile(&file);
+		checkPassFail(pool.getVictimCache().numPages(), 0)
+		pool.clearBufStats();
+		std::vector<RecordId> kept(rids.begin() + 1, rids.end());
+		std::vector<int> keptStamps(stamps.begin() + 1, stamps.end());
+		checkPassFail(readStampMismatches(pool, file, kept, keptStamps), 0)
+		checkPassFail(pool.getBufStats().victimhits, 0)
+		pool.flushFile(&file);
+	}
+	File::remove(pagesName);
+
+	std::cout << "Drop a corrupt image instead of decompressing it" << std::endl;
+	{
+		VictimCache cache(1 << 20);
+		BlobFile file(pagesName, true);
+		Page page;
+		std::vector<char> image(64, (char)0xff);
+		cache.insertImage(&file, 1, image.data(), image.size());
+		checkPassFail(cache.numPages(), 1)
+		checkPassFail(cache.fetch(&file, 1, page), false)
+		checkPassFail(cache.numPages(), 0)
+		checkPassFail(cache.bytesUsed(), 0)
+	}
+	File::remove(pagesName);
+}
+
+void spillCacheTests()
+{
+	const std::string pagesName = "relA.pages";
+	const std::string spillName = "relA.spill";
+	const std::uint32_t frames = 8;
+	std::vector<RecordId> rids(2 * frames);
+	std::vector<int> stamps(rids.size());
+	{
+		BufMgr pool(frames, 0, spillName, 4 * frames);
+		PageFile file(pagesName, true);
+		stampPages(pool, file, rids, stamps);
+
+		// twice as many pages as frames, read cyclically: every read misses the pool and hits the cache
+		std::cout << "Read back pages evicted into the spill cache" << std::endl;
+		pool.clearBufStats();
+		int mismatches = readStampMismatches(pool, file, rids, stamps);
+		mismatches += readStampMismatches(pool, file, rids, stamps);
+		checkPassFail(mismatches, 0)
+		checkPassFail(pool.getBufStats().spillhits, (int)rids.size() * 2)
+		checkPassFail(pool.getBufStats().diskreads, 0)
+
+		// once the queue is drained, the evicted pages are read from the cache file
+		std::cout << "Read back pages from the spill cache file" << std::endl;
+		pool.getSpillCache()->drain();
+		pool.clearBufStats();
+		checkPassFail(readStampMismatches(pool, file, rids, stamps), 0)
+		checkPassFail(pool.getBufStats().spillhits, (int)rids.size())
+		checkPassFail(pool.getBufStats().diskreads, 0)
+
+		// a page written after it was cached is cached again when evicted, replacing the stale copy
+		std::cout << "Read back a page changed since it was last evicted" << std::endl;
+		Page *page;
+		pool.readPage(&file, rids[0].page_number, page);
+		stamps[0] = 1000;
+		page->updateRecord(rids[0], std::string((const char *)&stamps[0], sizeof(int)));
+		pool.unPinPage(&file, rids[0].page_number, true);
+		checkPassFail(readStampMismatches(pool, file, rids, stamps), 0)
+		pool.getSpillCache()->drain();
+		checkPassFail(readStampMismatches(pool, file, rids, stamps), 0)
+
+		// every page stays in the spill cache, read back or not
+		std::cout << "Drop the copies of disposed pages and flushed files" << std::endl;
+		std::size_t cachedPages = pool.getSpillCache()->numPages();
+		checkPassFail(cachedPages, rids.size())
+		pool.disposePage(&file, rids[0].page_number);
+		checkPassFail(pool.getSpillCache()->numPages(), cachedPages - 1)
+		pool.flushFile(&file);
+		checkPassFail(pool.getSpillCache()->numPages(), 0)
+		pool.clearBufStats();
+		std::vector<RecordId> kept(rids.begin() + 1, rids.end());
+		std::vector<int> keptStamps(stamps.begin() + 1, stamps.end());
+		checkPassFail(readStampMismatches(pool, file, kept, keptStamps), 0)
+		checkPassFail(pool.getBufStats().spillhits, 0)
+		pool.flushFile(&file);
+	}
+	checkPassFail(File::exists(spillName), false)
+	File::remove(pagesName);
+}
+
+void missRatioCurveTests()
+{
+	const std::string pagesName = "relA.pages";
+	const std::uint32_t frames = 16;
+	const int numPages = frames * 3 / 2;
+	const int numPasses = 10;
+	std::cout << "Estimate the hit ratio of a cyclic scan at half to four times the pool" << std::endl;
+	{
+		// every page is read again after the others, so only pools of as many frames as pages hit, and then on every
+		// pass after the first
+		BufMgr pool(frames);
+		PageFile file(pagesName, true);
+		std::vector<RecordId> rids(numPages);
+		std::vector<int> stamps(rids.size());
+		stampPages(pool, file, rids, stamps);
+		pool.setMissRatioSampling(1.0);
+		pool.clearBufStats();
+		for (int pass = 0; pass < numPasses; pass++)
+		{
+			readStampMismatches(pool, file, rids, stamps);
+		}
+		const double expected = double(numPasses - 1) / numPasses;
+		BufStats stats = pool.getBufStats();
+		checkPassFail(stats.halfPoolHitRatio, 0)
+		checkPassFail(stats.poolHitRatio, 0)
+		checkPassFail((std::fabs(stats.doublePoolHitRatio - expected) < 1e-9), true)
+		checkPassFail((std::fabs(stats.quadruplePoolHitRatio - expected) < 1e-9), true)
+		checkPassFail((std::fabs(pool.estimateHitRatio(numPages) - expected) < 1e-9), true)
+		checkPassFail(pool.estimateHitRatio(numPages - 2), 0)
+		pool.flushFile(&file);
+	}
+	File::remove(pagesName);
+
+	// the same scan over more pages than are sampled at once: the sampling rate drops during the first pass, and the
+	// reads counted before each drop are scaled down with it
+	std::cout << "Estimate the hit ratio of a cyclic scan while the sampling rate drops" << std::endl;
+	{
+		const std::uint32_t curveFrames = 1024;
+		const PageId curvePages = curveFrames * 3 / 2;
+		MissRatioCurve curve(curveFrames, 1.0, 256);
+		BlobFile file(pagesName, true);
+		for (int pass = 0; pass < numPasses; pass++)
+		{
+			for (PageId pageNo = 1; pageNo <= curvePages; pageNo++)
+			{
+				curve.reference(&file, pageNo, MissRatioCurve::sampleHash(&file, pageNo));
+			}
+		}
+		const double expected = double(numPasses - 1) / numPasses;
+		checkPassFail((curve.samplingRate() < 0.5), true)
+		checkPassFail((curve.numSampledPages() <= 256), true)
+		checkPassFail((curve.hitRatio(curveFrames / 2) < 0.02), true)
+		checkPassFail((curve.hitRatio(curveFrames) < 0.02), true)
+		checkPassFail((std::fabs(curve.hitRatio(curveFrames * 2) - expected) < 0.02), true)
+		checkPassFail((std::fabs(curve.hitRatio(curveFrames * 4) - expected) < 0.02), true)
+	}
+	File::remove(pagesName);
+}
+
+void ioRingTests()
+{
+	const std::string pagesName = "relA.pages";
+	const int numPages = 20;
+	for (int useUring = 1; useUring >= 0; useUring--)
+	{
+		std::cout << "Write and read back a batch of pages through " << (useUring ? "io_uring where available" : "pread/pwrite") << std::endl;
+		{
+			PageFile file(pagesName, true);
+			std::vector<RecordId> rids(numPages);
+			std::vector<int> stamps(numPages);
+			for (int i = 0; i < numPages; i++)
+			{
+				PageId pageNo;
+				Page page = file.allocatePage(pageNo);
+				stamps[i] = i;
+				rids[i] = page.insertRecord(std::string((const char *)&stamps[i], sizeof(int)));
+				file.writePage(pageNo, page);
+			}
+
+			// fewer ring entries than pages, so each batch is submitted in several rounds
+			IoRing ring(8, useUring);
+			if (!useUring)
+			{
+				checkPassFail(ring.usesUring(), false)
+			}
+
+			std::vector<Page> pages(numPages);
+			std::vector<PageTransfer> writes;
+			for (int i = 0; i < numPages; i++)
+			{
+				pages[i] = file.readPage(rids[i].page_number);
+				stamps[i] = numPages + i;
+				pages[i].updateRecord(rids[i], std::string((const char *)&stamps[i], sizeof(int)));
+				PageTransfer transfer = {rids[i].page_number, &pages[i], -1, true};
+				writes.push_back(transfer);
+			}
+			file.writePages(ring, writes);
+			int mismatches = 0;
+			for (int i = 0; i < numPages; i++)
+			{
+				mismatches += *(const int *)file.readPage(rids[i].page_number).getRecord(rids[i]).data() != stamps[i];
+			}
+			checkPassFail(mismatches, 0)
+
+			// the last page is past the end of the file
+			std::vector<Page> readBack(numPages + 1);
+			std::vector<PageTransfer> reads;
+			for (int i = 0; i <= numPages; i++)
+			{
+				PageId pageNo = i < numPages ? rids[i].page_number : file.getNumPages() + 5;
+				PageTransfer transfer = {pageNo, &readBack[i], -1, false};
+				reads.push_back(transfer);
+			}
+			file.readPages(ring, reads);
+			mismatches = 0;
+			for (int i = 0; i < numPages; i++)
+			{
+				mismatches += !reads[i].valid || *(const int *)readBack[i].getRecord(rids[i]).data() != stamps[i];
+			}
+			checkPassFail(mismatches, 0)
+			checkPassFail(reads[numPages].valid, false)
+		}
+		File::remove(pagesName);
+	}
+}
+
+void memoryTrackerTests()
+{
+	std::cout << "Reserve and release memory against a budget" << std::endl;
+	{
+		MemoryTracker tracker(1000);
+		checkPassFail(tracker.tryReserve(MEMORY_SCANS, 600), true)
+		checkPassFail(tracker.tryReserve(MEMORY_DELTABUFFER, 500), false)
+		checkPassFail(tracker.bytesUsed(MEMORY_DELTABUFFER), 0)
+		checkPassFail(tracker.bytesUsed(), 600)
+		checkPassFail(tracker.tryReserve(MEMORY_DELTABUFFER, 400), true)
+		checkPassFail(tracker.bytesAvailable(), 0)
+		bool thrown = false;
+		try
+		{
+			tracker.reserve(MEMORY_SCANS, 1);
+		}
+		catch (const MemoryBudgetExceededException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		tracker.release(MEMORY_SCANS, 600);
+		tracker.release(MEMORY_DELTABUFFER, 400);
+		checkPassFail(tracker.bytesUsed(), 0)
+		checkPassFail(tracker.peakBytes(), 1000)
+	}
+
+	// a pool reserves its frames, descriptors and hash table when it is built and gives all of them back when it is
+	// destroyed, or when its constructor throws
+	MemoryTracker &memory = MemoryTracker::process();
+	const std::uint32_t frames = 64;
+	std::vector<std::size_t> before(NUMMEMORYCOMPONENTS);
+	for (int i = 0; i < NUMMEMORYCOMPONENTS; i++)
+	{
+		before[i] = memory.bytesUsed(MemoryComponent(i));
+	}
+	const std::size_t totalBefore = memory.bytesUsed();
+
+	std::cout << "Reserve the memory of a pool while it exists" << std::endl;
+	{
+		BufMgr pool(frames);
+		checkPassFail(memory.bytesUsed(MEMORY_BUFPOOL) - before[MEMORY_BUFPOOL], frames * sizeof(Page))
+		checkPassFail(memory.bytesUsed(MEMORY_BUFDESCTABLE) - before[MEMORY_BUFDESCTABLE], frames * sizeof(BufDesc))
+		checkPassFail(memory.bytesUsed() - totalBefore, BufMgr::bytesFor(frames))
+	}
+	for (int i = 0; i < NUMMEMORYCOMPONENTS; i++)
+	{
+		checkPassFail(memory.bytesUsed(MemoryComponent(i)), before[i])
+	}
+
+	std::cout << "Refuse a pool over the budget and take nothing" << std::endl;
+	memory.setBudget(totalBefore + BufMgr::bytesFor(frames) - 1);
+	{
+		bool thrown = false;
+		try
+		{
+			BufMgr pool(frames);
+		}
+		catch (const MemoryBudgetExceededException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		checkPassFail(memory.bytesUsed(), totalBefore)
+
+		// the largest pool that fits is one frame short
+		checkPassFail(BufMgr::framesWithin(memory.bytesAvailable()), frames - 1)
+		BufMgr pool(BufMgr::framesWithin(memory.bytesAvailable()));
+		checkPassFail((memory.bytesUsed() <= memory.budget()), true)
+	}
+	memory.setBudget(0);
+	checkPassFail(memory.bytesUsed(), totalBefore)
+
+	std::cout << "Release the memory of a pool whose constructor throws" << std::endl;
+	{
+		// the spill cache file is opened after the pool has reserved its memory
+		bool thrown = false;
+		try
+		{
+			BufMgr pool(frames, 0, "relA.missing/relA.spill", 16);
+		}
+		catch (const FileOpenException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+	}
+	for (int i = 0; i < NUMMEMORYCOMPONENTS; i++)
+	{
+		checkPassFail(memory.bytesUsed(MemoryComponent(i)), before[i])
+	}
+}
+
+int hashFind(HashIndex *index, int key, std::vector<RecordId> &rids)
+{
+	rids.clear();
+	try
+	{
+		index->find(&key, rids);
+	}
+	catch (const NoSuchKeyFoundException &e)
+	{
+		return 0;
+	}
+	return rids.size();
+}
+
+void batchTests()
+{
+	std::cout << "Create a B+ Tree index on the integer field, reading it in batches" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+
+	// [1000,3000] spans more than one batch of both sources
+	const Operator lowOps[] = {GT, GTE};
+	const Operator highOps[] = {LT, LTE};
+	for (int low = 0; low < 2; low++)
+	{
+		for (int high = 0; high < 2; high++)
+		{
+			checkPassFail(batchFileCount(1000, lowOps[low], 3000, highOps[high]),
+						  relationCount(1000, lowOps[low], 3000, highOps[high]))
+			checkPassFail(batchIndexCount(&index, 1000, lowOps[low], 3000, highOps[high]),
+						  intScan(&index, 1000, lowOps[low], 3000, highOps[high]))
+			checkPassFail(batchFileCount(25, lowOps[low], 40, highOps[high]),
+						  relationCount(25, lowOps[low], 40, highOps[high]))
+			checkPassFail(batchIndexCount(&index, 25, lowOps[low], 40, highOps[high]),
+						  intScan(&index, 25, lowOps[low], 40, highOps[high]))
+		}
+	}
+	checkPassFail(batchFileCount(-3, GT, 3, LT), relationCount(-3, GT, 3, LT))
+	checkPassFail(batchIndexCount(&index, -3, GT, 3, LT), intScan(&index, -3, GT, 3, LT))
+	checkPassFail(batchFileCount(0, GT, 1, LT), 0)
+	checkPassFail(batchIndexCount(&index, 0, GT, 1, LT), 0)
+}
+
+int batchFileCount(int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+	// every key from 0 to relationSize - 1 is in the relation once
+	long long sum = 0;
+	int count = 0, min = std::numeric_limits<int>::max(), max = std::numeric_limits<int>::min();
+	for (int key = 0; key < relationSize; key++)
+	{
+		if ((lowOp == GT ? key > lowVal : key >= lowVal) && (highOp == LT ? key < highVal : key <= highVal))
+		{
+			sum += key;
+			count++;
+			min = std::min(min, key);
+			max = std::max(max, key);
+		}
+	}
+
+	FileScanSource source(relationName, bufMgr, offsetof(tuple, i));
+	RecordBatch batch;
+	BatchAggregate aggregate;
+	while (source.nextBatch(batch) > 0)
+	{
+		filterBatch(batch, lowVal, lowOp, highVal, highOp);
+		aggregateBatch(batch, aggregate);
+	}
+	checkPassFail(aggregate.count, count)
+	checkPassFail(aggregate.sum, sum)
+	checkPassFail(aggregate.min, min)
+	checkPassFail(aggregate.max, max)
+	return aggregate.count;
+}
+
+int batchIndexCount(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+	// the keys come in order, each with the record id of a record holding it
+	IndexScanSource source(*index, &lowVal, lowOp, &highVal, highOp);
+	RecordBatch batch;
+	std::vector<RecordId> rids(BATCHSIZE);
+	std::vector<int> keys(BATCHSIZE);
+	int count = 0, mismatches = 0;
+	int previous = std::numeric_limits<int>::min();
+	while (source.nextBatch(batch) > 0)
+	{
+		int numRows = projectBatch(batch, &rids[0], &keys[0]);
+		for (int i = 0; i < numRows; i++)
+		{
+			Page *page;
+			bufMgr->readPage(file1, rids[i].page_number, page);
+			int key = reinterpret_cast<const RECORD *>(page->getRecord(rids[i]).data())->i;
+			bufMgr->unPinPage(file1, rids[i].page_number, false);
+			bool inRange = (lowOp == GT ? key > lowVal : key >= lowVal) && (highOp == LT ? key < highVal : key <= highVal);
+			mismatches += key != keys[i] || key < previous || !inRange;
+			previous = key;
+		}
+		count += numRows;
+	}
+	checkPassFail(mismatches, 0)
+	return count;
+}
+
+int relationCount(int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+	FileScan scanner(relationName, bufMgr);
+	RecordId scanRid;
+	std::size_t length;
+	int count = 0;
+	while (scanner.tryScanNext(scanRid))
+	{
+		int key = reinterpret_cast<const RECORD *>(scanner.getRecordData(length))->i;
+		if ((lowOp == GT ? key > lowVal : key >= lowVal) && (highOp == LT ? key < highVal : key <= highVal))
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
 int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp)
 {
 	RecordId scanRid;
@@ -754,6 +1938,34 @@ void errorTests()
 			std::cout << "BadOpcodesException Test 2 Passed." << std::endl;
 		}
 
+		std::cout << "Filter a batch with bad lowOp" << std::endl;
+		try
+		{
+			RecordBatch batch;
+			batch.numRows = 0;
+			batch.selectAll();
+			filterBatch(batch, int2, LT, int5, LTE);
+			std::cout << "BadOpcodesException Test 3 Failed." << std::endl;
+		}
+		catch (const BadOpcodesException &e)
+		{
+			std::cout << "BadOpcodesException Test 3 Passed." << std::endl;
+		}
+
+		std::cout << "Filter a batch with bad highOp" << std::endl;
+		try
+		{
+			RecordBatch batch;
+			batch.numRows = 0;
+			batch.selectAll();
+			filterBatch(batch, int2, GTE, int5, GT);
+			std::cout << "BadOpcodesException Test 4 Failed." << std::endl;
+		}
+		catch (const BadOpcodesException &e)
+		{
+			std::cout << "BadOpcodesException Test 4 Passed." << std::endl;
+		}
+
 		std::cout << "Scan with bad range" << std::endl;
 		try
 		{
@@ -765,6 +1977,105 @@ void errorTests()
 			std::cout << "BadScanrangeException Test 1 Passed." << std::endl;
 		}
 
+		std::cout << "Build a learned index with a negative model error" << std::endl;
+		try
+		{
+			StaticIndex learned(relationName, staticIndexName, bufMgr, offsetof(tuple, i), INTEGER, -1);
+			std::cout << "BadIndexInfoException Test 2 Failed." << std::endl;
+		}
+		catch (const BadIndexInfoException &e)
+		{
+			std::cout << "BadIndexInfoException Test 2 Passed." << std::endl;
+		}
+
+		std::cout << "Reopen the index with a different attribute type" << std::endl;
+		try
+		{
+			BTreeIndex other(relationName, intIndexName, bufMgr, offsetof(tuple, i), DOUBLE);
+			std::cout << "BadIndexInfoException Test 1 Failed." << std::endl;
+		}
+		catch (const BadIndexInfoException &e)
+		{
+			std::cout << "BadIndexInfoException Test 1 Passed." << std::endl;
+		}
+
+		//the records end before an int at this offset
+		const int pastRecordOffset = sizeof(tuple) - 2;
+		std::cout << "Build an index on an attribute past the end of the records" << std::endl;
+		std::string shortIndexName;
+		try
+		{
+			BTreeIndex other(relationName, shortIndexName, bufMgr, pastRecordOffset, INTEGER);
+			std::cout << "InvalidRecordException Test 1 Failed." << std::endl;
+		}
+		catch (const InvalidRecordException &e)
+		{
+			checkPassFail(File::exists(shortIndexName), false);
+			std::cout << "InvalidRecordException Test 1 Passed." << std::endl;
+		}
+
+		std::cout << "Build an index on an attribute past the end of the records, scanning in parallel" << std::endl;
+		try
+		{
+			TaskScheduler scheduler(2);
+			BTreeIndex other(relationName, shortIndexName, bufMgr, pastRecordOffset, INTEGER, FLAT_LAYOUT, &scheduler);
+			std::cout << "InvalidRecordException Test 2 Failed." << std::endl;
+		}
+		catch (const InvalidRecordException &e)
+		{
+			checkPassFail(File::exists(shortIndexName), false);
+			std::cout << "InvalidRecordException Test 2 Passed." << std::endl;
+		}
+
+		std::cout << "Read batches of an attribute past the end of the records" << std::endl;
+		try
+		{
+			FileScanSource source(relationName, bufMgr, pastRecordOffset);
+			RecordBatch batch;
+			source.nextBatch(batch);
+			std::cout << "InvalidRecordException Test 3 Failed." << std::endl;
+		}
+		catch (const InvalidRecordException &e)
+		{
+			std::cout << "InvalidRecordException Test 3 Passed." << std::endl;
+		}
+
+		std::cout << "Build a hash index on an attribute past the end of the records" << std::endl;
+		try
+		{
+			HashIndex other(relationName, shortIndexName, bufMgr, pastRecordOffset, INTEGER);
+			std::cout << "InvalidRecordException Test 4 Failed." << std::endl;
+		}
+		catch (const InvalidRecordException &e)
+		{
+			checkPassFail(File::exists(shortIndexName), false);
+			std::cout << "InvalidRecordException Test 4 Passed." << std::endl;
+		}
+
+		std::cout << "Build a bitmap index on an attribute past the end of the records" << std::endl;
+		try
+		{
+			BitmapIndex other(relationName, shortIndexName, bufMgr, pastRecordOffset, INTEGER);
+			std::cout << "InvalidRecordException Test 5 Failed." << std::endl;
+		}
+		catch (const InvalidRecordException &e)
+		{
+			checkPassFail(File::exists(shortIndexName), false);
+			std::cout << "InvalidRecordException Test 5 Passed." << std::endl;
+		}
+
+		std::cout << "Build a static index on an attribute past the end of the records" << std::endl;
+		try
+		{
+			StaticIndex other(relationName, shortIndexName, bufMgr, pastRecordOffset, INTEGER);
+			std::cout << "InvalidRecordException Test 6 Failed." << std::endl;
+		}
+		catch (const InvalidRecordException &e)
+		{
+			checkPassFail(File::exists(shortIndexName), false);
+			std::cout << "InvalidRecordException Test 6 Passed." << std::endl;
+		}
+
 		deleteRelation();
 	}
 
@@ -777,6 +2088,17 @@ void errorTests()
 	}
 }
 
+void deleteIndex(const std::string &indexName)
+{
+	try
+	{
+		File::remove(indexName);
+	}
+	catch (const FileNotFoundException &e)
+	{
+	}
+}
+
 void deleteRelation()
 {
 	if (file1)
@@ -0,0 +1,111 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <iostream>
+#include <limits>
+#include "memory_tracker.h"
+#include "exceptions/memory_budget_exceeded_exception.h"
+
+namespace badgerdb {
+
+MemoryTracker::MemoryTracker(const std::size_t budget)
+  : totalBytes(0), peak(0), limit(budget)
+{
+  for (int i = 0; i < NUMMEMORYCOMPONENTS; i++)
+  {
+    componentBytes[i].store(0);
+  }
+}
+
+MemoryTracker& MemoryTracker::process()
+{
+  static MemoryTracker tracker;
+  return tracker;
+}
+
+bool MemoryTracker::tryReserve(const MemoryComponent component, const std::size_t bytes)
+{
+  std::size_t total = totalBytes.load(std::memory_order_relaxed);
+  std::size_t newTotal;
+  do
+  {
+    std::size_t budget = limit.load(std::memory_order_relaxed);
+    newTotal = total + bytes;
+    if (budget > 0 && newTotal > budget)
+    {
+      return false;
+    }
+  } while (!totalBytes.compare_exchange_weak(total, newTotal, std::memory_order_relaxed));
+  componentBytes[component].fetch_add(bytes, std::memory_order_relaxed);
+  raisePeak(newTotal);
+  return true;
+}
+
+void MemoryTracker::reserve(const MemoryComponent component, const std::size_t bytes)
+{
+  if (!tryReserve(component, bytes))
+  {
+    throw MemoryBudgetExceededException(componentName(component), bytes, budget());
+  }
+}
+
+void MemoryTracker::charge(const MemoryComponent component, const std::size_t bytes)
+{
+  componentBytes[component].fetch_add(bytes, std::memory_order_relaxed);
+  raisePeak(totalBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+void MemoryTracker::release(const MemoryComponent component, const std::size_t bytes)
+{
+  componentBytes[component].fetch_sub(bytes, std::memory_order_relaxed);
+  totalBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+std::size_t MemoryTracker::bytesAvailable() const
+{
+  std::size_t budget = limit.load();
+  std::size_t total = totalBytes.load();
+  if (budget == 0)
+  {
+    return std::numeric_limits<std::size_t>::max();
+  }
+  return total < budget ? budget - total : 0;
+}
+
+void MemoryTracker::raisePeak(const std::size_t total)
+{
+  std::size_t highest = peak.load(std::memory_order_relaxed);
+  while (total > highest && !peak.compare_exchange_weak(highest, total, std::memory_order_relaxed))
+  {
+  }
+}
+
+const char* MemoryTracker::componentName(const MemoryComponent component)
+{
+  static const char* names[NUMMEMORYCOMPONENTS] = {"bufPool", "bufDescTable", "hashTable", "victimCache",
+                                                   "spillQueue", "deltaBuffer", "scans"};
+  return names[component];
+}
+
+void MemoryTracker::printSelf() const
+{
+  for (int i = 0; i < NUMMEMORYCOMPONENTS; i++)
+  {
+    std::cout << componentName(MemoryComponent(i)) << ": " << bytesUsed(MemoryComponent(i)) << " bytes\n";
+  }
+  std::cout << "Total: " << bytesUsed() << " bytes, peak " << peakBytes() << " bytes, budget ";
+  if (budget() > 0)
+  {
+    std::cout << budget() << " bytes\n";
+  }
+  else
+  {
+    std::cout << "none\n";
+  }
+}
+
+}
@@ -0,0 +1,167 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * @brief Parts of the library whose memory a MemoryTracker accounts for.
+ */
+enum MemoryComponent
+{
+  MEMORY_BUFPOOL = 0,       // frames of the buffer pools
+  MEMORY_BUFDESCTABLE = 1,  // frame descriptors of the buffer pools
+  MEMORY_HASHTABLE = 2,     // directories and entries of the BufHashTbl of every pool
+  MEMORY_VICTIMCACHE = 3,   // compressed images of evicted pages
+  MEMORY_SPILLQUEUE = 4,    // evicted pages waiting to be written to a spill cache file
+  MEMORY_DELTABUFFER = 5,   // inserts held in the delta buffers of BTreeIndex
+  MEMORY_SCANS = 6          // entries gathered by the relation scans building an index
+};
+
+/**
+ * @brief Number of MemoryComponents.
+ */
+const int NUMMEMORYCOMPONENTS = 7;
+
+/**
+* @brief Accounts for the memory the library holds, by component, against an optional budget for the whole process.
+* The buffer pools reserve their frames, descriptors and hash tables when they are built, and throw if that takes
+* the process over the budget; size them with BufMgr::framesWithin to fit. The caches reserve memory as they fill and
+* drop what they hold, or take no more, once the budget is reached. Hash table entries beyond the slab of a table are
+* charged without a check, as they are few.
+*
+* Memory is counted, not allocated: the figures are the sizes of the objects held, without allocator overhead.
+* All calls are thread safe and lock free.
+*/
+class MemoryTracker
+{
+ private:
+	/**
+	 * Bytes held by each component, and by all of them
+	 */
+  std::atomic<std::size_t> componentBytes[NUMMEMORYCOMPONENTS];
+  std::atomic<std::size_t> totalBytes;
+
+	/**
+	 * Most bytes held at once
+	 */
+  std::atomic<std::size_t> peak;
+
+	/**
+	 * Budget in bytes, 0 for none
+	 */
+  std::atomic<std::size_t> limit;
+
+	/**
+	 * Raise the peak to the given total if above it
+	 */
+  void raisePeak(const std::size_t total);
+
+ public:
+	/**
+   * Constructor of MemoryTracker class
+	 *
+	 * @param budget		Budget in bytes, 0 for none
+	 */
+  explicit MemoryTracker(const std::size_t budget = 0);
+
+  MemoryTracker(const MemoryTracker&) = delete;
+  MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+	/**
+	 * The tracker of the process, which every component of the library reports to
+	 */
+  static MemoryTracker& process();
+
+	/**
+	 * Set the budget. Memory already held above a lower budget is not taken back; further reservations fail until
+	 * enough of it is released.
+	 *
+	 * @param bytes			Budget in bytes, 0 for none
+	 */
+  void setBudget(const std::size_t bytes) { limit.store(bytes); }
+
+	/**
+   * Budget in bytes, 0 for none
+	 */
+  std::size_t budget() const { return limit.load(); }
+
+	/**
+	 * Account for memory taken by a component if it fits in the budget.
+	 *
+	 * @param component		Component taking the memory
+	 * @param bytes				Number of bytes
+	 * @return false, accounting for nothing, if the memory does not fit in the budget
+	 */
+  bool tryReserve(const MemoryComponent component, const std::size_t bytes);
+
+	/**
+	 * Account for memory taken by a component, which must fit in the budget.
+	 *
+	 * @param component		Component taking the memory
+	 * @param bytes				Number of bytes
+	 * @throws MemoryBudgetExceededException If the memory does not fit in the budget
+	 */
+  void reserve(const MemoryComponent component, const std::size_t bytes);
+
+	/**
+	 * Account for memory taken by a component, whether or not it fits in the budget.
+	 *
+	 * @param component		Component taking the memory
+	 * @param bytes				Number of bytes
+	 */
+  void charge(const MemoryComponent component, const std::size_t bytes);
+
+	/**
+	 * Account for memory given back by a component.
+	 *
+	 * @param component		Component giving the memory back
+	 * @param bytes				Number of bytes, at most what the component holds
+	 */
+  void release(const MemoryComponent component, const std::size_t bytes);
+
+	/**
+   * Bytes held by a component
+	 */
+  std::size_t bytesUsed(const MemoryComponent component) const { return componentBytes[component].load(); }
+
+	/**
+   * Bytes held by all components
+	 */
+  std::size_t bytesUsed() const { return totalBytes.load(); }
+
+	/**
+   * Bytes left in the budget, the largest std::size_t if there is none
+	 */
+  std::size_t bytesAvailable() const;
+
+	/**
+   * Most bytes held at once since the tracker was created or the peak was last reset
+	 */
+  std::size_t peakBytes() const { return peak.load(); }
+
+	/**
+   * Reset the peak to the bytes held now
+	 */
+  void resetPeak() { peak.store(totalBytes.load()); }
+
+	/**
+	 * Name of a component, e.g. "bufPool"
+	 */
+  static const char* componentName(const MemoryComponent component);
+
+	/**
+   * Print the bytes held by every component, the total, the peak and the budget.
+	 */
+  void printSelf() const;
+};
+
+}
@@ -0,0 +1,172 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "miss_ratio_curve.h"
+
+namespace badgerdb {
+
+/**
+ * Number of histogram buckets per pool size.
+ */
+static const std::uint32_t BUCKETSPERPOOL = 64;
+
+MissRatioCurve::MissRatioCurve(const std::uint32_t frames, const double samplingRate, const std::size_t maxPages)
+  : poolFrames(std::max<std::uint32_t>(1, frames)), bucketFrames(std::max<std::uint32_t>(1, frames / BUCKETSPERPOOL)),
+    maxSampledPages(std::max<std::size_t>(1, maxPages)), clock(0), sampledReads(0)
+{
+  double rate = std::min(1.0, std::max(0.0, samplingRate));
+  threshold = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(rate * 4294967296.0));
+  // the logical time wraps around through compact() every few times maxSampledPages reads
+  lastReads.assign(4 * maxSampledPages + 64, 0);
+  histogram.assign((std::uint64_t(MRCMAXSCALE) * poolFrames + bucketFrames - 1) / bucketFrames, 0);
+}
+
+void MissRatioCurve::updateLastReads(std::uint64_t time, const int delta)
+{
+  for (std::uint64_t i = time + 1; i <= lastReads.size(); i += i & (~i + 1))
+  {
+    lastReads[i - 1] += delta;
+  }
+}
+
+std::uint64_t MissRatioCurve::readsUpTo(std::uint64_t time) const
+{
+  std::uint64_t sum = 0;
+  for (std::uint64_t i = time + 1; i > 0; i -= i & (~i + 1))
+  {
+    sum += lastReads[i - 1];
+  }
+  return sum;
+}
+
+void MissRatioCurve::compact()
+{
+  std::vector<std::pair<std::uint64_t, SampledPage*> > order;
+  order.reserve(pages.size());
+  for (std::unordered_map<PageKey, SampledPage, PageKeyHash>::iterator it = pages.begin(); it != pages.end(); ++it)
+  {
+    order.push_back(std::make_pair(it->second.lastRead, &it->second));
+  }
+  std::sort(order.begin(), order.end());
+  std::fill(lastReads.begin(), lastReads.end(), 0);
+  for (std::size_t i = 0; i < order.size(); i++)
+  {
+    order[i].second->lastRead = i;
+    updateLastReads(i, 1);
+  }
+  clock = order.size();
+}
+
+void MissRatioCurve::drop(std::unordered_map<PageKey, SampledPage, PageKeyHash>::iterator page)
+{
+  updateLastReads(page->second.lastRead, -1);
+  pagesByHash.erase(std::make_pair(page->second.hash, page->first));
+  pages.erase(page);
+}
+
+void MissRatioCurve::referenceSampled(const File* file, const PageId pageNo, const std::uint32_t hash)
+{
+  double rate = samplingRate();
+  PageKey key(file, pageNo);
+  std::unordered_map<PageKey, SampledPage, PageKeyHash>::iterator page = pages.find(key);
+  if (page != pages.end())
+  {
+    // sampled pages read since the previous read of this one, scaled up to all pages
+    std::uint64_t distance = pages.size() - readsUpTo(page->second.lastRead);
+    std::uint64_t bucket = static_cast<std::uint64_t>(distance / rate) / bucketFrames;
+    if (bucket < histogram.size())
+    {
+      histogram[bucket] += 1;
+    }
+    updateLastReads(page->second.lastRead, -1);
+    page->second.lastRead = clock;
+  }
+  else
+  {
+    SampledPage sampled = {hash, clock};
+    pages.insert(std::make_pair(key, sampled));
+    pagesByHash.insert(std::make_pair(hash, key));
+  }
+  updateLastReads(clock, 1);
+  clock++;
+  sampledReads += 1;
+  if (clock == lastReads.size())
+  {
+    compact();
+  }
+
+  // lower the threshold to the largest hash sampled, dropping the pages at or above it, and scale the reads counted
+  // so far down to the new rate
+  if (pages.size() > maxSampledPages)
+  {
+    std::uint64_t oldThreshold = threshold;
+    threshold = pagesByHash.rbegin()->first;
+    while (!pagesByHash.empty() && pagesByHash.rbegin()->first >= threshold)
+    {
+      drop(pages.find(pagesByHash.rbegin()->second));
+    }
+    double scale = static_cast<double>(threshold) / oldThreshold;
+    for (std::size_t i = 0; i < histogram.size(); i++)
+    {
+      histogram[i] *= scale;
+    }
+    sampledReads *= scale;
+  }
+}
+
+void MissRatioCurve::remove(const File* file, const PageId pageNo)
+{
+  std::unordered_map<PageKey, SampledPage, PageKeyHash>::iterator page = pages.find(PageKey(file, pageNo));
+  if (page != pages.end())
+  {
+    drop(page);
+  }
+}
+
+void MissRatioCurve::removeFile(const File* file)
+{
+  std::unordered_map<PageKey, SampledPage, PageKeyHash>::iterator page = pages.begin();
+  while (page != pages.end())
+  {
+    std::unordered_map<PageKey, SampledPage, PageKeyHash>::iterator next = page;
+    ++next;
+    if (page->first.first == file)
+    {
+      drop(page);
+    }
+    page = next;
+  }
+}
+
+double MissRatioCurve::hitRatio(const std::uint64_t frames) const
+{
+  if (sampledReads == 0)
+  {
+    return 0;
+  }
+  std::uint64_t buckets = std::min<std::uint64_t>(frames / bucketFrames, histogram.size());
+  double hits = 0;
+  for (std::uint64_t i = 0; i < buckets; i++)
+  {
+    hits += histogram[i];
+  }
+  if (buckets < histogram.size())
+  {
+    // the distances are taken as spread evenly over the bucket the size falls into
+    hits += histogram[buckets] * (frames % bucketFrames) / bucketFrames;
+  }
+  return hits / sampledReads;
+}
+
+void MissRatioCurve::clear()
+{
+  std::fill(histogram.begin(), histogram.end(), 0);
+  sampledReads = 0;
+}
+
+}
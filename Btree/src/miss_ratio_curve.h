@@ -0,0 +1,230 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "types.h"
+
+namespace badgerdb {
+
+class File;
+
+/**
+ * @brief Default fraction of the pages whose reuse distances a MissRatioCurve tracks.
+ */
+const double MRCSAMPLINGRATE = 0.01;
+
+/**
+ * @brief Default largest number of pages a MissRatioCurve tracks at once.
+ */
+const std::size_t MRCSAMPLEDPAGES = 8192;
+
+/**
+ * @brief Largest pool size, in multiples of the actual pool, a MissRatioCurve estimates the hit ratio for.
+ */
+const std::uint32_t MRCMAXSCALE = 4;
+
+/**
+* @brief Online estimate of the hit ratio of page reads as a function of the pool size, following SHARDS
+* (Waldspurger et al., FAST 2015).
+* A page is sampled if a hash of its file and page number falls below a threshold, so a fixed subset of the pages is
+* tracked and the others cost one hash per read. For every read of a sampled page, the number of distinct sampled
+* pages read since its previous read, scaled up by the sampling rate, estimates its LRU stack distance: the read hits
+* in any LRU pool of more frames than that. The distances go to a histogram, weighted by the inverse of the sampling
+* rate at the time.
+*
+* Once more pages are sampled than the limit, the threshold is lowered to the largest hash among them, and the pages
+* at or above it are dropped, so memory stays bounded whatever the working set. The histogram counts reads at the
+* current sampling rate: when the rate drops, the counts so far are scaled down by the same factor, so that reads
+* before and after weigh alike, as in the fixed-size SHARDS.
+*
+* The curve is that of an LRU pool, as stack distances only exist for stack algorithms, and BufMgr uses the clock,
+* which only approximates LRU: a clock pool can hit less than the curve says, e.g. when a scan sweeps away pages whose
+* refbit the clock hand had just cleared, or more, when pages the clock keeps by their refbit would have aged out of
+* LRU. The reads BufMgr serves by optimistic reads are not accounted for.
+*
+* @warning This class is not threadsafe; BufMgr only uses it under its latch.
+*/
+class MissRatioCurve
+{
+ private:
+	/**
+	 * Key of a sampled page: its file and page number
+	 */
+  typedef std::pair<const File*, PageId> PageKey;
+
+	/**
+	 * Hash of a PageKey, as in BufHashTbl
+	 */
+  struct PageKeyHash
+  {
+    std::size_t operator()(const PageKey& key) const
+    {
+      return std::hash<const File*>()(key.first) ^ (std::hash<PageId>()(key.second) * 0x9e3779b9u);
+    }
+  };
+
+	/**
+	 * A sampled page: its sampling hash and the logical time of its last read
+	 */
+  struct SampledPage
+  {
+    std::uint32_t hash;
+    std::uint64_t lastRead;
+  };
+
+	/**
+	 * Number of frames of the pool the curve is estimated for, and the width of a histogram bucket in frames
+	 */
+  std::uint32_t poolFrames;
+  std::uint32_t bucketFrames;
+
+	/**
+	 * Limit on the number of sampled pages
+	 */
+  std::size_t maxSampledPages;
+
+	/**
+	 * Pages are sampled if their hash is below the threshold; the sampling rate is the threshold over 2^32
+	 */
+  std::uint64_t threshold;
+
+	/**
+	 * Pages sampled, and the same ordered by hash, to find the ones to drop when the threshold is lowered
+	 */
+  std::unordered_map<PageKey, SampledPage, PageKeyHash> pages;
+  std::set<std::pair<std::uint32_t, PageKey> > pagesByHash;
+
+	/**
+	 * Fenwick tree over logical times with a 1 at the last read of every sampled page, so that the number of pages
+	 * read since a given time is a prefix sum
+	 */
+  std::vector<std::uint32_t> lastReads;
+
+	/**
+	 * Logical time of the next read of a sampled page
+	 */
+  std::uint64_t clock;
+
+	/**
+	 * Reads by stack distance in buckets of bucketFrames, and all reads, first reads included, counted at the current
+	 * sampling rate
+	 */
+  std::vector<double> histogram;
+  double sampledReads;
+
+	/**
+	 * Add delta at a logical time of the Fenwick tree
+	 */
+  void updateLastReads(std::uint64_t time, const int delta);
+
+	/**
+	 * Number of sampled pages last read at or before a logical time
+	 */
+  std::uint64_t readsUpTo(std::uint64_t time) const;
+
+	/**
+	 * Renumber the last reads 0, 1, ... in order, once the logical time reaches the end of the Fenwick tree
+	 */
+  void compact();
+
+	/**
+	 * Stop tracking a sampled page.
+	 */
+  void drop(std::unordered_map<PageKey, SampledPage, PageKeyHash>::iterator page);
+
+ public:
+	/**
+   * Constructor of MissRatioCurve class
+	 *
+	 * @param frames					Number of frames of the buffer pool
+	 * @param samplingRate		Initial fraction of the pages sampled, in (0, 1]
+	 * @param maxPages				Largest number of pages sampled at once
+	 */
+  MissRatioCurve(const std::uint32_t frames, const double samplingRate = MRCSAMPLINGRATE,
+                 const std::size_t maxPages = MRCSAMPLEDPAGES);
+
+	/**
+	 * Hash deciding whether a page is sampled, uniform over the pages whatever their numbering. Depends on nothing
+	 * but the page, so that callers can compute it before taking the latch the curve is used under.
+	 */
+  static std::uint32_t sampleHash(const File* file, const PageId pageNo)
+  {
+    std::uint64_t hash = (reinterpret_cast<std::uintptr_t>(file) ^ (std::uint64_t(pageNo) << 32)) + pageNo;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    return static_cast<std::uint32_t>((hash ^ (hash >> 31)) >> 32);
+  }
+
+	/**
+	 * Account for a read of a page.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param hash		sampleHash of the page
+	 */
+  void reference(const File* file, const PageId pageNo, const std::uint32_t hash)
+  {
+    // the common case of a page not sampled stays inline, touching nothing but the threshold
+    if (hash < threshold)
+    {
+      referenceSampled(file, pageNo, hash);
+    }
+  }
+
+	/**
+	 * Account for a read of a sampled page.
+	 */
+  void referenceSampled(const File* file, const PageId pageNo, const std::uint32_t hash);
+
+	/**
+	 * Forget a page deleted from its file.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  void remove(const File* file, const PageId pageNo);
+
+	/**
+	 * Forget every page of a file, as its File object may be reused for another file.
+	 *
+	 * @param file   	File object
+	 */
+  void removeFile(const File* file);
+
+	/**
+	 * Estimated hit ratio of the reads so far in an LRU pool of the given number of frames, 0 before any sampled read.
+	 * Sizes beyond MRCMAXSCALE times the pool are estimated as that size.
+	 *
+	 * @param frames		Number of frames of the pool
+	 */
+  double hitRatio(const std::uint64_t frames) const;
+
+	/**
+	 * Clear the histogram, keeping the pages sampled and their last reads.
+	 */
+  void clear();
+
+	/**
+   * Current fraction of the pages sampled
+	 */
+  double samplingRate() const { return threshold / 4294967296.0; }
+
+	/**
+   * Number of pages currently sampled
+	 */
+  std::size_t numSampledPages() const { return pages.size(); }
+};
+
+}
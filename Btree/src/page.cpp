@@ -34,23 +34,41 @@ void Page::initialize() {
 }
 
 RecordId Page::insertRecord(const std::string& record_data) {
-  if (!hasSpaceForRecord(record_data)) {
+  RecordId record_id;
+  if (!tryInsertRecord(record_data, record_id)) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), getFreeSpace());
   }
+  return record_id;
+}
+
+bool Page::tryInsertRecord(const std::string& record_data,
+                           RecordId& record_id) {
+  if (!hasSpaceForRecord(record_data)) {
+    return false;
+  }
   const SlotId slot_number = getAvailableSlot();
   insertRecordInSlot(slot_number, record_data);
-  return {page_number(), slot_number};
+  record_id = {page_number(), slot_number};
+  return true;
 }
 
 std::string Page::getRecord(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-	std::string retStr = std::string(data_, DATA_SIZE).substr(slot.item_offset, slot.item_length);
+	std::string retStr = std::string(data_ + slot.item_offset, slot.item_length);
 
 	return retStr;
 }
 
+const char* Page::getRecordData(const RecordId& record_id,
+                                std::size_t& length) const {
+  validateRecordId(record_id);
+  const PageSlot& slot = getSlot(record_id.slot_number);
+  length = slot.item_length;
+  return data_ + slot.item_offset;
+}
+
 void Page::updateRecord(const RecordId& record_id,
                         const std::string& record_data) {
   validateRecordId(record_id);
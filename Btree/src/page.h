@@ -141,6 +141,16 @@ class Page {
    */
   RecordId insertRecord(const std::string& record_data);
 
+  /**
+   * Inserts a new record into the page if it fits.  Unlike insertRecord, a
+   * full page is reported through the return value rather than by throwing.
+   *
+   * @param record_data  Bytes that compose the record.
+   * @param record_id    ID of the newly inserted record, set only on success.
+   * @return  True if the record was inserted, false if the page lacks space.
+   */
+  bool tryInsertRecord(const std::string& record_data, RecordId& record_id);
+
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
    * stored on the page; use updateRecord to change it.
@@ -151,6 +161,17 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * Returns a pointer to the bytes of the record with the given ID, without
+   * copying them.  The pointer stays valid until the page is changed.
+   *
+   * @param record_id  ID of the record.
+   * @param length     Length of the record, returned via this reference.
+   * @return  Pointer to the first byte of the record.
+   */
+  const char* getRecordData(const RecordId& record_id,
+                            std::size_t& length) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
@@ -0,0 +1,184 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_codec.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace badgerdb {
+
+/**
+ * Number of bits of the hash of the 4 byte sequences looked up for copies.
+ */
+static const int HASHBITS = 12;
+
+/**
+ * Shortest copy encoded; shorter repeats are left as literals.
+ */
+static const std::size_t MINMATCH = 4;
+
+static inline std::uint32_t read32(const char* p)
+{
+  std::uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+/**
+ * Append a length field: the part not held in the token, as bytes of 255 followed by the remainder.
+ */
+static inline char* writeLength(char* op, std::size_t length)
+{
+  while (length >= 255)
+  {
+    *op++ = static_cast<char>(255);
+    length -= 255;
+  }
+  *op++ = static_cast<char>(length);
+  return op;
+}
+
+/**
+ * Read a length field continuing a token nibble of 15.
+ * @return False if the field runs past the end of the source
+ */
+static inline bool readLength(const unsigned char*& ip, const unsigned char* end, std::size_t& length)
+{
+  unsigned char byte;
+  do
+  {
+    if (ip >= end)
+    {
+      return false;
+    }
+    byte = *ip++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * Append a sequence: a token holding both lengths, the literals, and the copy distance and length if any.
+ */
+static char* writeSequence(char* op, const char* literals, const std::size_t numLiterals,
+                           const std::size_t distance, const std::size_t matchLength)
+{
+  char* token = op++;
+  std::size_t literalCode = numLiterals < 15 ? numLiterals : 15;
+  std::size_t matchCode = 0;
+  if (numLiterals >= 15)
+  {
+    op = writeLength(op, numLiterals - 15);
+  }
+  if (numLiterals > 0)
+  {
+    memcpy(op, literals, numLiterals);
+    op += numLiterals;
+  }
+  if (matchLength > 0)
+  {
+    *op++ = static_cast<char>(distance & 0xff);
+    *op++ = static_cast<char>(distance >> 8);
+    std::size_t extra = matchLength - MINMATCH;
+    matchCode = extra < 15 ? extra : 15;
+    if (extra >= 15)
+    {
+      op = writeLength(op, extra - 15);
+    }
+  }
+  *token = static_cast<char>((literalCode << 4) | matchCode);
+  return op;
+}
+
+std::size_t compressPage(const char* source, const std::size_t length, char* dest)
+{
+  // last position of each hashed sequence, plus one so that zero means none
+  std::uint16_t table[1 << HASHBITS];
+  memset(table, 0, sizeof(table));
+  char* op = dest;
+  std::size_t anchor = 0;
+  std::size_t ip = 0;
+  while (ip + MINMATCH <= length)
+  {
+    std::uint32_t sequence = read32(source + ip);
+    std::uint32_t hash = (sequence * 2654435761u) >> (32 - HASHBITS);
+    std::size_t candidate = table[hash];
+    table[hash] = static_cast<std::uint16_t>(ip + 1);
+    if (candidate == 0 || read32(source + candidate - 1) != sequence)
+    {
+      ip++;
+      continue;
+    }
+    std::size_t ref = candidate - 1;
+    std::size_t matchLength = MINMATCH;
+    while (ip + matchLength < length && source[ref + matchLength] == source[ip + matchLength])
+    {
+      matchLength++;
+    }
+    op = writeSequence(op, source + anchor, ip - anchor, ip - ref, matchLength);
+    ip += matchLength;
+    anchor = ip;
+  }
+  // the last sequence holds only literals
+  op = writeSequence(op, source + anchor, length - anchor, 0, 0);
+  return op - dest;
+}
+
+bool decompressPage(const char* source, const std::size_t sourceLength, char* dest, const std::size_t length)
+{
+  const unsigned char* ip = reinterpret_cast<const unsigned char*>(source);
+  const unsigned char* end = ip + sourceLength;
+  std::size_t op = 0;
+  while (ip < end)
+  {
+    unsigned char token = *ip++;
+    std::size_t numLiterals = token >> 4;
+    if (numLiterals == 15 && !readLength(ip, end, numLiterals))
+    {
+      return false;
+    }
+    if (numLiterals > static_cast<std::size_t>(end - ip) || numLiterals > length - op)
+    {
+      return false;
+    }
+    if (numLiterals > 0)
+    {
+      memcpy(dest + op, ip, numLiterals);
+    }
+    ip += numLiterals;
+    op += numLiterals;
+    if (ip == end)
+    {
+      break;
+    }
+    if (end - ip < 2)
+    {
+      return false;
+    }
+    std::size_t distance = ip[0] | (ip[1] << 8);
+    ip += 2;
+    std::size_t matchLength = token & 15;
+    if (matchLength == 15 && !readLength(ip, end, matchLength))
+    {
+      return false;
+    }
+    matchLength += MINMATCH;
+    if (distance == 0 || distance > op || matchLength > length - op)
+    {
+      return false;
+    }
+    // byte by byte, since a copy may overlap its own output
+    for (std::size_t i = 0; i < matchLength; i++, op++)
+    {
+      dest[op] = dest[op - distance];
+    }
+  }
+  return op == length;
+}
+
+}
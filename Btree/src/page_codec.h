@@ -0,0 +1,44 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * Largest size compressPage can produce for a source of the given length.
+ * @param length		Length of the source in bytes
+ */
+constexpr std::size_t compressBound(const std::size_t length)
+{
+  return length + length / 255 + 16;
+}
+
+/**
+ * Compress a page image with a byte oriented LZ77 codec in the style of LZ4's block format: a sequence of
+ * literal runs, each followed by a copy of earlier output given by a 16 bit distance and a length. Runs of
+ * free space compress to a few bytes as copies from one byte back.
+ * @param source		Bytes to compress
+ * @param length		Length of source, less than 64 KB
+ * @param dest			Receives the compressed bytes, of capacity compressBound(length)
+ * @return Length of the compressed bytes
+ */
+std::size_t compressPage(const char* source, const std::size_t length, char* dest);
+
+/**
+ * Decompress bytes produced by compressPage.
+ * @param source					Compressed bytes
+ * @param sourceLength		Length of source
+ * @param dest						Receives the decompressed bytes
+ * @param length					Length the bytes decompress to
+ * @return False if source is corrupt or does not decompress to exactly length bytes
+ */
+bool decompressPage(const char* source, const std::size_t sourceLength, char* dest, const std::size_t length);
+
+}
@@ -0,0 +1,426 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+#include "pool_model.h"
+
+namespace badgerdb {
+
+// -----------------------------------------------------------------------------
+// Policy models
+// -----------------------------------------------------------------------------
+
+/**
+ * The clock of BufMgr::allocBuf: the hand advances to the next frame, and a frame is taken if it is free or its
+ * reference bit is clear; a set reference bit is cleared and the hand moves on.
+ */
+class ClockModel : public PoolModel
+{
+	struct Frame
+	{
+		TracePageKey key;
+		bool valid;
+		bool refbit;
+	};
+
+	std::vector<Frame> frames;
+	std::unordered_map<TracePageKey, std::size_t> frameOf;
+	std::size_t clockHand;
+
+ public:
+	explicit ClockModel(const std::size_t numFrames)
+		: frames(numFrames), clockHand(numFrames - 1)
+	{
+		for (std::size_t i = 0; i < numFrames; i++)
+		{
+			frames[i].valid = false;
+			frames[i].refbit = false;
+		}
+	}
+
+	bool reference(const TracePageKey key)
+	{
+		std::unordered_map<TracePageKey, std::size_t>::const_iterator it = frameOf.find(key);
+		if (it != frameOf.end())
+		{
+			frames[it->second].refbit = true;
+			return true;
+		}
+		while (true)
+		{
+			clockHand = (clockHand + 1) % frames.size();
+			Frame &frame = frames[clockHand];
+			if (!frame.valid)
+			{
+				break;
+			}
+			if (!frame.refbit)
+			{
+				frameOf.erase(frame.key);
+				break;
+			}
+			frame.refbit = false;
+		}
+		Frame &frame = frames[clockHand];
+		frame.key = key;
+		frame.valid = true;
+		frame.refbit = true;
+		frameOf[key] = clockHand;
+		return false;
+	}
+
+	void remove(const TracePageKey key)
+	{
+		std::unordered_map<TracePageKey, std::size_t>::iterator it = frameOf.find(key);
+		if (it != frameOf.end())
+		{
+			frames[it->second].valid = false;
+			frameOf.erase(it);
+		}
+	}
+
+	void residentPages(std::vector<TracePageKey> &pages) const
+	{
+		for (std::unordered_map<TracePageKey, std::size_t>::const_iterator it = frameOf.begin(); it != frameOf.end(); ++it)
+		{
+			pages.push_back(it->first);
+		}
+	}
+};
+
+/**
+ * List of pages, most recent first, with the position of every page in it.
+ */
+class RecencyList
+{
+	std::list<TracePageKey> pages;
+	std::unordered_map<TracePageKey, std::list<TracePageKey>::iterator> positions;
+
+ public:
+	std::size_t size() const { return pages.size(); }
+
+	bool contains(const TracePageKey key) const { return positions.count(key) != 0; }
+
+	void pushFront(const TracePageKey key)
+	{
+		pages.push_front(key);
+		positions[key] = pages.begin();
+	}
+
+	void moveToFront(const TracePageKey key)
+	{
+		pages.splice(pages.begin(), pages, positions[key]);
+	}
+
+	bool erase(const TracePageKey key)
+	{
+		std::unordered_map<TracePageKey, std::list<TracePageKey>::iterator>::iterator it = positions.find(key);
+		if (it == positions.end())
+		{
+			return false;
+		}
+		pages.erase(it->second);
+		positions.erase(it);
+		return true;
+	}
+
+	TracePageKey popBack()
+	{
+		TracePageKey key = pages.back();
+		positions.erase(key);
+		pages.pop_back();
+		return key;
+	}
+
+	void appendTo(std::vector<TracePageKey> &keys) const
+	{
+		keys.insert(keys.end(), pages.begin(), pages.end());
+	}
+};
+
+/**
+ * Least recently used.
+ */
+class LruModel : public PoolModel
+{
+	std::size_t numFrames;
+	RecencyList resident;
+
+ public:
+	explicit LruModel(const std::size_t frames) : numFrames(frames) {}
+
+	bool reference(const TracePageKey key)
+	{
+		if (resident.contains(key))
+		{
+			resident.moveToFront(key);
+			return true;
+		}
+		if (resident.size() >= numFrames)
+		{
+			resident.popBack();
+		}
+		resident.pushFront(key);
+		return false;
+	}
+
+	void remove(const TracePageKey key)
+	{
+		resident.erase(key);
+	}
+
+	void residentPages(std::vector<TracePageKey> &pages) const
+	{
+		resident.appendTo(pages);
+	}
+};
+
+/**
+ * Full 2Q (Johnson and Shasha): pages referenced once wait in the FIFO A1in, holding a quarter of the frames; the
+ * pages evicted from it are remembered in the ghost FIFO A1out, of half as many entries as frames. A page referenced
+ * again while in A1out goes to the LRU list Am, which holds the rest of the pool.
+ */
+class TwoQueueModel : public PoolModel
+{
+	std::size_t numFrames;
+	std::size_t maxIn;
+	std::size_t maxOut;
+	RecencyList in;
+	RecencyList out;
+	RecencyList main;
+
+	void reclaimFrame()
+	{
+		if (in.size() + main.size() < numFrames)
+		{
+			return;
+		}
+		if (in.size() > maxIn || main.size() == 0)
+		{
+			out.pushFront(in.popBack());
+			if (out.size() > maxOut)
+			{
+				out.popBack();
+			}
+		}
+		else
+		{
+			main.popBack();
+		}
+	}
+
+ public:
+	explicit TwoQueueModel(const std::size_t frames)
+		: numFrames(frames), maxIn(std::max<std::size_t>(1, frames / 4)), maxOut(std::max<std::size_t>(1, frames / 2))
+	{
+	}
+
+	bool reference(const TracePageKey key)
+	{
+		if (main.contains(key))
+		{
+			main.moveToFront(key);
+			return true;
+		}
+		if (in.contains(key))
+		{
+			return true;
+		}
+		reclaimFrame();
+		if (out.erase(key))
+		{
+			main.pushFront(key);
+		}
+		else
+		{
+			in.pushFront(key);
+		}
+		return false;
+	}
+
+	void remove(const TracePageKey key)
+	{
+		if (!main.erase(key))
+		{
+			in.erase(key);
+		}
+	}
+
+	void residentPages(std::vector<TracePageKey> &pages) const
+	{
+		in.appendTo(pages);
+		main.appendTo(pages);
+	}
+};
+
+/**
+ * ARC (Megiddo and Modha): T1 holds the pages referenced once recently and T2 those referenced again, with the ghost
+ * lists B1 and B2 of the pages evicted from each. The target size p of T1 grows on hits in B1 and shrinks on hits in
+ * B2. Since pages also leave the pool on dispose and flush, a page is only replaced while the pool is full.
+ */
+class ArcModel : public PoolModel
+{
+	std::size_t numFrames;
+	std::size_t target;
+	RecencyList t1;
+	RecencyList t2;
+	RecencyList b1;
+	RecencyList b2;
+
+	void replace(const bool inB2)
+	{
+		if (t1.size() + t2.size() < numFrames)
+		{
+			return;
+		}
+		if (t1.size() > 0 && (t1.size() > target || (inB2 && t1.size() == target) || t2.size() == 0))
+		{
+			b1.pushFront(t1.popBack());
+		}
+		else
+		{
+			b2.pushFront(t2.popBack());
+		}
+	}
+
+ public:
+	explicit ArcModel(const std::size_t frames) : numFrames(frames), target(0) {}
+
+	bool reference(const TracePageKey key)
+	{
+		if (t1.erase(key))
+		{
+			t2.pushFront(key);
+			return true;
+		}
+		if (t2.contains(key))
+		{
+			t2.moveToFront(key);
+			return true;
+		}
+		if (b1.contains(key))
+		{
+			target = std::min(numFrames, target + std::max<std::size_t>(1, b2.size() / b1.size()));
+			replace(false);
+			b1.erase(key);
+			t2.pushFront(key);
+			return false;
+		}
+		if (b2.contains(key))
+		{
+			std::size_t delta = std::max<std::size_t>(1, b1.size() / b2.size());
+			target = target > delta ? target - delta : 0;
+			replace(true);
+			b2.erase(key);
+			t2.pushFront(key);
+			return false;
+		}
+		if (t1.size() + b1.size() >= numFrames)
+		{
+			if (b1.size() > 0)
+			{
+				b1.popBack();
+				replace(false);
+			}
+			else
+			{
+				t1.popBack();
+			}
+		}
+		else
+		{
+			if (t1.size() + t2.size() + b1.size() + b2.size() >= 2 * numFrames && b2.size() > 0)
+			{
+				b2.popBack();
+			}
+			replace(false);
+		}
+		t1.pushFront(key);
+		return false;
+	}
+
+	void remove(const TracePageKey key)
+	{
+		if (!t1.erase(key))
+		{
+			t2.erase(key);
+		}
+	}
+
+	void residentPages(std::vector<TracePageKey> &pages) const
+	{
+		t1.appendTo(pages);
+		t2.appendTo(pages);
+	}
+};
+
+const char *policyNames[NUMPOLICIES] = {"CLOCK", "LRU", "2Q", "ARC"};
+
+PoolModel *makeModel(const int policy, const std::size_t frames)
+{
+	switch (policy)
+	{
+	case 0:
+		return new ClockModel(frames);
+	case 1:
+		return new LruModel(frames);
+	case 2:
+		return new TwoQueueModel(frames);
+	default:
+		return new ArcModel(frames);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// Replay
+// -----------------------------------------------------------------------------
+
+double replay(const std::vector<TraceRecord> &trace, PoolModel &model)
+{
+	std::uint64_t reads = 0;
+	std::uint64_t misses = 0;
+	std::vector<TracePageKey> resident;
+	for (std::size_t i = 0; i < trace.size(); i++)
+	{
+		const TraceRecord &record = trace[i];
+		switch (record.op)
+		{
+		case TRACE_READ:
+			reads++;
+			if (!model.reference(tracePageKey(record)))
+			{
+				misses++;
+			}
+			break;
+		case TRACE_ALLOC:
+		case TRACE_PREFETCH:
+			model.reference(tracePageKey(record));
+			break;
+		case TRACE_DISPOSE:
+			model.remove(tracePageKey(record));
+			break;
+		case TRACE_FLUSH:
+			resident.clear();
+			model.residentPages(resident);
+			for (std::size_t j = 0; j < resident.size(); j++)
+			{
+				if ((resident[j] >> 32) == record.fileId)
+				{
+					model.remove(resident[j]);
+				}
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return reads > 0 ? double(misses) / reads : 0;
+}
+
+}
@@ -0,0 +1,72 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "access_trace.h"
+
+namespace badgerdb {
+
+/**
+ * Page of a trace: file id in the high 32 bits, page number in the low ones.
+ */
+typedef std::uint64_t TracePageKey;
+
+inline TracePageKey tracePageKey(const TraceRecord &record)
+{
+	return (TracePageKey(record.fileId) << 32) | record.pageNo;
+}
+
+/**
+ * @brief A buffer pool of a fixed number of frames under one replacement policy, fed the accesses of a trace.
+ */
+class PoolModel
+{
+ public:
+	virtual ~PoolModel() {}
+
+	/**
+	 * Reference a page, bringing it into the pool if it is not resident.
+	 * @return True if the page was resident
+	 */
+	virtual bool reference(const TracePageKey key) = 0;
+
+	/**
+	 * Drop a page from the pool, if resident, without remembering it as evicted.
+	 */
+	virtual void remove(const TracePageKey key) = 0;
+
+	/**
+	 * Append the resident pages.
+	 */
+	virtual void residentPages(std::vector<TracePageKey> &pages) const = 0;
+};
+
+/**
+ * Number of policies modelled, and their names: CLOCK as in BufMgr::allocBuf, LRU, 2Q and ARC.
+ */
+const int NUMPOLICIES = 4;
+extern const char *policyNames[NUMPOLICIES];
+
+/**
+ * Create the model of a policy.
+ *
+ * @param policy		Index of the policy in policyNames
+ * @param frames		Number of frames of the pool
+ */
+PoolModel *makeModel(const int policy, const std::size_t frames);
+
+/**
+ * Replay a trace through a model and return its miss ratio over the page reads. Only page reads count as hits or
+ * misses; allocated and read-ahead pages enter the pool without counting, disposed pages and flushed files leave it.
+ */
+double replay(const std::vector<TraceRecord> &trace, PoolModel &model);
+
+}
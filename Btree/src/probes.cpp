@@ -0,0 +1,26 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "probes.h"
+
+#ifdef BADGERDB_PROBES
+// semaphores of the probes declared in probes.h, raised by tracers while attached
+#define BADGERDB_DEFINE_PROBE_SEMAPHORE(name) \
+  unsigned short badgerdb_##name##_semaphore __attribute__((section(".probes"))) = 0
+
+BADGERDB_DEFINE_PROBE_SEMAPHORE(page_hit);
+BADGERDB_DEFINE_PROBE_SEMAPHORE(page_miss);
+BADGERDB_DEFINE_PROBE_SEMAPHORE(page_evict);
+BADGERDB_DEFINE_PROBE_SEMAPHORE(page_writeback);
+BADGERDB_DEFINE_PROBE_SEMAPHORE(file_read);
+BADGERDB_DEFINE_PROBE_SEMAPHORE(file_write);
+BADGERDB_DEFINE_PROBE_SEMAPHORE(split_leaf);
+BADGERDB_DEFINE_PROBE_SEMAPHORE(split_nonleaf);
+BADGERDB_DEFINE_PROBE_SEMAPHORE(root_change);
+BADGERDB_DEFINE_PROBE_SEMAPHORE(scan_start);
+BADGERDB_DEFINE_PROBE_SEMAPHORE(scan_end);
+#endif
@@ -0,0 +1,73 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+/**
+ * Static tracepoints (USDT) of the provider "badgerdb", for bpftrace, perf or SystemTap to attach to in a running
+ * process, e.g. bpftrace -e 'usdt:./badgerdb_main:badgerdb:page_miss { @[str(arg0)] = count(); }'.
+ *
+ * Where <sys/sdt.h> is available (systemtap-sdt-dev or systemtap-sdt-devel), each probe compiles to a test of its
+ * semaphore, a single nop and a note in the binary. A tracer raises the semaphore and patches the nop into a breakpoint
+ * while attached, so the arguments, such as file names, are only evaluated then; otherwise a probe costs a load and a
+ * not taken branch. The semaphores are defined in probes.cpp. Elsewhere, or when built with -DBADGERDB_NO_PROBES,
+ * probes compile to nothing.
+ *
+ * Probes:
+ *   page_hit(file name, page number, frame)         BufMgr found a page read in the pool
+ *   page_miss(file name, page number, frame)        BufMgr read a page into a frame
+ *   page_evict(file name, page number, dirty)       BufMgr took the frame of a page for another one
+ *   page_writeback(file name, page number, frame)   BufMgr wrote a dirty page back to its file
+ *   file_read(file name, page number, bytes)        File read a page image from disk
+ *   file_write(file name, page number, bytes)       File wrote a page image to disk
+ *   split_leaf(page number, new page number)        BTreeIndex split a leaf
+ *   split_nonleaf(page number, new page number)     BTreeIndex split a non-leaf node
+ *   root_change(old root, new root)                 BTreeIndex grew a new root
+ *   scan_start(low value, high value)               BTreeIndex started a scan
+ *   scan_end(page number)                           BTreeIndex ended a scan on the given leaf
+ */
+
+#if !defined(BADGERDB_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+// makes the probe notes name their semaphores
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define BADGERDB_PROBES 1
+#endif
+#endif
+
+#ifdef BADGERDB_PROBES
+// the semaphore of a probe, non-zero while a tracer is attached to it; the name is the one the probe note refers to
+#define BADGERDB_PROBE_SEMAPHORE(name) \
+  __extension__ extern unsigned short badgerdb_##name##_semaphore __attribute__((unused)) \
+  __attribute__((section(".probes")))
+
+BADGERDB_PROBE_SEMAPHORE(page_hit);
+BADGERDB_PROBE_SEMAPHORE(page_miss);
+BADGERDB_PROBE_SEMAPHORE(page_evict);
+BADGERDB_PROBE_SEMAPHORE(page_writeback);
+BADGERDB_PROBE_SEMAPHORE(file_read);
+BADGERDB_PROBE_SEMAPHORE(file_write);
+BADGERDB_PROBE_SEMAPHORE(split_leaf);
+BADGERDB_PROBE_SEMAPHORE(split_nonleaf);
+BADGERDB_PROBE_SEMAPHORE(root_change);
+BADGERDB_PROBE_SEMAPHORE(scan_start);
+BADGERDB_PROBE_SEMAPHORE(scan_end);
+
+#define BADGERDB_PROBE_ENABLED(name) __builtin_expect(badgerdb_##name##_semaphore != 0, 0)
+#define BADGERDB_PROBE1(name, a1) \
+  do { if (BADGERDB_PROBE_ENABLED(name)) { DTRACE_PROBE1(badgerdb, name, a1); } } while (0)
+#define BADGERDB_PROBE2(name, a1, a2) \
+  do { if (BADGERDB_PROBE_ENABLED(name)) { DTRACE_PROBE2(badgerdb, name, a1, a2); } } while (0)
+#define BADGERDB_PROBE3(name, a1, a2, a3) \
+  do { if (BADGERDB_PROBE_ENABLED(name)) { DTRACE_PROBE3(badgerdb, name, a1, a2, a3); } } while (0)
+#else
+// sizeof keeps the arguments referenced, without evaluating them
+#define BADGERDB_PROBE1(name, a1) do { (void)sizeof(a1); } while (0)
+#define BADGERDB_PROBE2(name, a1, a2) do { (void)sizeof(a1); (void)sizeof(a2); } while (0)
+#define BADGERDB_PROBE3(name, a1, a2, a3) do { (void)sizeof(a1); (void)sizeof(a2); (void)sizeof(a3); } while (0)
+#endif
@@ -0,0 +1,296 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "spill_cache.h"
+#include "memory_tracker.h"
+#include "exceptions/file_open_exception.h"
+
+namespace badgerdb {
+
+/**
+ * Transfer a whole page to or from the cache file.
+ * @return True if all of the page was transferred
+ */
+static bool transferPage(const int fd, const bool write, char* buffer, const std::uint32_t slot)
+{
+  std::size_t transferred = 0;
+  off_t offset = static_cast<off_t>(slot) * Page::SIZE;
+  while (transferred < Page::SIZE)
+  {
+    ssize_t bytes;
+    if (write)
+    {
+      bytes = pwrite(fd, buffer + transferred, Page::SIZE - transferred, offset + transferred);
+    }
+    else
+    {
+      bytes = pread(fd, buffer + transferred, Page::SIZE - transferred, offset + transferred);
+    }
+    if (bytes < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (bytes <= 0)
+    {
+      return false;
+    }
+    transferred += bytes;
+  }
+  return true;
+}
+
+SpillCache::SpillCache(const std::string& fileName, const std::uint32_t pages, const std::size_t queuePages)
+  : cacheFileName(fileName), numSlots(pages), slotKeys(pages), slotValid(pages, false), slotRefbit(pages, false),
+    clockHand(0), slotVersion(pages, 0), maxPending(queuePages), nextGeneration(0), writing(false), stopping(false)
+{
+  fd = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    throw FileOpenException(fileName);
+  }
+  writer = std::thread(&SpillCache::writerLoop, this);
+}
+
+SpillCache::~SpillCache()
+{
+  {
+    std::lock_guard<std::mutex> lock(latch);
+    stopping = true;
+  }
+  queued.notify_all();
+  writer.join();
+  close(fd);
+  unlink(cacheFileName.c_str());
+  MemoryTracker::process().release(MEMORY_SPILLQUEUE, pending.size() * sizeof(Page));
+}
+
+void SpillCache::insert(const File* file, const PageId pageNo, const Page& page)
+{
+  if (numSlots == 0)
+  {
+    return;
+  }
+  PageKey key(file, pageNo);
+  std::lock_guard<std::mutex> lock(latch);
+  std::unordered_map<PageKey, PendingPage, PageKeyHash>::iterator entry = pending.find(key);
+  if (entry == pending.end() &&
+      (pending.size() >= maxPending || !MemoryTracker::process().tryReserve(MEMORY_SPILLQUEUE, sizeof(Page))))
+  {
+    //the writer is behind, or the queue is out of memory, and evictions must not wait for it; any older copy of the
+    //page may be stale by now
+    std::unordered_map<PageKey, std::uint32_t, PageKeyHash>::iterator cached = directory.find(key);
+    if (cached != directory.end())
+    {
+      slotValid[cached->second] = false;
+      directory.erase(cached);
+    }
+    return;
+  }
+  PendingPage copy = {nextGeneration++, std::shared_ptr<Page>(new Page(page))};
+  pending[key] = copy;
+  writeQueue.push_back(key);
+  queued.notify_one();
+}
+
+bool SpillCache::fetch(const File* file, const PageId pageNo, Page& page)
+{
+  PageKey key(file, pageNo);
+  std::unique_lock<std::mutex> lock(latch);
+  while (true)
+  {
+    std::unordered_map<PageKey, PendingPage, PageKeyHash>::iterator entry = pending.find(key);
+    if (entry != pending.end())
+    {
+      page = *entry->second.page;
+      return true;
+    }
+    std::unordered_map<PageKey, std::uint32_t, PageKeyHash>::iterator cached = directory.find(key);
+    if (cached == directory.end())
+    {
+      return false;
+    }
+    std::uint32_t slot = cached->second;
+    std::uint64_t version = slotVersion[slot];
+
+    lock.unlock();
+    bool ok = transferPage(fd, false /* write */, reinterpret_cast<char*>(&page), slot);
+    lock.lock();
+
+    //the writer may have reused or rewritten the slot meanwhile; look the page up again then
+    cached = directory.find(key);
+    if (slotVersion[slot] != version || cached == directory.end() || cached->second != slot)
+    {
+      continue;
+    }
+    if (!ok)
+    {
+      slotValid[slot] = false;
+      directory.erase(cached);
+      return false;
+    }
+    slotRefbit[slot] = true;
+    return true;
+  }
+}
+
+void SpillCache::remove(const File* file, const PageId pageNo)
+{
+  PageKey key(file, pageNo);
+  std::lock_guard<std::mutex> lock(latch);
+  if (pending.erase(key) > 0)
+  {
+    MemoryTracker::process().release(MEMORY_SPILLQUEUE, sizeof(Page));
+  }
+  std::unordered_map<PageKey, std::uint32_t, PageKeyHash>::iterator cached = directory.find(key);
+  if (cached != directory.end())
+  {
+    slotValid[cached->second] = false;
+    directory.erase(cached);
+  }
+}
+
+void SpillCache::removeFile(const File* file)
+{
+  std::lock_guard<std::mutex> lock(latch);
+  for (std::unordered_map<PageKey, PendingPage, PageKeyHash>::iterator entry = pending.begin(); entry != pending.end();)
+  {
+    if (entry->first.first == file)
+    {
+      entry = pending.erase(entry);
+      MemoryTracker::process().release(MEMORY_SPILLQUEUE, sizeof(Page));
+    }
+    else
+    {
+      ++entry;
+    }
+  }
+  for (std::unordered_map<PageKey, std::uint32_t, PageKeyHash>::iterator cached = directory.begin();
+       cached != directory.end();)
+  {
+    if (cached->first.first == file)
+    {
+      slotValid[cached->second] = false;
+      cached = directory.erase(cached);
+    }
+    else
+    {
+      ++cached;
+    }
+  }
+}
+
+void SpillCache::drain()
+{
+  std::unique_lock<std::mutex> lock(latch);
+  written.wait(lock, [this]() { return writeQueue.empty() && !writing; });
+}
+
+std::size_t SpillCache::numPages()
+{
+  std::lock_guard<std::mutex> lock(latch);
+  //a page evicted again after it was written is both in the cache file and queued
+  std::size_t pages = directory.size();
+  for (std::unordered_map<PageKey, PendingPage, PageKeyHash>::const_iterator entry = pending.begin();
+       entry != pending.end(); ++entry)
+  {
+    pages += directory.count(entry->first) == 0;
+  }
+  return pages;
+}
+
+std::uint32_t SpillCache::takeSlot()
+{
+  //one sweep clears every reference bit, so the second one finds a slot
+  while (true)
+  {
+    clockHand = (clockHand + 1) % numSlots;
+    if (!slotValid[clockHand])
+    {
+      return clockHand;
+    }
+    if (slotRefbit[clockHand])
+    {
+      slotRefbit[clockHand] = false;
+      continue;
+    }
+    directory.erase(slotKeys[clockHand]);
+    slotValid[clockHand] = false;
+    return clockHand;
+  }
+}
+
+void SpillCache::writerLoop()
+{
+  std::unique_lock<std::mutex> lock(latch);
+  while (true)
+  {
+    queued.wait(lock, [this]() { return stopping || !writeQueue.empty(); });
+    if (stopping)
+    {
+      return;
+    }
+    PageKey key = writeQueue.front();
+    writeQueue.pop_front();
+    std::unordered_map<PageKey, PendingPage, PageKeyHash>::iterator entry = pending.find(key);
+    if (entry == pending.end())
+    {
+      //removed, or already written through an earlier entry of the queue
+      written.notify_all();
+      continue;
+    }
+    PendingPage copy = entry->second;
+
+    //the older copy of the page, if any, is overwritten in place; readers find the page in pending meanwhile
+    std::uint32_t slot;
+    std::unordered_map<PageKey, std::uint32_t, PageKeyHash>::iterator cached = directory.find(key);
+    if (cached != directory.end())
+    {
+      slot = cached->second;
+      directory.erase(cached);
+    }
+    else
+    {
+      slot = takeSlot();
+    }
+    slotValid[slot] = true;
+    slotKeys[slot] = key;
+    slotVersion[slot]++;
+    writing = true;
+
+    lock.unlock();
+    bool ok = transferPage(fd, true /* write */, reinterpret_cast<char*>(copy.page.get()), slot);
+    lock.lock();
+
+    writing = false;
+    entry = pending.find(key);
+    if (entry != pending.end() && entry->second.generation == copy.generation)
+    {
+      pending.erase(entry);
+      MemoryTracker::process().release(MEMORY_SPILLQUEUE, sizeof(Page));
+      if (ok)
+      {
+        directory[key] = slot;
+        slotRefbit[slot] = false;
+      }
+      else
+      {
+        slotValid[slot] = false;
+      }
+    }
+    else
+    {
+      //removed or replaced while being written
+      slotValid[slot] = false;
+    }
+    written.notify_all();
+  }
+}
+
+}
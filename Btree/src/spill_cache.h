@@ -0,0 +1,226 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Default number of evicted pages waiting to be written to a SpillCache before new ones are dropped.
+ */
+const std::size_t SPILLQUEUEPAGES = 256;
+
+/**
+* @brief Secondary page cache in a local file, for pages BufMgr evicts.
+* Meant for a cache file on fast local storage in front of index files on slower volumes. Evicted pages are queued
+* and written to a slot of the cache file by a background thread; a hash directory maps (file, page number) to the
+* slot holding the page. Once all slots are taken, they are reused in clock order. The cache file only lives as long
+* as the SpillCache and is removed by its destructor.
+*
+* All calls are thread safe.
+*/
+class SpillCache
+{
+ private:
+	/**
+	 * Key of a cached page: its file and page number
+	 */
+  typedef std::pair<const File*, PageId> PageKey;
+
+	/**
+	 * Hash of a PageKey, as in BufHashTbl
+	 */
+  struct PageKeyHash
+  {
+    std::size_t operator()(const PageKey& key) const
+    {
+      return std::hash<const File*>()(key.first) ^ (std::hash<PageId>()(key.second) * 0x9e3779b9u);
+    }
+  };
+
+	/**
+	 * Evicted page waiting for the writer
+	 */
+  struct PendingPage
+  {
+    /**
+     * Identifies this copy, so that the writer can tell whether it was replaced or removed meanwhile
+     */
+    std::uint64_t generation;
+    std::shared_ptr<Page> page;
+  };
+
+	/**
+	 * Name and descriptor of the cache file
+	 */
+  std::string cacheFileName;
+  int fd;
+
+	/**
+	 * Number of page slots in the cache file
+	 */
+  std::uint32_t numSlots;
+
+	/**
+	 * Page held by every slot; slotValid is false for free slots
+	 */
+  std::vector<PageKey> slotKeys;
+  std::vector<bool> slotValid;
+
+	/**
+	 * Reference bits of the slots, and the clock hand choosing the slot to reuse
+	 */
+  std::vector<bool> slotRefbit;
+  std::uint32_t clockHand;
+
+	/**
+	 * Bumped whenever the writer takes a slot, so that a read from the cache file made without the latch can tell
+	 * whether the slot was overwritten meanwhile
+	 */
+  std::vector<std::uint64_t> slotVersion;
+
+	/**
+	 * Slot of every page written to the cache file
+	 */
+  std::unordered_map<PageKey, std::uint32_t, PageKeyHash> directory;
+
+	/**
+	 * Pages queued for the writer, and the order to write them in
+	 */
+  std::unordered_map<PageKey, PendingPage, PageKeyHash> pending;
+  std::deque<PageKey> writeQueue;
+
+	/**
+	 * Most pages queued at once
+	 */
+  std::size_t maxPending;
+
+	/**
+	 * Source of PendingPage::generation
+	 */
+  std::uint64_t nextGeneration;
+
+	/**
+	 * Latch protecting all of the above. Reads from and writes to the cache file are made without it.
+	 */
+  std::mutex latch;
+
+	/**
+	 * Signalled when a page is queued or the cache is shut down
+	 */
+  std::condition_variable queued;
+
+	/**
+	 * Signalled when the writer has finished with a queued page
+	 */
+  std::condition_variable written;
+
+	/**
+	 * True while the writer is writing a page without the latch
+	 */
+  bool writing;
+
+	/**
+	 * Set by the destructor to stop the writer
+	 */
+  bool stopping;
+
+	/**
+	 * Background thread writing queued pages to the cache file
+	 */
+  std::thread writer;
+
+	/**
+	 * Main loop of the writer thread
+	 */
+  void writerLoop();
+
+	/**
+	 * Take a slot for a page to write, free or reused in clock order. Called with the latch held.
+	 */
+  std::uint32_t takeSlot();
+
+ public:
+	/**
+   * Create the cache file and start the writer.
+	 *
+	 * @param fileName		Name of the cache file, created or truncated
+	 * @param pages				Number of page slots in the cache file
+	 * @param queuePages	Most evicted pages waiting to be written; pages evicted beyond that, or beyond the memory
+	 *										budget of the process, are not cached
+   * @throws  FileOpenException If the cache file cannot be created
+	 */
+  SpillCache(const std::string& fileName, const std::uint32_t pages,
+             const std::size_t queuePages = SPILLQUEUEPAGES);
+
+	/**
+   * Stop the writer, dropping the pages still queued, and remove the cache file.
+	 */
+  ~SpillCache();
+
+  SpillCache(const SpillCache&) = delete;
+  SpillCache& operator=(const SpillCache&) = delete;
+
+	/**
+	 * Queue an evicted page to be written to the cache file, replacing any older copy of it.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param page		Contents of the page, which must be the same as in the file
+	 */
+  void insert(const File* file, const PageId pageNo, const Page& page);
+
+	/**
+	 * Read a page from the queue or the cache file. The page stays cached.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param page		Page returned via this reference, set only if the page is cached
+	 * @return true if the page was cached
+	 */
+  bool fetch(const File* file, const PageId pageNo, Page& page);
+
+	/**
+	 * Drop a page, whose copy in the cache would go stale.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  void remove(const File* file, const PageId pageNo);
+
+	/**
+	 * Drop every page of a file.
+	 *
+	 * @param file   	File object
+	 */
+  void removeFile(const File* file);
+
+	/**
+	 * Wait until the writer has written every page queued so far.
+	 */
+  void drain();
+
+	/**
+   * Number of pages in the cache file or queued
+	 */
+  std::size_t numPages();
+};
+
+}
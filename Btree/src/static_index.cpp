@@ -0,0 +1,758 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <queue>
+#include <limits>
+#include "static_index.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_record_exception.h"
+
+namespace badgerdb
+{
+
+	static_assert(sizeof(StaticIndexMetaInfo) <= Page::SIZE, "Static index meta info must fit in a page.");
+	static_assert(sizeof(StaticLeafInt) <= Page::SIZE, "Static index leaf must fit in a page.");
+
+	/**
+	 * Position of the merge of the external sort inside one sorted run of the temporary run file.
+	 */
+	struct SortRunCursor {
+		/**
+		 * Page of the run holding the entries currently buffered.
+		 */
+		PageId pageNo;
+
+		/**
+		 * Entries of the run not buffered yet.
+		 */
+		int remaining;
+
+		/**
+		 * Next buffered entry to merge.
+		 */
+		std::size_t next;
+
+		/**
+		 * Copy of the entries of page pageNo, so that merging many runs does not keep their pages pinned.
+		 */
+		std::vector<RIDKeyPair<int> > entries;
+	};
+
+	/**
+	 * Buffer the next page of a run into its cursor.
+	 */
+	static void loadRunPage(BufMgr *bufMgr, File *runFile, SortRunCursor &cursor)
+	{
+		Page *page;
+		bufMgr->readPage(runFile, cursor.pageNo, page);
+		StaticLeafInt *runPage = (StaticLeafInt *)page;
+		cursor.entries.resize(runPage->numEntries);
+		for (int i = 0; i < runPage->numEntries; i++)
+		{
+			cursor.entries[i].set(runPage->ridArray[i], runPage->keyArray[i]);
+		}
+		bufMgr->unPinPage(runFile, cursor.pageNo, false);
+		cursor.remaining -= runPage->numEntries;
+		cursor.next = 0;
+		cursor.pageNo++;
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::StaticIndex -- Constructor
+	// -----------------------------------------------------------------------------
+
+	StaticIndex::StaticIndex(const std::string &relationName,
+							 std::string &outIndexName,
+							 BufMgr *bufMgrIn,
+							 const int attrByteOffset,
+							 const Datatype attrType,
+							 const int modelError)
+	{
+		bufMgr = bufMgrIn;
+		scanExecuting = false;
+		currentPageData = nullptr;
+		//compute indexName
+		std::ostringstream idxStr;
+		idxStr << relationName << '.' << attrByteOffset << ".static";
+		outIndexName = idxStr.str();
+		if (modelError < 0)
+		{
+			throw BadIndexInfoException(outIndexName);
+		}
+		try
+		{
+			file = new BlobFile(outIndexName, false);
+			//File Exists, load and check the meta page
+			Page *headerPage;
+			headerPageNum = file->getFirstPageNo();
+			bufMgr->readPage(file, headerPageNum, headerPage);
+			meta = *((StaticIndexMetaInfo *)headerPage);
+			bufMgr->unPinPage(file, headerPageNum, false);
+			if (relationName.compare(0, sizeof(meta.relationName) - 1, meta.relationName) != 0
+				|| meta.attrByteOffset != attrByteOffset || meta.attrType != attrType)
+			{
+				bufMgr->flushFile(file);
+				delete file;
+				throw BadIndexInfoException(outIndexName);
+			}
+			if (meta.modelError != 0)
+			{
+				loadModel();
+			}
+			else
+			{
+				loadDirectory();
+			}
+		}
+		catch (FileNotFoundException &e)
+		{
+			file = new BlobFile(outIndexName, true);
+			try
+			{
+				Page *headerPage;
+				bufMgr->allocPage(file, headerPageNum, headerPage);
+				bufMgr->unPinPage(file, headerPageNum, true);
+
+				memset(&meta, 0, sizeof(meta));
+				strncpy(meta.relationName, relationName.c_str(), sizeof(meta.relationName) - 1);
+				meta.attrByteOffset = attrByteOffset;
+				meta.attrType = attrType;
+				meta.modelError = modelError;
+				build(relationName, outIndexName);
+
+				bufMgr->readPage(file, headerPageNum, headerPage);
+				*((StaticIndexMetaInfo *)headerPage) = meta;
+				bufMgr->unPinPage(file, headerPageNum, true);
+			}
+			catch (...)
+			{
+				//drop the partly built index, so that it is not reopened as a whole one
+				bufMgr->flushFile(file);
+				delete file;
+				File::remove(outIndexName);
+				throw;
+			}
+			bufMgr->flushFile(file);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::~StaticIndex -- destructor
+	// -----------------------------------------------------------------------------
+
+	StaticIndex::~StaticIndex()
+	{
+		try
+		{
+			if (scanExecuting)
+			{
+				endScan();
+			}
+			bufMgr->flushFile(file);
+		}
+		catch (...)
+		{
+			//the destructor must not throw; the index was written out when it was built
+		}
+		delete file;
+		file = nullptr;
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::build
+	// -----------------------------------------------------------------------------
+
+	void StaticIndex::build(const std::string &relationName, const std::string &indexName)
+	{
+		std::vector<RIDKeyPair<int> > run;
+		std::vector<std::pair<PageId, int> > runs;
+		std::string runFileName = indexName + ".run";
+		File *runFile = nullptr;
+		PageId leafPageNo = 0;
+		Page *leafPage = nullptr;
+		std::vector<int> firstKeys;
+		try
+		{
+			//sort the entries in runs of STATICSORTRUNSIZE, spilling every full run to the run file
+			{
+				FileScan scanner(relationName, bufMgr);
+				RecordId currRid;
+				RIDKeyPair<int> entry;
+				std::size_t length;
+				bool scanDone = false;
+				while (!scanDone)
+				{
+					if (scanner.tryScanNext(currRid))
+					{
+						const char *record = scanner.getRecordData(length);
+						//a record too short to hold the key is not of this relation
+						if ((std::size_t)meta.attrByteOffset + sizeof(int) > length)
+						{
+							throw InvalidRecordException(currRid, currRid.page_number);
+						}
+						entry.set(currRid, *((int *)(record + meta.attrByteOffset)));
+						run.push_back(entry);
+					}
+					else
+					{
+						scanDone = true;
+					}
+					if (run.size() == (std::size_t)STATICSORTRUNSIZE || (scanDone && !runs.empty() && !run.empty()))
+					{
+						std::sort(run.begin(), run.end());
+						if (runFile == nullptr)
+						{
+							if (File::exists(runFileName))
+							{
+								File::remove(runFileName);
+							}
+							runFile = new BlobFile(runFileName, true);
+						}
+						std::pair<PageId, int> runInfo(0, run.size());
+						for (std::size_t start = 0; start < run.size(); start += STATICLEAFSIZE)
+						{
+							PageId pageNo;
+							Page *page;
+							bufMgr->allocPage(runFile, pageNo, page);
+							StaticLeafInt *runPage = (StaticLeafInt *)page;
+							runPage->numEntries = std::min(run.size() - start, (std::size_t)STATICLEAFSIZE);
+							for (int i = 0; i < runPage->numEntries; i++)
+							{
+								runPage->keyArray[i] = run[start + i].key;
+								runPage->ridArray[i] = run[start + i].rid;
+							}
+							bufMgr->unPinPage(runFile, pageNo, true);
+							if (start == 0)
+							{
+								runInfo.first = pageNo;
+							}
+						}
+						runs.push_back(runInfo);
+						run.clear();
+					}
+				}
+			}
+
+			//write the leaves, straight from memory if everything fit in a single run, or by merging the runs
+			if (runs.empty())
+			{
+				std::sort(run.begin(), run.end());
+				for (std::size_t i = 0; i < run.size(); i++)
+				{
+					appendEntry(run[i], leafPageNo, leafPage, firstKeys);
+				}
+			}
+			else
+			{
+				std::vector<SortRunCursor> cursors(runs.size());
+				typedef std::pair<RIDKeyPair<int>, int> HeapEntry;
+				std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry> > heap;
+				for (std::size_t r = 0; r < runs.size(); r++)
+				{
+					cursors[r].pageNo = runs[r].first;
+					cursors[r].remaining = runs[r].second;
+					loadRunPage(bufMgr, runFile, cursors[r]);
+					heap.push(HeapEntry(cursors[r].entries[0], r));
+				}
+				while (!heap.empty())
+				{
+					int r = heap.top().second;
+					appendEntry(heap.top().first, leafPageNo, leafPage, firstKeys);
+					heap.pop();
+					SortRunCursor &cursor = cursors[r];
+					cursor.next++;
+					if (cursor.next == cursor.entries.size() && cursor.remaining > 0)
+					{
+						loadRunPage(bufMgr, runFile, cursor);
+					}
+					if (cursor.next < cursor.entries.size())
+					{
+						heap.push(HeapEntry(cursor.entries[cursor.next], r));
+					}
+				}
+				bufMgr->flushFile(runFile);
+				delete runFile;
+				runFile = nullptr;
+				File::remove(runFileName);
+			}
+			if (leafPage != nullptr)
+			{
+				bufMgr->unPinPage(file, leafPageNo, true);
+				leafPage = nullptr;
+			}
+			if (meta.modelError != 0)
+			{
+				writeModel();
+			}
+			else
+			{
+				writeDirectory(firstKeys);
+			}
+		}
+		catch (...)
+		{
+			//leave no pinned page behind, nor the run file
+			if (leafPage != nullptr)
+			{
+				bufMgr->unPinPage(file, leafPageNo, true);
+			}
+			if (runFile != nullptr)
+			{
+				bufMgr->flushFile(runFile);
+				delete runFile;
+				File::remove(runFileName);
+			}
+			throw;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::appendEntry
+	// -----------------------------------------------------------------------------
+
+	void StaticIndex::appendEntry(const RIDKeyPair<int> &entry, PageId &leafPageNo, Page *&leafPage, std::vector<int> &firstKeys)
+	{
+		if (leafPage == nullptr || ((StaticLeafInt *)leafPage)->numEntries == STATICLEAFSIZE)
+		{
+			if (leafPage != nullptr)
+			{
+				bufMgr->unPinPage(file, leafPageNo, true);
+				leafPage = nullptr;
+			}
+			bufMgr->allocPage(file, leafPageNo, leafPage);
+			((StaticLeafInt *)leafPage)->numEntries = 0;
+			if (meta.numLeaves == 0)
+			{
+				meta.firstLeafPageNo = leafPageNo;
+			}
+			meta.numLeaves++;
+			firstKeys.push_back(entry.key);
+		}
+		if (meta.modelError != 0 && (meta.numEntries == 0 || entry.key != lastKey))
+		{
+			addModelPoint(entry.key, meta.numEntries);
+		}
+		lastKey = entry.key;
+		StaticLeafInt *leaf = (StaticLeafInt *)leafPage;
+		leaf->keyArray[leaf->numEntries] = entry.key;
+		leaf->ridArray[leaf->numEntries] = entry.rid;
+		leaf->numEntries++;
+		meta.numEntries++;
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::placeEytzinger
+	// -----------------------------------------------------------------------------
+
+	int StaticIndex::placeEytzinger(int leaf, int slot)
+	{
+		if (slot <= meta.numLeaves)
+		{
+			leaf = placeEytzinger(leaf, 2 * slot);
+			eytzingerLeaves[slot] = leaf++;
+			leaf = placeEytzinger(leaf, 2 * slot + 1);
+		}
+		return leaf;
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::writeDirectory
+	// -----------------------------------------------------------------------------
+
+	void StaticIndex::writeDirectory(const std::vector<int> &firstKeys)
+	{
+		eytzingerLeaves.assign(meta.numLeaves + 1, 0);
+		placeEytzinger(0, 1);
+		eytzingerKeys.assign(meta.numLeaves + 1, 0);
+		for (int slot = 1; slot <= meta.numLeaves; slot++)
+		{
+			eytzingerKeys[slot] = firstKeys[eytzingerLeaves[slot]];
+		}
+		for (int start = 1; start <= meta.numLeaves; start += STATICDIRPAGESIZE)
+		{
+			PageId pageNo;
+			Page *page;
+			bufMgr->allocPage(file, pageNo, page);
+			if (start == 1)
+			{
+				meta.firstDirPageNo = pageNo;
+			}
+			int count = std::min(meta.numLeaves + 1 - start, STATICDIRPAGESIZE);
+			std::copy(eytzingerKeys.begin() + start, eytzingerKeys.begin() + start + count, (int *)page);
+			bufMgr->unPinPage(file, pageNo, true);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::loadDirectory
+	// -----------------------------------------------------------------------------
+
+	void StaticIndex::loadDirectory()
+	{
+		eytzingerLeaves.assign(meta.numLeaves + 1, 0);
+		placeEytzinger(0, 1);
+		eytzingerKeys.assign(meta.numLeaves + 1, 0);
+		PageId pageNo = meta.firstDirPageNo;
+		for (int start = 1; start <= meta.numLeaves; start += STATICDIRPAGESIZE)
+		{
+			Page *page;
+			bufMgr->readPage(file, pageNo, page);
+			int count = std::min(meta.numLeaves + 1 - start, STATICDIRPAGESIZE);
+			std::copy((int *)page, (int *)page + count, eytzingerKeys.begin() + start);
+			bufMgr->unPinPage(file, pageNo, false);
+			pageNo++;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::findLeaf
+	// -----------------------------------------------------------------------------
+
+	int StaticIndex::findLeaf(int key, bool inclusive) const
+	{
+		//branch free descent of the implicit tree, ending below the first slot whose key qualifies
+		int slot = 1;
+		while (slot <= meta.numLeaves)
+		{
+			slot = 2 * slot + (inclusive ? eytzingerKeys[slot] < key : eytzingerKeys[slot] <= key);
+		}
+		//undo the right turns taken after the last left turn
+		slot >>= __builtin_ffs(~slot);
+		//the first entry in range may be at the end of the leaf before the first leaf starting in range
+		int leaf = slot == 0 ? meta.numLeaves : eytzingerLeaves[slot];
+		return leaf > 0 ? leaf - 1 : 0;
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::addModelPoint
+	// -----------------------------------------------------------------------------
+
+	void StaticIndex::addModelPoint(int key, int pos)
+	{
+		//shrink the cone of slopes from the start of the last segment that predict every point within the error bound
+		if (!segments.empty())
+		{
+			StaticModelSegment &segment = segments.back();
+			double dx = (double)key - segment.firstKey;
+			double low = (pos - segment.firstPos - meta.modelError) / dx;
+			double high = (pos - segment.firstPos + meta.modelError) / dx;
+			if (low <= coneSlopeHigh && high >= coneSlopeLow)
+			{
+				coneSlopeLow = std::max(low, coneSlopeLow);
+				coneSlopeHigh = std::min(high, coneSlopeHigh);
+				segment.slope = (coneSlopeLow + coneSlopeHigh) / 2;
+				return;
+			}
+		}
+		StaticModelSegment segment;
+		segment.firstKey = key;
+		segment.firstPos = pos;
+		segment.slope = 0;
+		segments.push_back(segment);
+		meta.numSegments++;
+		coneSlopeLow = 0;
+		coneSlopeHigh = std::numeric_limits<double>::infinity();
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::writeModel
+	// -----------------------------------------------------------------------------
+
+	void StaticIndex::writeModel()
+	{
+		for (int start = 0; start < meta.numSegments; start += STATICMODELPAGESIZE)
+		{
+			PageId pageNo;
+			Page *page;
+			bufMgr->allocPage(file, pageNo, page);
+			if (start == 0)
+			{
+				meta.firstModelPageNo = pageNo;
+			}
+			int count = std::min(meta.numSegments - start, STATICMODELPAGESIZE);
+			std::copy(segments.begin() + start, segments.begin() + start + count, (StaticModelSegment *)page);
+			bufMgr->unPinPage(file, pageNo, true);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::loadModel
+	// -----------------------------------------------------------------------------
+
+	void StaticIndex::loadModel()
+	{
+		segments.resize(meta.numSegments);
+		PageId pageNo = meta.firstModelPageNo;
+		for (int start = 0; start < meta.numSegments; start += STATICMODELPAGESIZE)
+		{
+			Page *page;
+			bufMgr->readPage(file, pageNo, page);
+			int count = std::min(meta.numSegments - start, STATICMODELPAGESIZE);
+			std::copy((StaticModelSegment *)page, (StaticModelSegment *)page + count, segments.begin() + start);
+			bufMgr->unPinPage(file, pageNo, false);
+			pageNo++;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::keyAt
+	// -----------------------------------------------------------------------------
+
+	int StaticIndex::keyAt(int pos, PageId &pageNo, Page *&page)
+	{
+		PageId leafPageNo = meta.firstLeafPageNo + pos / STATICLEAFSIZE;
+		if (leafPageNo != pageNo)
+		{
+			if (pageNo != 0)
+			{
+				bufMgr->unPinPage(file, pageNo, false);
+			}
+			bufMgr->readPage(file, leafPageNo, page);
+			pageNo = leafPageNo;
+		}
+		return ((StaticLeafInt *)page)->keyArray[pos % STATICLEAFSIZE];
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::findPosition
+	// -----------------------------------------------------------------------------
+
+	int StaticIndex::findPosition(int key)
+	{
+		if (segments.empty() || key < segments[0].firstKey)
+		{
+			return 0;
+		}
+		//last segment starting at or before key
+		int s = 0, count = segments.size();
+		while (count > 1)
+		{
+			int half = count / 2;
+			s = segments[s + half].firstKey <= key ? s + half : s;
+			count -= half;
+		}
+		const StaticModelSegment &segment = segments[s];
+		int segmentEnd = s + 1 < meta.numSegments ? segments[s + 1].firstPos : meta.numEntries;
+		double predicted = segment.firstPos + segment.slope * ((double)key - segment.firstKey);
+		int pos = std::min((double)segmentEnd, std::max((double)segment.firstPos, predicted));
+
+		//the position is in [lo, hi] when the prediction is within the error bound; widen the window otherwise
+		int lo = std::max(0, pos - meta.modelError);
+		int hi = std::min(meta.numEntries, pos + meta.modelError);
+		int step = meta.modelError + 1;
+		PageId pageNo = 0;
+		Page *page = nullptr;
+		while (lo > 0 && keyAt(lo - 1, pageNo, page) >= key)
+		{
+			hi = lo - 1;
+			lo = std::max(0, lo - step);
+			step *= 2;
+		}
+		while (hi < meta.numEntries && keyAt(hi, pageNo, page) < key)
+		{
+			lo = hi + 1;
+			hi = std::min(meta.numEntries, hi + step);
+			step *= 2;
+		}
+		while (lo < hi)
+		{
+			int mid = lo + (hi - lo) / 2;
+			if (keyAt(mid, pageNo, page) < key)
+			{
+				lo = mid + 1;
+			}
+			else
+			{
+				hi = mid;
+			}
+		}
+		if (pageNo != 0)
+		{
+			bufMgr->unPinPage(file, pageNo, false);
+		}
+		return lo;
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::startScan
+	// -----------------------------------------------------------------------------
+
+	void StaticIndex::startScan(const void *lowValParm,
+								const Operator lowOpParm,
+								const void *highValParm,
+								const Operator highOpParm)
+	{
+		if (!tryStartScan(lowValParm, lowOpParm, highValParm, highOpParm))
+		{
+			throw NoSuchKeyFoundException();
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::tryStartScan
+	// -----------------------------------------------------------------------------
+
+	bool StaticIndex::tryStartScan(const void *lowValParm,
+								   const Operator lowOpParm,
+								   const void *highValParm,
+								   const Operator highOpParm)
+	{
+		lowValInt = *((int *)lowValParm);
+		highValInt = *((int *)highValParm);
+		if ((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE))
+		{
+			throw BadOpcodesException();
+		}
+		else if (highValInt < lowValInt)
+		{
+			throw BadScanrangeException();
+		}
+		lowOp = lowOpParm;
+		highOp = highOpParm;
+		if (scanExecuting)
+		{
+			endScan();
+		}
+		if (meta.numLeaves == 0)
+		{
+			return false;
+		}
+
+		StaticLeafInt *leaf;
+		if (meta.modelError != 0)
+		{
+			//model prediction and a bounded search of the leaves around it
+			if (lowOp == GT && lowValInt == std::numeric_limits<int>::max())
+			{
+				return false;
+			}
+			int pos = findPosition(lowOp == GT ? lowValInt + 1 : lowValInt);
+			if (pos == meta.numEntries)
+			{
+				return false;
+			}
+			currentLeaf = pos / STATICLEAFSIZE;
+			nextEntry = pos % STATICLEAFSIZE;
+			bufMgr->readPage(file, meta.firstLeafPageNo + currentLeaf, currentPageData);
+			leaf = (StaticLeafInt *)currentPageData;
+		}
+		else
+		{
+			//one directory search and one leaf read
+			currentLeaf = findLeaf(lowValInt, lowOp == GTE);
+			bufMgr->readPage(file, meta.firstLeafPageNo + currentLeaf, currentPageData);
+			leaf = (StaticLeafInt *)currentPageData;
+			int *keysEnd = leaf->keyArray + leaf->numEntries;
+			int *first = lowOp == GTE ? std::lower_bound(leaf->keyArray, keysEnd, lowValInt)
+									  : std::upper_bound(leaf->keyArray, keysEnd, lowValInt);
+			nextEntry = first - leaf->keyArray;
+			//the first entry in range starts the next leaf
+			if (nextEntry == leaf->numEntries)
+			{
+				bufMgr->unPinPage(file, meta.firstLeafPageNo + currentLeaf, false);
+				currentLeaf++;
+				if (currentLeaf == meta.numLeaves)
+				{
+					currentPageData = nullptr;
+					return false;
+				}
+				bufMgr->readPage(file, meta.firstLeafPageNo + currentLeaf, currentPageData);
+				leaf = (StaticLeafInt *)currentPageData;
+				nextEntry = 0;
+			}
+		}
+		int key = leaf->keyArray[nextEntry];
+		if ((highOp == LT && key >= highValInt) || (highOp == LTE && key > highValInt))
+		{
+			bufMgr->unPinPage(file, meta.firstLeafPageNo + currentLeaf, false);
+			currentPageData = nullptr;
+			return false;
+		}
+		scanExecuting = true;
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::scanNext
+	// -----------------------------------------------------------------------------
+
+	void StaticIndex::scanNext(RecordId &outRid)
+	{
+		if (!tryScanNext(outRid))
+		{
+			throw IndexScanCompletedException();
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::tryScanNext
+	// -----------------------------------------------------------------------------
+
+	bool StaticIndex::tryScanNext(RecordId &outRid)
+	{
+		if (!scanExecuting)
+		{
+			throw ScanNotInitializedException();
+		}
+		if (currentPageData == nullptr)
+		{
+			return false;
+		}
+		StaticLeafInt *leaf = (StaticLeafInt *)currentPageData;
+		if (nextEntry == leaf->numEntries)
+		{
+			bufMgr->unPinPage(file, meta.firstLeafPageNo + currentLeaf, false);
+			currentLeaf++;
+			if (currentLeaf == meta.numLeaves)
+			{
+				currentPageData = nullptr;
+				return false;
+			}
+			bufMgr->readPage(file, meta.firstLeafPageNo + currentLeaf, currentPageData);
+			leaf = (StaticLeafInt *)currentPageData;
+			nextEntry = 0;
+		}
+		//entries are sorted, so only the high end of the range needs checking
+		int key = leaf->keyArray[nextEntry];
+		if ((highOp == LT && key >= highValInt) || (highOp == LTE && key > highValInt))
+		{
+			return false;
+		}
+		outRid = leaf->ridArray[nextEntry];
+		nextEntry++;
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// StaticIndex::endScan
+	// -----------------------------------------------------------------------------
+
+	void StaticIndex::endScan()
+	{
+		if (!scanExecuting)
+		{
+			throw ScanNotInitializedException();
+		}
+		if (currentPageData != nullptr)
+		{
+			bufMgr->unPinPage(file, meta.firstLeafPageNo + currentLeaf, false);
+		}
+		scanExecuting = false;
+		nextEntry = -1;
+		currentLeaf = -1;
+		currentPageData = nullptr;
+	}
+
+}
@@ -0,0 +1,405 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of key slots in a leaf of a StaticIndex for INTEGER key.
+ */
+//                                                       numEntries             key               rid
+const int STATICLEAFSIZE = ( Page::SIZE - sizeof( int ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+
+/**
+ * @brief Number of directory keys stored in a directory page of a StaticIndex.
+ */
+const int STATICDIRPAGESIZE = Page::SIZE / sizeof( int );
+
+/**
+ * @brief Number of entries sorted in memory at once while building a StaticIndex.
+ * Relations with more entries are sorted in runs spilled to a temporary file and merged.
+ */
+const int STATICSORTRUNSIZE = 1 << 16;
+
+/**
+ * @brief A segment of the piecewise linear model of a learned StaticIndex.
+ * Predicts the position, among all entries of the index in order, of the first entry with a key not smaller than
+ * a key k in [firstKey, next segment's firstKey) as firstPos + slope * (k - firstKey).
+ */
+struct StaticModelSegment{
+  /**
+   * Smallest key covered by the segment.
+   */
+	int firstKey;
+
+  /**
+   * Position of the first entry with key firstKey.
+   */
+	int firstPos;
+
+  /**
+   * Entries per key unit.
+   */
+	double slope;
+};
+
+/**
+ * @brief Number of model segments stored in a model page of a learned StaticIndex.
+ */
+const int STATICMODELPAGESIZE = Page::SIZE / sizeof( StaticModelSegment );
+
+/**
+ * @brief The meta page of a static index file, always the first page of the file.
+ * Leaves and then directory or model pages are each stored contiguously after it.
+ */
+struct StaticIndexMetaInfo{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Offset of attribute, over which index is built, inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute over which index is built.
+   */
+	Datatype attrType;
+
+  /**
+   * Number of entries in the index.
+   */
+	int numEntries;
+
+  /**
+   * Number of leaf pages.
+   */
+	int numLeaves;
+
+  /**
+   * Page number of the first leaf; leaf i is page firstLeafPageNo + i.
+   */
+	PageId firstLeafPageNo;
+
+  /**
+   * Page number of the first directory page; the directory holds the first key of every leaf in Eytzinger order.
+   */
+	PageId firstDirPageNo;
+
+  /**
+   * Error bound of the learned model in entries, 0 if the index searches the directory instead.
+   */
+	int modelError;
+
+  /**
+   * Number of segments of the learned model.
+   */
+	int numSegments;
+
+  /**
+   * Page number of the first model page; model pages contiguously store the segments in key order.
+   */
+	PageId firstModelPageNo;
+};
+
+/**
+ * @brief Structure of the fully packed, sorted leaves of a StaticIndex when the key is of INTEGER type.
+*/
+struct StaticLeafInt{
+  /**
+   * Number of used slots. Every leaf but the last one is full.
+   */
+	int numEntries;
+
+  /**
+   * Stores keys.
+   */
+	int keyArray[ STATICLEAFSIZE ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ STATICLEAFSIZE ];
+};
+
+/**
+ * @brief StaticIndex class. It implements an immutable, read optimized index on a single attribute of a relation:
+ * a fully packed sorted array of <key, rid> pairs in leaf pages plus a directory of the first key of every leaf.
+ * The directory is kept in memory in Eytzinger (breadth first) order, so a lookup searches it without cache misses
+ * on its upper levels and then reads a single leaf. The index is built once from the relation with an external sort
+ * and offers the same scan interface as BTreeIndex. This index supports only one scan at a time.
+ *
+ * Optionally the index is learned: a piecewise linear model of the key distribution, built in the same pass that
+ * writes the leaves, predicts the position of a key within a fixed error bound and a bounded search of the leaves
+ * around the prediction finds it. For smooth key distributions the model takes a few KB.
+*/
+class StaticIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * In-memory copy of the meta page.
+   */
+	StaticIndexMetaInfo	meta;
+
+  /**
+   * First key of every leaf in Eytzinger order, 1-based: the children of slot k are slots 2k and 2k+1.
+   */
+	std::vector<int>	eytzingerKeys;
+
+  /**
+   * Leaf number of every slot of eytzingerKeys.
+   */
+	std::vector<int>	eytzingerLeaves;
+
+  /**
+   * Segments of the learned model, in key order. Empty unless meta.modelError is set.
+   */
+	std::vector<StaticModelSegment>	segments;
+
+  /**
+   * Lowest and highest slope that keep every point added to the last segment within the error bound, while building.
+   */
+	double	coneSlopeLow, coneSlopeHigh;
+
+  /**
+   * Key of the last entry appended, while building.
+   */
+	int			lastKey;
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Index of next entry to be scanned in current leaf being scanned.
+   */
+	int			nextEntry;
+
+  /**
+   * Leaf number of current leaf being scanned.
+   */
+	int			currentLeaf;
+
+  /**
+   * Current Page being scanned, nullptr once the scan went past the last leaf.
+   */
+	Page		*currentPageData;
+
+  /**
+   * Low INTEGER value for scan.
+   */
+	int			lowValInt;
+
+  /**
+   * High INTEGER value for scan.
+   */
+	int			highValInt;
+
+  /**
+   * Low Operator. Can only be GT(>) or GTE(>=).
+   */
+	Operator	lowOp;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+  /**
+   * Sort the entries of the relation and write them to the index file as packed leaves, spilling sorted runs
+   * to a temporary file when they do not fit in memory.
+   * @param relationName	Name of the relation
+   * @param indexName			Name of the index file, used to name the temporary run file
+   */
+	void build(const std::string & relationName, const std::string & indexName);
+
+  /**
+   * Append one entry to the leaves being written, starting a new leaf when the current one is full.
+   * @param entry				Entry to append, not smaller than the entries appended before it
+   * @param leafPageNo	Page number of the leaf being filled, updated when a new leaf is started
+   * @param leafPage		Pinned leaf being filled, nullptr before the first entry
+   * @param firstKeys		First key of every leaf written so far, appended to when a new leaf is started
+   */
+	void appendEntry(const RIDKeyPair<int> & entry, PageId &leafPageNo, Page *&leafPage, std::vector<int> & firstKeys);
+
+  /**
+   * Write the directory, in Eytzinger order, after the leaves and load it.
+   * @param firstKeys		First key of every leaf, in leaf order
+   */
+	void writeDirectory(const std::vector<int> & firstKeys);
+
+  /**
+   * Load the directory from the index file into memory.
+   */
+	void loadDirectory();
+
+  /**
+   * Number the slots of the Eytzinger layout with the leaf whose first key they hold, by an in-order walk of the implicit tree.
+   * @param leaf		Next leaf number to assign
+   * @param slot		Slot at the root of the subtree to walk
+   * @return Next leaf number to assign after the subtree
+   */
+	int placeEytzinger(int leaf, int slot);
+
+  /**
+   * Find the leaf holding the first entry that is greater than (or, if inclusive, equal to) the given key.
+   * @param key				Key to search
+   * @param inclusive	Whether entries equal to key qualify
+   * @return Leaf number
+   */
+	int findLeaf(int key, bool inclusive) const;
+
+  /**
+   * Add the position of the first entry of a key to the learned model, extending the last segment when the
+   * error bound allows it and starting a new one otherwise.
+   * @param key		Key, greater than the keys added before
+   * @param pos		Position of the first entry with this key
+   */
+	void addModelPoint(int key, int pos);
+
+  /**
+   * Write the segments of the learned model after the leaves.
+   */
+	void writeModel();
+
+  /**
+   * Load the segments of the learned model from the index file into memory.
+   */
+	void loadModel();
+
+  /**
+   * Key of the entry at the given position, read from its leaf.
+   * The leaf stays pinned for the next call, so that a search window within one leaf pins it once.
+   * @param pos			Position of the entry
+   * @param pageNo	Leaf pinned by the previous call, 0 if none; set to the leaf holding the entry
+   * @param page		Pinned leaf, updated along with pageNo
+   */
+	int keyAt(int pos, PageId &pageNo, Page *&page);
+
+  /**
+   * Find the position of the first entry with a key not smaller than the given key using the learned model:
+   * a search of the window the error bound allows around the predicted position, widened if the prediction misses.
+   * @param key		Key to search
+   * @return Position of the entry, size() if every key is smaller
+   */
+	int findPosition(int key);
+
+ public:
+
+  /**
+   * StaticIndex Constructor.
+	 * Check to see if the corresponding index file exists. If so, open the file and load its directory.
+	 * If not, create it from every tuple in the base relation using FileScan class.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @param modelError					If not 0, build a learned index whose model predicts positions within this many entries.
+   *                            Ignored when the index file exists, which keeps the choice made when it was built.
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters,
+   *                                    or if modelError is negative.
+   * @throws  InvalidRecordException    If a record of the relation is too short to hold the attribute. The partly built index file is removed.
+   */
+	StaticIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType, const int modelError = 0);
+
+  /**
+   * StaticIndex Destructor.
+	 * End any initialized scan, flush the index file from the buffer manager and delete the file instance thereby closing the index file.
+	 * Does not throw; a failed flush is swallowed.
+	 */
+	~StaticIndex();
+
+  /**
+	 * Begin a filtered scan of the index. Search the directory for the leaf holding the first entry in range and keep it pinned.
+	 * If another scan is already executing, that needs to be ended here.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+	 * @throws  NoSuchKeyFoundException If there is no key in the index that satisfies the scan criteria.
+	**/
+	void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  /**
+	 * Begin a filtered scan of the index like startScan, reporting an empty range through the return value instead of throwing.
+   * @return True if the scan was started, False if there is no key in the index that satisfies the scan criteria
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+	**/
+	bool tryStartScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan, moving on to the next leaf when the current one is done.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	void scanNext(RecordId& outRid);
+
+  /**
+	 * Fetch the record id of the next index entry like scanNext, reporting the end of the scan through the return value instead of throwing.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @return True if a record id was returned, False if no more records satisfy the scan criteria
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	bool tryScanNext(RecordId& outRid);
+
+  /**
+	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	void endScan();
+
+  /**
+   * Number of entries in the index.
+   */
+	int size() const { return meta.numEntries; }
+
+  /**
+   * Number of segments of the learned model, 0 if the index is not learned.
+   */
+	int numModelSegments() const { return meta.numSegments; }
+};
+
+}
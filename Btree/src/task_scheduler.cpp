@@ -0,0 +1,261 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "task_scheduler.h"
+
+namespace badgerdb
+{
+
+	/**
+	 * Scheduler the calling thread is a worker of, and its index there.
+	 */
+	static thread_local const TaskScheduler *workerScheduler = nullptr;
+	static thread_local unsigned workerIndex = 0;
+
+	// -----------------------------------------------------------------------------
+	// TaskGroup::TaskGroup
+	// -----------------------------------------------------------------------------
+
+	TaskGroup::TaskGroup()
+		: pendingTasks(0)
+	{
+	}
+
+	// -----------------------------------------------------------------------------
+	// TaskScheduler::TaskScheduler
+	// -----------------------------------------------------------------------------
+
+	TaskScheduler::TaskScheduler(const unsigned numWorkers, const WorkerPinning pinning)
+		: queuedTasks(0), nextQueue(0), stopping(false)
+	{
+		unsigned numCores = std::max(1u, std::thread::hardware_concurrency());
+		unsigned count = numWorkers == 0 ? numCores : numWorkers;
+		for (unsigned i = 0; i < count; i++)
+		{
+			queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+		}
+		for (unsigned i = 0; i < count; i++)
+		{
+			workers.push_back(std::thread(&TaskScheduler::workerLoop, this, i));
+#ifdef __linux__
+			if (pinning == PIN_WORKERS)
+			{
+				cpu_set_t cores;
+				CPU_ZERO(&cores);
+				CPU_SET(i % numCores, &cores);
+				pthread_setaffinity_np(workers.back().native_handle(), sizeof(cpu_set_t), &cores);
+			}
+#endif
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// TaskScheduler::~TaskScheduler
+	// -----------------------------------------------------------------------------
+
+	TaskScheduler::~TaskScheduler()
+	{
+		shutdown();
+	}
+
+	// -----------------------------------------------------------------------------
+	// TaskScheduler::submit
+	// -----------------------------------------------------------------------------
+
+	void TaskScheduler::submit(TaskGroup &group, const std::function<void()> &task)
+	{
+		ScheduledTask scheduled = {&group, task};
+		group.pendingTasks++;
+		{
+			//the push is made under the latch shutdown() sets stopping with, so either a worker still takes the task
+			//before exiting or the task is run here; the workers may be exiting already, but not yet joined
+			std::lock_guard<std::mutex> lock(sleepLatch);
+			if (!stopping)
+			{
+				unsigned self = currentWorker();
+				WorkerQueue &queue = *queues[self < numWorkers() ? self : nextQueue++ % numWorkers()];
+				{
+					std::lock_guard<std::mutex> queueLock(queue.latch);
+					queue.tasks.push_back(scheduled);
+				}
+				queuedTasks++;
+				wakeup.notify_one();
+				return;
+			}
+		}
+		runTask(scheduled);
+	}
+
+	void TaskScheduler::submit(const std::function<void()> &task)
+	{
+		submit(detachedTasks, task);
+	}
+
+	// -----------------------------------------------------------------------------
+	// TaskScheduler::parallelFor
+	// -----------------------------------------------------------------------------
+
+	void TaskScheduler::parallelFor(TaskGroup &group, const PageId firstPageNo, const PageId endPageNo,
+									const PageId morselPages, const std::function<void(PageId, PageId)> &body)
+	{
+		PageId first = firstPageNo;
+		while (first < endPageNo)
+		{
+			PageId end = first + std::min(morselPages, endPageNo - first);
+			submit(group, [body, first, end]() { body(first, end); });
+			first = end;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// TaskScheduler::wait
+	// -----------------------------------------------------------------------------
+
+	void TaskScheduler::wait(TaskGroup &group)
+	{
+		unsigned self = currentWorker();
+		ScheduledTask task;
+		while (group.pendingTasks > 0 && takeTask(self, task))
+		{
+			runTask(task);
+		}
+		std::exception_ptr error;
+		{
+			//the remaining tasks of the group are running on other threads
+			std::unique_lock<std::mutex> lock(group.errorLatch);
+			group.finished.wait(lock, [&group]() { return group.pendingTasks == 0; });
+			std::swap(error, group.error);
+		}
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// TaskScheduler::shutdown
+	// -----------------------------------------------------------------------------
+
+	void TaskScheduler::shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepLatch);
+			stopping = true;
+		}
+		wakeup.notify_all();
+		for (std::size_t i = 0; i < workers.size(); i++)
+		{
+			workers[i].join();
+		}
+		workers.clear();
+	}
+
+	// -----------------------------------------------------------------------------
+	// TaskScheduler::takeTask
+	// -----------------------------------------------------------------------------
+
+	bool TaskScheduler::takeTask(const unsigned self, ScheduledTask &task)
+	{
+		if (queuedTasks == 0)
+		{
+			return false;
+		}
+		unsigned n = numWorkers();
+		for (unsigned i = 0; i < n; i++)
+		{
+			//own deque first, at the back; then every other one, at the front
+			unsigned victim = (self + i) % n;
+			WorkerQueue &queue = *queues[victim];
+			std::lock_guard<std::mutex> lock(queue.latch);
+			if (queue.tasks.empty())
+			{
+				continue;
+			}
+			if (victim == self)
+			{
+				task = queue.tasks.back();
+				queue.tasks.pop_back();
+			}
+			else
+			{
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+			}
+			queuedTasks--;
+			return true;
+		}
+		return false;
+	}
+
+	// -----------------------------------------------------------------------------
+	// TaskScheduler::runTask
+	// -----------------------------------------------------------------------------
+
+	void TaskScheduler::runTask(ScheduledTask &task)
+	{
+		try
+		{
+			task.run();
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(task.group->errorLatch);
+			if (!task.group->error)
+			{
+				task.group->error = std::current_exception();
+			}
+		}
+		//the latch is held across the decrement and the notify: once wait() sees no pending task, the group may be
+		//destroyed, so the group must not be touched after the latch is released
+		std::lock_guard<std::mutex> lock(task.group->errorLatch);
+		if (--task.group->pendingTasks == 0)
+		{
+			task.group->finished.notify_all();
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// TaskScheduler::workerLoop
+	// -----------------------------------------------------------------------------
+
+	void TaskScheduler::workerLoop(const unsigned self)
+	{
+		workerScheduler = this;
+		workerIndex = self;
+		ScheduledTask task;
+		while (true)
+		{
+			if (takeTask(self, task))
+			{
+				runTask(task);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepLatch);
+			wakeup.wait(lock, [this]() { return stopping || queuedTasks > 0; });
+			//queued tasks are still run after shutdown() is called
+			if (stopping && queuedTasks == 0)
+			{
+				return;
+			}
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// TaskScheduler::currentWorker
+	// -----------------------------------------------------------------------------
+
+	unsigned TaskScheduler::currentWorker() const
+	{
+		return workerScheduler == this ? workerIndex : numWorkers();
+	}
+
+}
@@ -0,0 +1,218 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Default number of relation pages in one morsel of a parallel scan.
+ */
+const PageId MORSELPAGES = 16;
+
+/**
+ * @brief Whether the workers of a TaskScheduler are pinned to cores.
+ */
+enum WorkerPinning
+{
+	NO_PINNING = 0,
+	PIN_WORKERS = 1		//worker i runs only on core i modulo the number of cores
+};
+
+/**
+ * @brief Set of tasks that can be waited for together.
+ * The first exception thrown by a task of the group is kept and rethrown by TaskScheduler::wait.
+ */
+class TaskGroup
+{
+	friend class TaskScheduler;
+
+ public:
+	TaskGroup();
+
+ private:
+  /**
+   * Number of tasks submitted to the group that have not finished yet.
+   */
+	std::atomic<int>	pendingTasks;
+
+  /**
+   * Latch protecting error, and the one finished is waited on with.
+   */
+	std::mutex	errorLatch;
+
+  /**
+   * Notified when the last pending task of the group finishes.
+   */
+	std::condition_variable	finished;
+
+  /**
+   * First exception thrown by a task of the group, if any.
+   */
+	std::exception_ptr	error;
+};
+
+/**
+ * @brief Work-stealing thread pool.
+ * Every worker owns a deque of tasks. A worker runs the newest task of its own deque and, once that is empty,
+ * steals the oldest task of another worker. Tasks submitted from a worker go to its own deque; tasks submitted
+ * from any other thread are spread round-robin over the workers.
+ */
+class TaskScheduler
+{
+ public:
+  /**
+   * Start the workers.
+   * @param numWorkers	Number of worker threads, 0 for one per core
+   * @param pinning			Whether to pin the workers to cores
+   */
+	TaskScheduler(const unsigned numWorkers = 0, const WorkerPinning pinning = NO_PINNING);
+
+  /**
+   * Shut the scheduler down, see shutdown().
+   */
+	~TaskScheduler();
+
+  /**
+   * Queue a task. If shutdown() has been called, the task is run on the calling thread instead. May be called
+   * concurrently with shutdown().
+   * @param group		Group the task belongs to
+   * @param task		Task to run
+   */
+	void submit(TaskGroup &group, const std::function<void()> &task);
+
+  /**
+   * Queue a task nobody waits for. Exceptions it throws are dropped, so it has to report its errors itself,
+   * for instance through a promise. shutdown() still runs it.
+   * @param task		Task to run
+   */
+	void submit(const std::function<void()> &task);
+
+  /**
+   * Split a range of page numbers into morsels and queue one task per morsel.
+   * @param group				Group the tasks belong to
+   * @param firstPageNo	First page number of the range
+   * @param endPageNo		One past the last page number of the range
+   * @param morselPages	Number of pages per morsel
+   * @param body				Called with the first and one past the last page number of each morsel
+   */
+	void parallelFor(TaskGroup &group, const PageId firstPageNo, const PageId endPageNo, const PageId morselPages,
+					 const std::function<void(PageId, PageId)> &body);
+
+  /**
+   * Wait for all tasks of a group to finish, running queued tasks on the calling thread meanwhile.
+   * Once no task is left to take, the remaining ones of the group are running on other threads, and the calling
+   * thread sleeps until they are done.
+   * Rethrows the first exception thrown by a task of the group.
+   * @param group		Group to wait for
+   */
+	void wait(TaskGroup &group);
+
+  /**
+   * Run the tasks still queued, then stop and join the workers. Later submissions run on the calling thread.
+   */
+	void shutdown();
+
+  /**
+   * Number of worker threads.
+   */
+	unsigned numWorkers() const { return queues.size(); }
+
+ private:
+  /**
+   * A queued task and the group it belongs to.
+   */
+	struct ScheduledTask
+	{
+		TaskGroup *group;
+		std::function<void()> run;
+	};
+
+  /**
+   * Deque of tasks owned by one worker. The owner pushes and pops at the back, thieves take from the front.
+   */
+	struct WorkerQueue
+	{
+		std::mutex latch;
+		std::deque<ScheduledTask> tasks;
+	};
+
+  /**
+   * Deque of every worker.
+   */
+	std::vector<std::unique_ptr<WorkerQueue> > queues;
+
+  /**
+   * Worker threads.
+   */
+	std::vector<std::thread> workers;
+
+  /**
+   * Number of tasks in all deques.
+   */
+	std::atomic<int>	queuedTasks;
+
+  /**
+   * Deque receiving the next task submitted from outside the workers.
+   */
+	std::atomic<unsigned>	nextQueue;
+
+  /**
+   * Latch and condition idle workers sleep on.
+   */
+	std::mutex	sleepLatch;
+	std::condition_variable	wakeup;
+
+  /**
+   * Group of the tasks submitted without one.
+   */
+	TaskGroup	detachedTasks;
+
+  /**
+   * Set by shutdown(), under sleepLatch.
+   */
+	bool	stopping;
+
+  /**
+   * Take a task, from the back of the caller's own deque first, then from the front of the others.
+   * @param self		Deque of the calling worker, numWorkers() for threads that are not workers
+   * @param task		Task taken returned in this
+   * @return True if a task was taken
+   */
+	bool takeTask(const unsigned self, ScheduledTask &task);
+
+  /**
+   * Run a task, recording its exception in its group, and count it as finished.
+   */
+	void runTask(ScheduledTask &task);
+
+  /**
+   * Main loop of a worker.
+   * @param self		Index of the worker
+   */
+	void workerLoop(const unsigned self);
+
+  /**
+   * Index of the calling thread's deque if it is a worker of this scheduler, numWorkers() otherwise.
+   */
+	unsigned currentWorker() const;
+};
+
+}
@@ -0,0 +1,127 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include "victim_cache.h"
+#include "page_codec.h"
+#include "memory_tracker.h"
+
+namespace badgerdb {
+
+VictimCache::VictimCache(const std::size_t bytes)
+  : capacityBytes(bytes), usedBytes(0)
+{
+}
+
+VictimCache::~VictimCache()
+{
+  MemoryTracker::process().release(MEMORY_VICTIMCACHE, usedBytes);
+}
+
+void VictimCache::insert(const File* file, const PageId pageNo, const Page& page)
+{
+  if (!enabled())
+  {
+    return;
+  }
+  char packed[compressBound(Page::SIZE)];
+  std::size_t length = compressPage(reinterpret_cast<const char*>(&page), Page::SIZE, packed);
+  if (length >= Page::SIZE)
+  {
+    //incompressible; still spares a read
+    insertImage(file, pageNo, reinterpret_cast<const char*>(&page), Page::SIZE);
+  }
+  else
+  {
+    insertImage(file, pageNo, packed, length);
+  }
+}
+
+void VictimCache::insertImage(const File* file, const PageId pageNo, const char* image, const std::size_t length)
+{
+  if (!enabled())
+  {
+    return;
+  }
+  remove(file, pageNo);
+  if (length > capacityBytes)
+  {
+    return;
+  }
+
+  //make room by dropping the oldest images, within the capacity and then within the memory budget of the process
+  while (usedBytes + length > capacityBytes)
+  {
+    erase(index.find(images.back().key));
+  }
+  while (!MemoryTracker::process().tryReserve(MEMORY_VICTIMCACHE, length))
+  {
+    if (images.empty())
+    {
+      return;
+    }
+    erase(index.find(images.back().key));
+  }
+  CachedImage cached;
+  cached.key = PageKey(file, pageNo);
+  cached.image.assign(image, image + length);
+  images.push_front(cached);
+  index[cached.key] = images.begin();
+  usedBytes += length;
+}
+
+bool VictimCache::fetch(const File* file, const PageId pageNo, Page& page)
+{
+  std::map<PageKey, std::list<CachedImage>::iterator>::iterator entry = index.find(PageKey(file, pageNo));
+  if (entry == index.end())
+  {
+    return false;
+  }
+  const std::vector<char>& image = entry->second->image;
+  char* dest = reinterpret_cast<char*>(&page);
+  if (image.size() == Page::SIZE)
+  {
+    memcpy(dest, image.data(), Page::SIZE);
+  }
+  else if (!decompressPage(image.data(), image.size(), dest, Page::SIZE))
+  {
+    //a corrupt image is dropped and the page read from disk instead
+    erase(entry);
+    return false;
+  }
+  erase(entry);
+  return true;
+}
+
+void VictimCache::remove(const File* file, const PageId pageNo)
+{
+  std::map<PageKey, std::list<CachedImage>::iterator>::iterator entry = index.find(PageKey(file, pageNo));
+  if (entry != index.end())
+  {
+    erase(entry);
+  }
+}
+
+void VictimCache::removeFile(const File* file)
+{
+  //the keys of a file are contiguous in the index
+  std::map<PageKey, std::list<CachedImage>::iterator>::iterator entry = index.lower_bound(PageKey(file, 0));
+  while (entry != index.end() && entry->first.first == file)
+  {
+    erase(entry++);
+  }
+}
+
+void VictimCache::erase(std::map<PageKey, std::list<CachedImage>::iterator>::iterator entry)
+{
+  usedBytes -= entry->second->image.size();
+  MemoryTracker::process().release(MEMORY_VICTIMCACHE, entry->second->image.size());
+  images.erase(entry->second);
+  index.erase(entry);
+}
+
+}
@@ -0,0 +1,144 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+* @brief Second tier of the buffer pool, holding compressed images of the clean pages BufMgr evicts.
+* A page read again soon after its eviction is decompressed from here instead of being read from the file. Once the
+* compressed images exceed the memory budget, or would take the process over the budget of its MemoryTracker, the
+* least recently evicted ones are dropped.
+*
+* @warning This class is not threadsafe; BufMgr only uses it under its latch.
+*/
+class VictimCache
+{
+ private:
+	/**
+	 * Key of a cached page: its file and page number
+	 */
+  typedef std::pair<const File*, PageId> PageKey;
+
+	/**
+	 * Compressed image of a cached page
+	 */
+  struct CachedImage
+  {
+    PageKey key;
+    std::vector<char> image;
+  };
+
+	/**
+	 * Cached images, most recently inserted first
+	 */
+  std::list<CachedImage> images;
+
+	/**
+	 * Position of the image of every cached page in images
+	 */
+  std::map<PageKey, std::list<CachedImage>::iterator> index;
+
+	/**
+	 * Memory budget for the images, in bytes; 0 disables the cache
+	 */
+  std::size_t capacityBytes;
+
+	/**
+	 * Bytes taken by the images currently cached
+	 */
+  std::size_t usedBytes;
+
+	/**
+	 * Drop the image at the given position.
+	 */
+  void erase(std::map<PageKey, std::list<CachedImage>::iterator>::iterator entry);
+
+ public:
+	/**
+   * Constructor of VictimCache class
+	 *
+	 * @param bytes		Memory budget for the compressed images; 0 disables the cache
+	 */
+  VictimCache(const std::size_t bytes);
+
+	/**
+   * Destructor of VictimCache class
+	 */
+  ~VictimCache();
+
+	/**
+   * True if the cache has a non-zero budget
+	 */
+  bool enabled() const { return capacityBytes > 0; }
+
+	/**
+	 * Compress and cache an evicted page, replacing any older image of it. Pages whose image alone exceeds the
+	 * budget are not cached.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param page		Contents of the page, which must be the same as in the file
+	 */
+  void insert(const File* file, const PageId pageNo, const Page& page);
+
+	/**
+	 * Cache the image of an evicted page, already compressed with compressPage, replacing any older image of it.
+	 * An image of Page::SIZE bytes is taken to be the page itself. Images exceeding the budget are not cached.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param image		Compressed contents of the page, which must be the same as in the file
+	 * @param length	Length of the image in bytes, at most Page::SIZE
+	 */
+  void insertImage(const File* file, const PageId pageNo, const char* image, const std::size_t length);
+
+	/**
+	 * Take the image of a page out of the cache, as it moves back into the buffer pool.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param page		Decompressed page returned via this reference, set only if the page is cached
+	 * @return true if the page was cached, false if it was not or its image could not be decompressed
+	 */
+  bool fetch(const File* file, const PageId pageNo, Page& page);
+
+	/**
+	 * Drop the image of a page if it is cached.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  void remove(const File* file, const PageId pageNo);
+
+	/**
+	 * Drop the images of every page of a file.
+	 *
+	 * @param file   	File object
+	 */
+  void removeFile(const File* file);
+
+	/**
+   * Bytes taken by the images currently cached
+	 */
+  std::size_t bytesUsed() const { return usedBytes; }
+
+	/**
+   * Number of pages currently cached
+	 */
+  std::size_t numPages() const { return index.size(); }
+};
+
+}
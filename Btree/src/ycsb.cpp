@@ -0,0 +1,774 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Macro workload driver in the style of YCSB. Loads a relation of records with integer keys 0 .. records - 1 at the
+ * start of each record, builds a BTreeIndex over it through FileScan, then runs a mix of operations from several
+ * threads for a fixed time, and reports the throughput and the 50th, 99th and 99.9th percentile latency of each
+ * kind of operation. Latencies are counted in histogram buckets, and a percentile is reported as the upper bound of
+ * the bucket it falls in, printed as "p99 <= 12.03 us"; the bound is at most about 3% above the actual latency.
+ *
+ * Operations, all through one BufMgr:
+ *   read     look the key up in the index and read its records from the relation
+ *   update   look the key up and rewrite the payload of its records, in place
+ *   insert   append a record with the next unused key to the relation and insert it into the index
+ *   scan     scan the index from the key over scan-length keys and read the records found
+ *   delete   look the key up and delete its records from the relation. BTreeIndex has no delete, so the index entries
+ *            stay behind; later operations on the key find no record and count as not found.
+ *
+ * Keys are drawn from a uniform, a zipfian (scrambled over the key space, as in YCSB) or a latest distribution,
+ * under which the most recently inserted keys are the most popular. Lookups from several threads run concurrently;
+ * operations changing the index or the relation, and scans, which use the scan state of the index, run alone.
+ *
+ * Build with "make ycsb"; pass optimization flags through CFLAGS, e.g. make clean; make ycsb CFLAGS="-std=c++0x -O2".
+ * Usage: badgerdb_ycsb [option value ...]
+ *   -workload a|b|c|d|e  core workload presets: a 50% reads 50% updates, zipfian; b 95% reads 5% updates, zipfian;
+ *                        c reads only, zipfian; d 95% reads 5% inserts, latest; e 95% scans 5% inserts, zipfian
+ *   -read, -update, -insert, -scan, -delete   proportions of each operation, overriding the preset
+ *   -distribution uniform|zipfian|latest
+ *   -records n           records loaded (default 100000)
+ *   -recordsize bytes    bytes per record, key included (default 100)
+ *   -scanlength n        keys per scan (default 100)
+ *   -threads n           client threads (default 4)
+ *   -duration seconds    run time (default 5)
+ *   -operations n        stop after this many operations in all, if before the run time is up (default 0, no limit)
+ *   -pool frames         buffer pool frames (default 1000)
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "btree.h"
+#include "page.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_record_exception.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Globals
+// -----------------------------------------------------------------------------
+const std::string relationName = "relYcsb";
+
+enum OperationType
+{
+	READ = 0,
+	UPDATE = 1,
+	INSERT = 2,
+	SCAN = 3,
+	DELETE = 4
+};
+const int numOperationTypes = 5;
+const char *operationNames[numOperationTypes] = {"read", "update", "insert", "scan", "delete"};
+
+enum KeyDistribution
+{
+	UNIFORM_KEYS,
+	ZIPFIAN_KEYS,
+	LATEST_KEYS
+};
+
+struct WorkloadConfig
+{
+	double proportions[numOperationTypes];
+	KeyDistribution distribution;
+	int records;
+	int recordSize;
+	int scanLength;
+	int threads;
+	double durationSeconds;
+	long operations;
+	std::uint32_t poolFrames;
+};
+
+typedef std::chrono::steady_clock DriverClock;
+
+// -----------------------------------------------------------------------------
+// Key generators
+// -----------------------------------------------------------------------------
+
+/**
+ * Zipfian ranks 0 .. items - 1, rank 0 the most popular, with the method of Gray et al. used by YCSB. The item count
+ * may grow as keys are inserted; the zeta constant is extended incrementally.
+ */
+class ZipfianGenerator
+{
+ public:
+	static constexpr double THETA = 0.99;
+
+	explicit ZipfianGenerator(const long items)
+		: numItems(0), zetaN(0)
+	{
+		zeta2 = 1 + std::pow(0.5, THETA);
+		grow(items);
+	}
+
+	long next(std::mt19937_64 &rng, const long items)
+	{
+		if (items > numItems)
+		{
+			grow(items);
+		}
+		double u = std::uniform_real_distribution<double>(0, 1)(rng);
+		double uz = u * zetaN;
+		if (uz < 1)
+		{
+			return 0;
+		}
+		if (uz < zeta2)
+		{
+			return 1;
+		}
+		long rank = (long)(numItems * std::pow(eta * u - eta + 1, 1 / (1 - THETA)));
+		return std::min(rank, numItems - 1);
+	}
+
+ private:
+	long numItems;
+	double zetaN;
+	double zeta2;
+	double eta;
+
+	void grow(const long items)
+	{
+		for (long i = numItems + 1; i <= items; i++)
+		{
+			zetaN += 1 / std::pow((double)i, THETA);
+		}
+		numItems = items;
+		eta = (1 - std::pow(2.0 / numItems, 1 - THETA)) / (1 - zeta2 / zetaN);
+	}
+};
+
+/**
+ * Draws the keys of the operations of one thread from the keys inserted so far.
+ */
+class KeyGenerator
+{
+ public:
+	KeyGenerator(const KeyDistribution distributionIn, const ZipfianGenerator &zipfianIn, const unsigned seed)
+		: distribution(distributionIn), zipfian(zipfianIn), rng(seed)
+	{
+	}
+
+	int next(const long items)
+	{
+		switch (distribution)
+		{
+		case ZIPFIAN_KEYS:
+			//spread the popular ranks over the key space, so that they do not share leaves
+			return (int)(fnvHash(zipfian.next(rng, items)) % items);
+		case LATEST_KEYS:
+			return (int)(items - 1 - zipfian.next(rng, items));
+		default:
+			return (int)(rng() % items);
+		}
+	}
+
+	std::mt19937_64 &random() { return rng; }
+
+ private:
+	KeyDistribution distribution;
+	ZipfianGenerator zipfian;
+	std::mt19937_64 rng;
+
+	static std::uint64_t fnvHash(std::uint64_t value)
+	{
+		std::uint64_t hash = 0xcbf29ce484222325ull;
+		for (int i = 0; i < 8; i++)
+		{
+			hash = (hash ^ (value & 0xff)) * 0x100000001b3ull;
+			value >>= 8;
+		}
+		return hash;
+	}
+};
+
+// -----------------------------------------------------------------------------
+// Latency histogram
+// -----------------------------------------------------------------------------
+
+/**
+ * Latencies in nanoseconds, in buckets of 1/32 of a power of two, so that percentiles are within about 3%.
+ */
+class LatencyHistogram
+{
+ public:
+	LatencyHistogram() : counts(64 * SUBBUCKETS, 0), total(0) {}
+
+	void record(const std::uint64_t ns)
+	{
+		counts[bucket(ns)]++;
+		total++;
+	}
+
+	void merge(const LatencyHistogram &other)
+	{
+		for (std::size_t i = 0; i < counts.size(); i++)
+		{
+			counts[i] += other.counts[i];
+		}
+		total += other.total;
+	}
+
+	std::uint64_t count() const { return total; }
+
+	/**
+	 * Upper bound, in nanoseconds, of the bucket holding the latency below which the given fraction of the operations
+	 * completed.
+	 */
+	std::uint64_t percentile(const double fraction) const
+	{
+		std::uint64_t rank = (std::uint64_t)std::ceil(fraction * total);
+		std::uint64_t seen = 0;
+		for (std::size_t i = 0; i < counts.size(); i++)
+		{
+			seen += counts[i];
+			if (seen >= rank && seen > 0)
+			{
+				return bucketLimit(i);
+			}
+		}
+		return 0;
+	}
+
+ private:
+	static const int SUBBUCKETS = 32;
+	std::vector<std::uint64_t> counts;
+	std::uint64_t total;
+
+	static std::size_t bucket(const std::uint64_t ns)
+	{
+		if (ns < SUBBUCKETS)
+		{
+			return ns;
+		}
+		int shift = 63 - __builtin_clzll(ns) - 5;
+		return (shift + 1) * SUBBUCKETS + ((ns >> shift) & (SUBBUCKETS - 1));
+	}
+
+	static std::uint64_t bucketLimit(const std::size_t index)
+	{
+		if (index < SUBBUCKETS)
+		{
+			return index;
+		}
+		int shift = index / SUBBUCKETS - 1;
+		return ((std::uint64_t)(SUBBUCKETS + index % SUBBUCKETS + 1) << shift) - 1;
+	}
+};
+
+// -----------------------------------------------------------------------------
+// Shared latch
+// -----------------------------------------------------------------------------
+
+/**
+ * Latch taken shared by lookups and exclusively by the operations changing the index or the relation, and by scans.
+ */
+class SharedLatch
+{
+ public:
+	SharedLatch() : readers(0), writer(false) {}
+
+	void lockShared()
+	{
+		std::unique_lock<std::mutex> lock(latch);
+		released.wait(lock, [this]() { return !writer; });
+		readers++;
+	}
+
+	void unlockShared()
+	{
+		std::lock_guard<std::mutex> lock(latch);
+		if (--readers == 0)
+		{
+			released.notify_all();
+		}
+	}
+
+	void lock()
+	{
+		std::unique_lock<std::mutex> lock(latch);
+		released.wait(lock, [this]() { return !writer; });
+		writer = true;
+		released.wait(lock, [this]() { return readers == 0; });
+	}
+
+	void unlock()
+	{
+		std::lock_guard<std::mutex> lock(latch);
+		writer = false;
+		released.notify_all();
+	}
+
+ private:
+	std::mutex latch;
+	std::condition_variable released;
+	int readers;
+	bool writer;
+};
+
+// -----------------------------------------------------------------------------
+// Database
+// -----------------------------------------------------------------------------
+
+/**
+ * The relation, its index and the buffer pool they share, with the operations run on them.
+ */
+class Database
+{
+ public:
+	Database(const WorkloadConfig &configIn)
+		: config(configIn), bufMgr(configIn.poolFrames), index(nullptr), relation(nullptr)
+	{
+		createRelation();
+		DriverClock::time_point start = DriverClock::now();
+		index = new BTreeIndex(relationName, indexName, &bufMgr, 0, INTEGER);
+		indexBuildMs = std::chrono::duration<double, std::milli>(DriverClock::now() - start).count();
+		relation = new PageFile(relationName, false);
+		insertedKeys = config.records;
+		//report the pool statistics of the run only
+		bufMgr.clearBufStats();
+	}
+
+	~Database()
+	{
+		delete index;
+		bufMgr.flushFile(relation);
+		delete relation;
+		File::remove(indexName);
+		File::remove(relationName);
+	}
+
+	long numKeys() const { return insertedKeys.load(); }
+
+	double buildMs() const { return indexBuildMs; }
+
+	BufStats bufStats() { return bufMgr.getBufStats(); }
+
+	/**
+	 * Run one operation on a key.
+	 * @return False if the key has no record
+	 */
+	bool run(const OperationType type, int key, std::mt19937_64 &rng)
+	{
+		switch (type)
+		{
+		case READ:
+		{
+			latch.lockShared();
+			bool found = false;
+			try
+			{
+				found = readRecords(key);
+			}
+			catch (...)
+			{
+				latch.unlockShared();
+				throw;
+			}
+			latch.unlockShared();
+			return found;
+		}
+		case INSERT:
+		{
+			std::lock_guard<SharedLatch> lock(latch);
+			insertRecord();
+			return true;
+		}
+		case SCAN:
+		{
+			std::lock_guard<SharedLatch> lock(latch);
+			return scanRecords(key);
+		}
+		default:
+		{
+			std::lock_guard<SharedLatch> lock(latch);
+			return changeRecords(key, type == DELETE, (char)('a' + rng() % 26));
+		}
+		}
+	}
+
+ private:
+	WorkloadConfig config;
+	BufMgr bufMgr;
+	std::string indexName;
+	BTreeIndex *index;
+	PageFile *relation;
+	SharedLatch latch;
+	std::atomic<long> insertedKeys;
+	PageId insertPageNo;
+	double indexBuildMs;
+
+	std::string makeRecord(const int key, const char fill) const
+	{
+		std::string record(std::max<int>(sizeof(int), config.recordSize), fill);
+		memcpy(&record[0], &key, sizeof(int));
+		return record;
+	}
+
+	void createRelation()
+	{
+		try
+		{
+			File::remove(relationName);
+		}
+		catch (const FileNotFoundException &e)
+		{
+		}
+		PageFile file(relationName, true);
+		PageId pageNumber;
+		Page page = file.allocatePage(pageNumber);
+		for (int key = 0; key < config.records; key++)
+		{
+			RecordId rid;
+			std::string record = makeRecord(key, 'x');
+			while (!page.tryInsertRecord(record, rid))
+			{
+				file.writePage(pageNumber, page);
+				page = file.allocatePage(pageNumber);
+			}
+		}
+		file.writePage(pageNumber, page);
+		insertPageNo = pageNumber;
+	}
+
+	/**
+	 * Whether a record id of the index still leads to the record of the key.
+	 */
+	static bool holdsKey(Page *page, const RecordId &rid, const int key)
+	{
+		try
+		{
+			std::size_t length;
+			const char *data = page->getRecordData(rid, length);
+			int stored;
+			memcpy(&stored, data, sizeof(int));
+			return length >= sizeof(int) && stored == key;
+		}
+		catch (const InvalidRecordException &e)
+		{
+			return false;
+		}
+	}
+
+	bool readRecords(const int key)
+	{
+		std::vector<RecordId> rids;
+		index->find(&key, rids);
+		bool found = false;
+		for (std::size_t i = 0; i < rids.size(); i++)
+		{
+			Page *page;
+			bufMgr.readPage(relation, rids[i].page_number, page);
+			found = holdsKey(page, rids[i], key) || found;
+			bufMgr.unPinPage(relation, rids[i].page_number, false);
+		}
+		return found;
+	}
+
+	bool changeRecords(const int key, const bool remove, const char fill)
+	{
+		std::vector<RecordId> rids;
+		index->find(&key, rids);
+		bool found = false;
+		for (std::size_t i = 0; i < rids.size(); i++)
+		{
+			Page *page;
+			bufMgr.readPage(relation, rids[i].page_number, page);
+			bool holds = holdsKey(page, rids[i], key);
+			if (holds && remove)
+			{
+				page->deleteRecord(rids[i]);
+			}
+			else if (holds)
+			{
+				page->updateRecord(rids[i], makeRecord(key, fill));
+			}
+			bufMgr.unPinPage(relation, rids[i].page_number, holds);
+			found = found || holds;
+		}
+		return found;
+	}
+
+	void insertRecord()
+	{
+		int key = (int)insertedKeys.load();
+		std::string record = makeRecord(key, 'x');
+		Page *page;
+		RecordId rid;
+		bufMgr.readPage(relation, insertPageNo, page);
+		if (!page->tryInsertRecord(record, rid))
+		{
+			bufMgr.unPinPage(relation, insertPageNo, false);
+			bufMgr.allocPage(relation, insertPageNo, page);
+			page->tryInsertRecord(record, rid);
+		}
+		bufMgr.unPinPage(relation, insertPageNo, true);
+		index->insertEntry(&key, rid);
+		//readers draw the key only once it is in the index
+		insertedKeys++;
+	}
+
+	bool scanRecords(const int key)
+	{
+		int highKey = key + config.scanLength;
+		if (!index->tryStartScan(&key, GTE, &highKey, LT))
+		{
+			return false;
+		}
+		RecordId rid;
+		bool found = false;
+		while (index->tryScanNext(rid))
+		{
+			Page *page;
+			bufMgr.readPage(relation, rid.page_number, page);
+			std::size_t length;
+			try
+			{
+				page->getRecordData(rid, length);
+				found = true;
+			}
+			catch (const InvalidRecordException &e)
+			{
+			}
+			bufMgr.unPinPage(relation, rid.page_number, false);
+		}
+		index->endScan();
+		return found;
+	}
+};
+
+// -----------------------------------------------------------------------------
+// Driver
+// -----------------------------------------------------------------------------
+
+/**
+ * Results of one client thread.
+ */
+struct ClientResults
+{
+	LatencyHistogram latencies[numOperationTypes];
+	long notFound[numOperationTypes];
+};
+
+void runClient(Database &database, const WorkloadConfig &config, const ZipfianGenerator &zipfian, const unsigned seed,
+			   const DriverClock::time_point deadline, std::atomic<long> &remaining, ClientResults &results)
+{
+	KeyGenerator keys(config.distribution, zipfian, seed);
+	std::fill(results.notFound, results.notFound + numOperationTypes, 0);
+	double total = 0;
+	for (int t = 0; t < numOperationTypes; t++)
+	{
+		total += config.proportions[t];
+	}
+	while (config.operations == 0 || remaining-- > 0)
+	{
+		//pick the operation
+		double choice = std::uniform_real_distribution<double>(0, total)(keys.random());
+		int type = 0;
+		while (type < numOperationTypes - 1 && choice >= config.proportions[type])
+		{
+			choice -= config.proportions[type];
+			type++;
+		}
+		int key = keys.next(database.numKeys());
+
+		DriverClock::time_point start = DriverClock::now();
+		bool found = database.run((OperationType)type, key, keys.random());
+		DriverClock::time_point end = DriverClock::now();
+		results.latencies[type].record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		if (!found)
+		{
+			results.notFound[type]++;
+		}
+		if (end >= deadline)
+		{
+			break;
+		}
+	}
+}
+
+bool setPreset(WorkloadConfig &config, const char preset)
+{
+	std::fill(config.proportions, config.proportions + numOperationTypes, 0);
+	config.distribution = ZIPFIAN_KEYS;
+	switch (preset)
+	{
+	case 'a':
+		config.proportions[READ] = 0.5;
+		config.proportions[UPDATE] = 0.5;
+		return true;
+	case 'b':
+		config.proportions[READ] = 0.95;
+		config.proportions[UPDATE] = 0.05;
+		return true;
+	case 'c':
+		config.proportions[READ] = 1;
+		return true;
+	case 'd':
+		config.proportions[READ] = 0.95;
+		config.proportions[INSERT] = 0.05;
+		config.distribution = LATEST_KEYS;
+		return true;
+	case 'e':
+		config.proportions[SCAN] = 0.95;
+		config.proportions[INSERT] = 0.05;
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool parseArguments(int argc, char **argv, WorkloadConfig &config)
+{
+	setPreset(config, 'a');
+	config.records = 100000;
+	config.recordSize = 100;
+	config.scanLength = 100;
+	config.threads = 4;
+	config.durationSeconds = 5;
+	config.operations = 0;
+	config.poolFrames = 1000;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string option = argv[i];
+		std::string value = argv[i + 1];
+		if (option == "-workload")
+		{
+			if (value.size() != 1 || !setPreset(config, value[0]))
+			{
+				return false;
+			}
+		}
+		else if (option == "-distribution")
+		{
+			if (value == "uniform")
+				config.distribution = UNIFORM_KEYS;
+			else if (value == "zipfian")
+				config.distribution = ZIPFIAN_KEYS;
+			else if (value == "latest")
+				config.distribution = LATEST_KEYS;
+			else
+				return false;
+		}
+		else if (option == "-records")
+			config.records = atoi(value.c_str());
+		else if (option == "-recordsize")
+			config.recordSize = atoi(value.c_str());
+		else if (option == "-scanlength")
+			config.scanLength = atoi(value.c_str());
+		else if (option == "-threads")
+			config.threads = atoi(value.c_str());
+		else if (option == "-duration")
+			config.durationSeconds = atof(value.c_str());
+		else if (option == "-operations")
+			config.operations = atol(value.c_str());
+		else if (option == "-pool")
+			config.poolFrames = atoi(value.c_str());
+		else
+		{
+			bool known = false;
+			for (int t = 0; t < numOperationTypes; t++)
+			{
+				if (option == std::string("-") + operationNames[t])
+				{
+					config.proportions[t] = atof(value.c_str());
+					known = true;
+				}
+			}
+			if (!known)
+			{
+				return false;
+			}
+		}
+	}
+	return argc % 2 == 1 && config.records > 0 && config.threads > 0 && config.poolFrames > 0 &&
+		   config.recordSize <= (int)Page::DATA_SIZE / 2 && config.scanLength > 0;
+}
+
+int main(int argc, char **argv)
+{
+	WorkloadConfig config;
+	if (!parseArguments(argc, argv, config))
+	{
+		std::cerr << "Usage: " << argv[0] << " [-workload a|b|c|d|e] [-read p] [-update p] [-insert p] [-scan p] "
+				  << "[-delete p] [-distribution uniform|zipfian|latest] [-records n] [-recordsize bytes] "
+				  << "[-scanlength n] [-threads n] [-duration seconds] [-operations n] [-pool frames]" << std::endl;
+		return 1;
+	}
+	const char *distributionNames[] = {"uniform", "zipfian", "latest"};
+	std::cout << config.records << " records of " << config.recordSize << " bytes, " << config.threads << " threads, "
+			  << distributionNames[config.distribution] << " keys, " << config.poolFrames << " frames; mix";
+	for (int t = 0; t < numOperationTypes; t++)
+	{
+		if (config.proportions[t] > 0)
+		{
+			std::cout << " " << operationNames[t] << " " << config.proportions[t];
+		}
+	}
+	std::cout << std::endl;
+
+	Database database(config);
+	std::cout << "Load: index built in " << database.buildMs() << " ms" << std::endl;
+
+	ZipfianGenerator zipfian(config.records);
+	std::vector<ClientResults> results(config.threads);
+	std::vector<std::thread> clients;
+	std::atomic<long> remaining(config.operations);
+	DriverClock::time_point start = DriverClock::now();
+	DriverClock::time_point deadline =
+		start + std::chrono::duration_cast<DriverClock::duration>(std::chrono::duration<double>(config.durationSeconds));
+	for (int c = 0; c < config.threads; c++)
+	{
+		clients.push_back(std::thread(runClient, std::ref(database), std::cref(config), std::cref(zipfian), 1000 + c,
+									  deadline, std::ref(remaining), std::ref(results[c])));
+	}
+	for (int c = 0; c < config.threads; c++)
+	{
+		clients[c].join();
+	}
+	double seconds = std::chrono::duration<double>(DriverClock::now() - start).count();
+
+	LatencyHistogram all;
+	std::cout << "Run:" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	for (int t = 0; t < numOperationTypes; t++)
+	{
+		LatencyHistogram latencies;
+		long notFound = 0;
+		for (int c = 0; c < config.threads; c++)
+		{
+			latencies.merge(results[c].latencies[t]);
+			notFound += results[c].notFound[t];
+		}
+		all.merge(latencies);
+		if (latencies.count() == 0)
+		{
+			continue;
+		}
+		std::cout << "  " << operationNames[t] << "\t" << latencies.count() << " ops\t" << notFound << " not found\tp50 <= "
+				  << latencies.percentile(0.5) / 1e3 << " us\tp99 <= " << latencies.percentile(0.99) / 1e3 << " us\tp999 <= "
+				  << latencies.percentile(0.999) / 1e3 << " us" << std::endl;
+	}
+	std::cout << "  total\t" << all.count() << " ops in " << seconds << " s\t" << all.count() / seconds << " ops/s\tp50 <= "
+			  << all.percentile(0.5) / 1e3 << " us\tp99 <= " << all.percentile(0.99) / 1e3 << " us\tp999 <= "
+			  << all.percentile(0.999) / 1e3 << " us" << std::endl;
+	BufStats stats = database.bufStats();
+	std::cout << "Buffer pool: " << stats.diskreads << " disk reads, " << stats.diskwrites << " disk writes" << std::endl;
+	return 0;
+}